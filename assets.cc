@@ -0,0 +1,134 @@
+#include "assets.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <iostream>
+
+AssetPack::~AssetPack() {
+    if (data_) munmap((void*)data_, size_);
+}
+
+bool AssetPack::InBounds(uint32_t offset, size_t size) const {
+    return offset % 4 == 0 && offset <= size_ && size <= size_ - offset;
+}
+
+bool AssetPack::Open(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(PackHeader)) {
+        close(fd);
+        return false;
+    }
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+
+    data_ = (const uint8_t*)map;
+    size_ = st.st_size;
+    header_ = (const PackHeader*)data_;
+
+    bool valid = memcmp(header_->magic, PACK_MAGIC, sizeof(PACK_MAGIC)) == 0 &&
+                 header_->version == PACK_VERSION &&
+                 header_->byte_order == PACK_BYTE_ORDER &&
+                 InBounds(header_->icon_table, header_->icon_count * sizeof(PackIcon)) &&
+                 InBounds(header_->font_table, header_->font_count * sizeof(PackFont));
+
+    const PackIcon* icons = (const PackIcon*)(data_ + header_->icon_table);
+    for (uint32_t i = 0; valid && i < header_->icon_count; ++i) {
+        const PackIcon& icon = icons[i];
+        valid = InBounds(icon.pixels, (size_t)icon.width * icon.height * sizeof(Pixel)) &&
+                InBounds(icon.spans, icon.span_count * sizeof(IconSpan));
+    }
+    const PackFont* fonts = (const PackFont*)(data_ + header_->font_table);
+    for (uint32_t i = 0; valid && i < header_->font_count; ++i) {
+        const PackFont& font = fonts[i];
+        valid = InBounds(font.glyphs, font.glyph_count * sizeof(GlyphBitmap)) &&
+                InBounds(font.rows, font.row_count * sizeof(uint32_t));
+        const GlyphBitmap* glyphs = (const GlyphBitmap*)(data_ + font.glyphs);
+        for (uint32_t g = 0; valid && g < font.glyph_count; ++g) {
+            valid = glyphs[g].first_row + glyphs[g].row_count <= font.row_count;
+        }
+    }
+
+    if (!valid) {
+        std::cerr << "Ignoring invalid asset pack " << path
+                  << " (run 'make assets' to rebuild it)" << std::endl;
+        munmap(map, size_);
+        data_ = nullptr;
+        header_ = nullptr;
+        size_ = 0;
+        return false;
+    }
+    return true;
+}
+
+const PackIcon* AssetPack::FindIcon(const char* name) const {
+    if (!header_) return nullptr;
+    const PackIcon* icons = (const PackIcon*)(data_ + header_->icon_table);
+    for (uint32_t i = 0; i < header_->icon_count; ++i) {
+        if (strncmp(icons[i].name, name, sizeof(icons[i].name)) == 0) return &icons[i];
+    }
+    return nullptr;
+}
+
+const PackFont* AssetPack::FindFont(const char* name) const {
+    if (!header_) return nullptr;
+    const PackFont* fonts = (const PackFont*)(data_ + header_->font_table);
+    for (uint32_t i = 0; i < header_->font_count; ++i) {
+        if (strncmp(fonts[i].name, name, sizeof(fonts[i].name)) == 0) return &fonts[i];
+    }
+    return nullptr;
+}
+
+bool AssetPack::AttachIcon(const char* name, IconAtlas& atlas, IconId id) const {
+    const PackIcon* icon = FindIcon(name);
+    if (!icon) return false;
+    atlas.Attach(id, (const Pixel*)(data_ + icon->pixels), icon->width, icon->height,
+                 (const IconSpan*)(data_ + icon->spans), icon->span_count);
+    return true;
+}
+
+bool AssetPack::LoadStrip(const char* name, IconAnimations& animations, IconId id) const {
+    const PackIcon* icon = FindIcon(name);
+    if (!icon) return false;
+    return SetAnimationStrip(animations, id, (const Pixel*)(data_ + icon->pixels),
+                             icon->width, icon->height);
+}
+
+bool AssetPack::AttachFont(const char* name, BitmapFont& font) const {
+    const PackFont* f = FindFont(name);
+    if (!f) return false;
+    font.Attach(f->height, f->baseline,
+                (const GlyphBitmap*)(data_ + f->glyphs), f->glyph_count,
+                (const uint32_t*)(data_ + f->rows));
+    return true;
+}
+
+void LoadIcons(IconAtlas& atlas, const AssetPack& pack) {
+    for (size_t i = 0; i < ICON_SOURCE_COUNT; ++i) {
+        const IconSource& source = ICON_SOURCES[i];
+        if (pack.AttachIcon(source.name, atlas, source.id)) continue;
+        LoadIcon(atlas, source);
+    }
+}
+
+void LoadAnimations(IconAnimations& animations, const IconAtlas& atlas, const AssetPack& pack) {
+    for (size_t i = 0; i < ICON_SOURCE_COUNT; ++i) {
+        const IconSource& source = ICON_SOURCES[i];
+        std::string strip = std::string(source.name) + "_anim";
+        if (pack.LoadStrip(strip.c_str(), animations, source.id)) continue;
+        LoadAnimation(animations, source, atlas.Get(source.id));
+    }
+}
+
+bool LoadFont(BitmapFont& font, const AssetPack& pack, const char* bdf_path) {
+    const char* slash = strrchr(bdf_path, '/');
+    const char* name = slash ? slash + 1 : bdf_path;
+    if (pack.AttachFont(name, font)) return true;
+    return font.LoadFont(bdf_path);
+}
@@ -0,0 +1,91 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include "bitmap_font.h"
+#include "icons.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// --- Asset pack file format ---
+// Written by tools/assetpack ("make assets") on the machine that runs the
+// clock, so the structs are stored in native byte order and checked against
+// PACK_BYTE_ORDER when the pack is opened. All offsets are from the start
+// of the file and 4-byte aligned.
+
+const char PACK_MAGIC[8] = {'L', 'E', 'D', 'P', 'A', 'C', 'K', '\0'};
+const uint32_t PACK_VERSION = 2;   // 2: icons faded by their alpha
+const uint32_t PACK_BYTE_ORDER = 0x01020304;
+
+struct PackHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t icon_count;
+    uint32_t icon_table;    // PackIcon[icon_count]
+    uint32_t font_count;
+    uint32_t font_table;    // PackFont[font_count]
+};
+
+struct PackIcon {
+    char name[32];          // PNG file name without extension, e.g. "sun"
+    uint16_t width, height;
+    uint32_t pixels;        // Pixel[width * height]
+    uint32_t spans;         // IconSpan[span_count]
+    uint32_t span_count;
+};
+
+struct PackFont {
+    char name[32];          // BDF file name, e.g. "6x12.bdf"
+    int32_t height, baseline;
+    uint32_t glyphs;        // GlyphBitmap[glyph_count], sorted by codepoint
+    uint32_t glyph_count;
+    uint32_t rows;          // uint32_t[row_count]
+    uint32_t row_count;
+};
+
+const char* const ASSET_PACK_PATH = "assets.pack";
+
+// Read-only view of a memory-mapped asset pack. Icons and fonts handed out
+// point straight into the mapping, so the pack must outlive them.
+class AssetPack {
+public:
+    AssetPack() = default;
+    ~AssetPack();
+
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    // Maps and validates the pack. Returns false if it is missing or bad.
+    bool Open(const char* path);
+    bool is_open() const { return data_ != nullptr; }
+
+    const PackIcon* FindIcon(const char* name) const;
+    const PackFont* FindFont(const char* name) const;
+
+    // Points `atlas`/`font` at the pack's data without copying it.
+    bool AttachIcon(const char* name, IconAtlas& atlas, IconId id) const;
+    bool AttachFont(const char* name, BitmapFont& font) const;
+    // Copies the strip `name` into the ring of `id`; see SetAnimationStrip().
+    bool LoadStrip(const char* name, IconAnimations& animations, IconId id) const;
+
+private:
+    bool InBounds(uint32_t offset, size_t size) const;
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    const PackHeader* header_ = nullptr;
+};
+
+// Loads all icons from the pack when there is one, from icons/ otherwise.
+void LoadIcons(IconAtlas& atlas, const AssetPack& pack);
+
+// Works out the frames of every icon that moves, from <name>_anim strips
+// in the pack or icons/, or falling out of the still icons in `atlas`.
+void LoadAnimations(IconAnimations& animations, const IconAtlas& atlas, const AssetPack& pack);
+
+// Takes `bdf_path`'s glyphs from the pack when there is one, else loads the
+// BDF file itself.
+bool LoadFont(BitmapFont& font, const AssetPack& pack, const char* bdf_path);
+
+#endif
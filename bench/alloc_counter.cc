@@ -0,0 +1,26 @@
+#include "alloc_counter.h"
+
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+
+// Kept in its own file so the compiler never sees these inlined next to
+// the code using them.
+
+namespace {
+std::atomic<size_t> alloc_count{0};
+std::atomic<size_t> alloc_bytes{0};
+}  // namespace
+
+size_t AllocCount() { return alloc_count.load(std::memory_order_relaxed); }
+size_t AllocBytes() { return alloc_bytes.load(std::memory_order_relaxed); }
+
+void* operator new(size_t size) {
+    alloc_count.fetch_add(1, std::memory_order_relaxed);
+    alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
@@ -0,0 +1,12 @@
+#ifndef BENCH_ALLOC_COUNTER_H
+#define BENCH_ALLOC_COUNTER_H
+
+#include <stddef.h>
+
+// Linking alloc_counter.cc replaces the global operator new, so every heap
+// allocation in the process is counted, on any thread. The counters are
+// relaxed atomics: exact totals, but no ordering with other memory.
+size_t AllocCount();
+size_t AllocBytes();
+
+#endif
@@ -0,0 +1,1741 @@
+// Micro-benchmarks for the parse, asset loading and render paths.
+//
+//   make bench
+//   make bench BENCH_FLAGS="--json=bench.json --filter=Render"
+//
+// Runs from the repository root and reads the recorded API payloads in
+// bench/data/, the icons and fonts, and assets.pack. Rendering goes into
+// memory; no network or matrix is needed.
+//
+// Every case reports ns/op, heap allocations per op and throughput.
+// --json=PATH also writes the results as JSON ("-" for stdout) so runs
+// can be compared between versions; --filter=TEXT only runs the cases
+// whose name contains TEXT.
+
+#include "alloc_counter.h"
+#include "assets.h"
+#include "color_lut.h"
+#include "compositor.h"
+#include "config.h"
+#include "conditions.h"
+#include "display.h"
+#include "layout.h"
+#include "local_time.h"
+#include "metrics.h"
+#include "graphics.h"
+#include "render.h"
+#include "replay.h"
+#include "scheduler.h"
+#include "ticker.h"
+#include "tiled_renderer.h"
+#include "weather.h"
+#include "json_extract.h"
+#include "lodepng.h"
+
+#include <nlohmann/json.hpp>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::string ReadFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cerr << "Couldn't read " << path << std::endl;
+        exit(1);
+    }
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+// Keeps the optimizer from discarding benchmark results.
+volatile size_t sink;
+
+struct Result {
+    std::string name;
+    size_t iterations;
+    double ns_per_op;
+    double allocs_per_op;
+    double alloc_bytes_per_op;
+    size_t bytes_per_op;  // input processed per op, 0 if not meaningful
+};
+
+std::vector<Result> results;
+std::string filter;
+
+// Runs fn until at least ~200 ms have passed, then prints and records
+// time and allocations per call. `bytes` is the input size one call
+// processes, for a MB/s figure.
+template <typename Fn>
+void Run(const std::string& name, Fn fn, size_t bytes = 0) {
+    if (!filter.empty() && name.find(filter) == std::string::npos) return;
+
+    using Clock = std::chrono::steady_clock;
+    fn();  // warm up
+    size_t iters = 1;
+    while (true) {
+        size_t allocs = AllocCount(), alloc_size = AllocBytes();
+        auto start = Clock::now();
+        for (size_t i = 0; i < iters; ++i) fn();
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        if (ns > 2e8 || iters >= (1u << 30)) {
+            Result r{name, iters, ns / iters, double(AllocCount() - allocs) / iters,
+                     double(AllocBytes() - alloc_size) / iters, bytes};
+            std::cout << std::left << std::setw(44) << name << std::right << std::fixed
+                      << std::setprecision(1) << std::setw(12) << r.ns_per_op << " ns/op"
+                      << std::setprecision(2) << std::setw(10) << r.allocs_per_op << " allocs/op"
+                      << std::setprecision(0) << std::setw(12) << 1e9 / r.ns_per_op << " op/s";
+            if (bytes) {
+                std::cout << std::setprecision(1) << std::setw(9)
+                          << bytes * 1e3 / r.ns_per_op << " MB/s";
+            }
+            std::cout << std::endl;
+            results.push_back(r);
+            return;
+        }
+        iters *= 2;
+    }
+}
+
+bool WriteJson(const std::string& path) {
+    nlohmann::json out;
+    char date[32];
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    out["date"] = date;
+    out["compiler"] = __VERSION__;
+    out["benchmarks"] = nlohmann::json::array();
+    for (const Result& r : results) {
+        nlohmann::json j = {
+            {"name", r.name},
+            {"iterations", r.iterations},
+            {"ns_per_op", r.ns_per_op},
+            {"allocs_per_op", r.allocs_per_op},
+            {"alloc_bytes_per_op", r.alloc_bytes_per_op},
+            {"ops_per_sec", 1e9 / r.ns_per_op},
+        };
+        if (r.bytes_per_op) j["bytes_per_sec"] = r.bytes_per_op * 1e9 / r.ns_per_op;
+        out["benchmarks"].push_back(j);
+    }
+
+    if (path == "-") {
+        std::cout << out.dump(2) << std::endl;
+        return true;
+    }
+    std::ofstream file(path);
+    file << out.dump(2) << std::endl;
+    return bool(file);
+}
+
+// --- DOM reference implementations (the previous parse path) ---
+
+WeatherData ParseWeatherDOM(const std::string& jsonStr, Units units) {
+    WeatherData data;
+    if (jsonStr.empty()) return {"No data", ""};
+
+    try {
+        nlohmann::json j = nlohmann::json::parse(jsonStr);
+
+        int cod_val = j["cod"].is_string() ? std::stoi(j["cod"].get<std::string>())
+                                           : j["cod"].get<int>();
+        if (cod_val != 200) return {j.value("message", "API error"), ""};
+
+        data.description = j["weather"][0].value("description", "Unknown");
+        double temp_val = j["main"].value("temp", 0.0);
+        const char* unit_label = (units == Units::Metric) ? "°C" : "°F";
+
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(1) << temp_val << unit_label;
+        data.temp = oss.str();
+    } catch (...) {
+        data = {"Parse error", ""};
+    }
+    return data;
+}
+
+float ParseOpenMeteoTempDOM(const std::string& jsonStr) {
+    auto data = nlohmann::json::parse(jsonStr);
+    return data["current_weather"]["temperature"];
+}
+
+// The extractor must agree with the DOM path before timing means anything.
+bool CheckParseWeather() {
+    const char* cases[] = {
+        "",
+        "{",
+        "not json",
+        "[1, 2]",
+        "{\"cod\":401,\"message\":\"Invalid API key. Please see https://openweathermap.org/faq#error401 for more info.\"}",
+        "{\"cod\":\"404\",\"message\":\"city not found\"}",
+        "{\"cod\":500}",
+        "{\"cod\":\"abc\"}",
+        "{\"cod\":200}",
+        "{\"cod\":200,\"x\":1.2.3}",
+        "{\"cod\":200,\"x\":01}",
+        "{\"cod\":200,\"weather\":[{}],\"main\":{}}",
+        "{\"cod\":200,\"weather\":[{\"description\":\"light \\\"rain\\\" \\u00e9\"}],\"main\":{\"temp\":-3.25}}",
+        "{\"cod\":200,\"weather\":[{\"description\":5}],\"main\":{\"temp\":1}}",
+        "{\"cod\":200,\"weather\":[{\"description\":\"bad \\u00zz escape\"}],\"main\":{\"temp\":1}}",
+        "{\"cod\":200,\"weather\":[{\"description\":\"bad \\u+1ab\"}],\"main\":{\"temp\":1}}",
+        "{\"cod\":200,\"weather\":[{\"description\":\"cut \\u00\"}],\"main\":{\"temp\":1}}",
+        "{\"cod\":200,\"weather\":[{\"description\":\"fog\"}],\"main\":{\"temp\":\"1\"}}",
+        "{\"cod\":200,\"weather\":[{\"description\":\"fog\"}],\"main\":{\"temp\":1}} trailing",
+    };
+    bool ok = true;
+    for (const char* c : cases) {
+        WeatherData a = ParseWeatherDOM(c, Units::Imperial);
+        WeatherData b = ParseWeather(c, Units::Imperial);
+        if (a.description != b.description || a.temp != b.temp) {
+            std::cerr << "MISMATCH for " << c << "\n  dom:    " << a.description << " / " << a.temp
+                      << "\n  stream: " << b.description << " / " << b.temp << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// Config lines are range checked, and a file with any bad line, or with
+// stale_seconds under fresh_seconds, leaves the running settings alone.
+bool CheckConfig() {
+    char path[] = "/tmp/clock_config_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        std::cerr << "Can't make a config file to check" << std::endl;
+        return false;
+    }
+    close(fd);
+    auto load = [&](const char* text, ClockConfig* config) {
+        std::ofstream(path) << text;
+        std::string error;
+        return LoadConfig(path, config, &error);
+    };
+    auto same = [](const rgb_matrix::Color& a, int r, int g, int b) {
+        return a.r == r && a.g == g && a.b == b;
+    };
+    WeatherData clear;
+    clear.condition = 800;
+
+    bool ok = true;
+    auto expect = [&](bool passed, const char* what) {
+        if (!passed) std::cerr << "Config: " << what << std::endl;
+        ok = ok && passed;
+    };
+    ClockConfig config;
+    expect(load("clock_color = #ff8000\n", &config) && same(config.clock_color, 255, 128, 0),
+           "#rrggbb colour");
+    expect(load("clock_color = 10, 20 ,30\n", &config) && same(config.clock_color, 10, 20, 30),
+           "R,G,B colour");
+    for (const char* bad : {"256,0,0", "0,-1,0", "0,0", "1,2,3,4", "#ff80", "#ff800g", "ff8000"}) {
+        std::string line = std::string("clock_color = ") + bad + "\n";
+        expect(!load(line.c_str(), &config) && same(config.clock_color, 10, 20, 30),
+               "bad colour accepted");
+    }
+    expect(same(config.ticker_color, 10, 20, 30) && same(config.date_color, 10, 20, 30),
+           "day and date don't follow clock_color");
+    expect(load("date_color = 1,2,3\nclock_color = 4,5,6\nticker_color = #070809\n", &config) &&
+           same(config.date_color, 1, 2, 3) && same(config.ticker_color, 7, 8, 9) &&
+           same(config.clock_color, 4, 5, 6), "own day and date colours overridden");
+    expect(load("outline_color = #102030\nrain_color = 0,0,255\n", &config) &&
+           same(config.outline_color, 16, 32, 48) && same(config.rain_color, 0, 0, 255) &&
+           same(config.date_color, 1, 2, 3), "outline and rain colours");
+    expect(!load("rain_color = 0,0\n", &config) && same(config.rain_color, 0, 0, 255),
+           "bad rain colour accepted");
+
+    expect(load("dim_hours = 22-7\n", &config) && config.brightness.Level(false, 23) == 40 &&
+           config.brightness.Level(false, 3) == 40 && config.brightness.Level(false, 7) == 100 &&
+           config.brightness.Level(true, 12) == 100, "dim hours past midnight");
+    expect(load("dim_hours = 1-5\n", &config) && config.brightness.Level(false, 1) == 40 &&
+           config.brightness.Level(false, 5) == 100, "dim hours within a day");
+    expect(load("dim_hours = sun\n", &config) && config.brightness.Level(true, 12) == 40 &&
+           config.brightness.Level(false, 23) == 100, "dim hours from the sun");
+    expect(!load("dim_hours = 24-7\n", &config) && !load("dim_hours = 22\n", &config) &&
+           config.brightness.dim_from == -1, "bad dim hours accepted");
+
+    expect(load("gamma = 0.5\n", &config) && config.gamma == 0.5f &&
+           load("gamma = 3\n", &config) && config.gamma == 3.0f, "gamma at its bounds");
+    for (const char* bad : {"0.49", "3.01", "abc", "", "nan"}) {
+        std::string line = std::string("gamma = ") + bad + "\n";
+        expect(!load(line.c_str(), &config) && config.gamma == 3.0f, "bad gamma accepted");
+    }
+
+    expect(load("icon.clear = sun, moon\n", &config) &&
+           config.icons.Select(clear, false) == IconId::Sun &&
+           config.icons.Select(clear, true) == IconId::Moon, "day and night icons");
+    expect(load("icon.clear = cloud\n", &config) &&
+           config.icons.Select(clear, false) == IconId::Cloud &&
+           config.icons.Select(clear, true) == IconId::Cloud, "one icon for day and night");
+    expect(!load("icon.sunny = sun\n", &config) && !load("icon.clear = sun,nosuch\n", &config) &&
+           config.icons.Select(clear, true) == IconId::Cloud, "bad icon accepted");
+
+    expect(!load("fresh_seconds = 600\nstale_seconds = 300\n", &config) &&
+           config.weather.fresh_seconds != 600, "stale shorter than fresh accepted");
+
+    ClockConfig before = config;
+    expect(!load("clock_color = 1,2,3\nunits = metric\ngamma = 9\n", &config) &&
+           same(config.clock_color, 4, 5, 6) && config.weather.units == before.weather.units &&
+           config.gamma == before.gamma, "bad line kept part of the file");
+    std::remove(path);
+    return ok;
+}
+
+// Backoff doubles with jitter the seed decides, the breaker opens after
+// BREAKER_FAILURES and holds off forced requests, and a failed probe from
+// half-open opens it again.
+bool CheckProviderHealth() {
+    const time_t start = 1000000;
+    // The waits after each failure in a row, from the given seed
+    auto waits = [&](uint32_t seed) {
+        ProviderHealth health(seed);
+        std::vector<time_t> out;
+        for (int i = 0; i < 8; ++i) {
+            health.Failure(start);
+            out.push_back(health.retry_at() - start);
+        }
+        return out;
+    };
+    const std::vector<time_t> a = waits(7), b = waits(7), c = waits(8);
+    bool ok = a == b && a != c;
+    for (size_t i = 0; ok && i < a.size(); ++i) {
+        const int full = std::min(BACKOFF_BASE_SECONDS << i, BACKOFF_MAX_SECONDS);
+        ok = a[i] >= full / 2 && a[i] <= full;
+    }
+    if (!ok) {
+        std::cerr << "Backoff isn't doubling, jittered by the seed alone" << std::endl;
+        return false;
+    }
+
+    ProviderHealth health(7);
+    health.Failure(start);
+    if (health.state() != ProviderHealth::State::Closed || health.Allow(start + 1, false) ||
+        !health.Allow(start + 1, true)) {
+        std::cerr << "A closed breaker must back off, except for a forced request" << std::endl;
+        return false;
+    }
+    for (int i = 1; i < BREAKER_FAILURES; ++i) health.Failure(start);
+    time_t retry = health.retry_at();
+    if (health.state() != ProviderHealth::State::Open || health.Allow(retry - 1, true) ||
+        health.state() != ProviderHealth::State::Open) {
+        std::cerr << "An open breaker let a forced request through" << std::endl;
+        return false;
+    }
+    if (!health.Allow(retry, false) || health.state() != ProviderHealth::State::HalfOpen) {
+        std::cerr << "An open breaker didn't let a probe through once its wait was over"
+                  << std::endl;
+        return false;
+    }
+    health.Failure(retry);
+    if (health.state() != ProviderHealth::State::Open || health.retry_at() <= retry ||
+        health.Allow(retry, true)) {
+        std::cerr << "A failed probe didn't open the breaker again" << std::endl;
+        return false;
+    }
+    health.Success();
+    if (health.state() != ProviderHealth::State::Closed || health.failures() != 0 ||
+        !health.Allow(retry, false)) {
+        std::cerr << "A success didn't close the breaker" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Answers every request with the same body.
+class FixedHttp : public HttpSource {
+public:
+    std::vector<HttpResponse> PerformAll(const std::vector<HttpRequest>& requests,
+                                         const DoneFn& on_done) override {
+        std::vector<HttpResponse> responses(requests.size());
+        for (size_t i = 0; i < requests.size(); ++i) {
+            responses[i].ok = true;
+            responses[i].status = 200;
+            responses[i].body = "{\"cod\":200}";
+            if (on_done) on_done(i, responses[i]);
+        }
+        return responses;
+    }
+};
+
+// A recording keeps no API key, and replays for a config with another one.
+bool CheckRecordedKey() {
+    char path[] = "/tmp/clock_recording_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        std::cerr << "Can't make a recording to check" << std::endl;
+        return false;
+    }
+    close(fd);
+    FixedHttp fixed;
+    {
+        RecordingHttp recorder(&fixed, path);
+        recorder.PerformAll({{OpenWeatherURL("1", "2", "secret123", Units::Imperial), {}}});
+    }
+    std::ifstream in(path);
+    std::string recorded((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    ReplayHttp replay;
+    std::string error;
+    bool loaded = replay.Load(path, &error);
+    std::remove(path);
+    if (recorded.find("secret123") != std::string::npos ||
+        recorded.find("appid") != std::string::npos ||
+        recorded.find("lon=2&units=imperial") == std::string::npos) {
+        std::cerr << "Recording holds the API key, or lost the rest: " << recorded;
+        return false;
+    }
+    std::vector<HttpResponse> answer =
+        replay.PerformAll({{OpenWeatherURL("1", "2", "other", Units::Imperial), {}}});
+    if (!loaded || !answer[0].ok || answer[0].body != "{\"cod\":200}") {
+        std::cerr << "Recording doesn't replay with another key: " << error << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Both providers as tools/weather_stub.cc plays them, on the simulated
+// clock: each request takes the next of its provider's modes, in turn. A
+// batch is answered fastest first, as HttpClient's would be.
+//
+//   ok        200 with the body (304 if its ETag is sent back)
+//   error     500
+//   garbage   200 with a body that is not JSON
+//   hang      no answer; the transfer times out
+//   slow      as ok, but answered after the others
+class ScriptedHttp : public HttpSource {
+public:
+    struct Request {
+        time_t at;
+        int provider;
+        std::vector<std::string> headers;
+    };
+
+    ScriptedHttp(const std::string& owm_body, const std::string& meteo_body)
+        : bodies_{owm_body, meteo_body} {}
+
+    std::vector<std::string> modes[PROVIDER_COUNT];
+    time_t now = 0;
+    std::vector<Request> requests;
+    std::function<void()> before_slow;   // called before a slow answer arrives
+
+    std::vector<HttpResponse> PerformAll(const std::vector<HttpRequest>& batch,
+                                         const DoneFn& on_done) override {
+        std::vector<HttpResponse> responses(batch.size());
+        for (size_t i = 0; i < batch.size(); ++i) {
+            const int p = batch[i].url.find("/v1/forecast") != std::string::npos
+                              ? PROVIDER_OPEN_METEO : PROVIDER_OPENWEATHER;
+            requests.push_back({now, p, batch[i].headers});
+            const std::string& mode = modes[p][next_[p]++ % modes[p].size()];
+            const std::string etag = p == PROVIDER_OPENWEATHER ? "\"owm\"" : "\"meteo\"";
+            HttpResponse& r = responses[i];
+            r.ok = mode != "hang";
+            r.timing.total = mode == "hang" ? 10.0 : mode == "slow" ? 8.0 : 0.2;
+            if (mode == "ok" || mode == "slow") {
+                bool revalidated = std::find(batch[i].headers.begin(), batch[i].headers.end(),
+                                             "If-None-Match: " + etag) != batch[i].headers.end();
+                r.status = revalidated ? 304 : 200;
+                if (!revalidated) r.body = bodies_[p];
+                r.etag = etag;
+            } else if (mode == "error") {
+                r.status = 500;
+                r.body = "{\"cod\":500,\"message\":\"Internal error\"}";
+                r.etag = "\"bad\"";
+            } else if (mode == "garbage") {
+                r.status = 200;
+                r.body = "<html>Service Unavailable</html>";
+                r.etag = "\"bad\"";
+            } else {
+                r.error = "Operation timed out";
+            }
+        }
+        std::vector<size_t> order(batch.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return responses[a].timing.total < responses[b].timing.total;
+        });
+        for (size_t i : order) {
+            if (responses[i].timing.total == 8.0 && before_slow) before_slow();
+            if (on_done) on_done(i, responses[i]);
+        }
+        return responses;
+    }
+
+private:
+    std::string bodies_[PROVIDER_COUNT];
+    size_t next_[PROVIDER_COUNT] = {};
+};
+
+// The worker's failure handling against the stub's sequences, with a fixed
+// seed so the backoff is known: the waits grow as ProviderHealth's, the
+// breaker opens on the fifth failure in a row and holds off a forced
+// refresh, a good half-open probe closes it, no bad answer is ever cached
+// (its ETag would come back), and a slow provider doesn't hold back what
+// the fast one answered.
+bool CheckWorkerFailures(const std::string& owm_body, const std::string& meteo_body) {
+    const uint32_t seed = 5;
+    const time_t start = 2000000000;
+
+    // OpenWeather answers at once while Open-Meteo is slow
+    {
+        ScriptedHttp http(owm_body, meteo_body);
+        http.modes[PROVIDER_OPENWEATHER] = {"ok"};
+        http.modes[PROVIDER_OPEN_METEO] = {"slow"};
+        WeatherWorker worker(WeatherConfig(), "", &http, seed);
+        bool published_first = false;
+        http.before_slow = [&] {
+            std::unique_ptr<WeatherData> data = worker.TakeSnapshot();
+            published_first = data && !data->description.empty();
+        };
+        http.now = start;
+        worker.RunUntil(start);
+        if (!published_first) {
+            std::cerr << "A slow Open-Meteo held back OpenWeather's snapshot" << std::endl;
+            return false;
+        }
+    }
+
+    ScriptedHttp http(owm_body, meteo_body);
+    http.modes[PROVIDER_OPENWEATHER] = {"error", "garbage", "hang", "error", "garbage", "ok"};
+    http.modes[PROVIDER_OPEN_METEO] = {"ok"};
+    WeatherWorker worker(WeatherConfig(), "", &http, seed);
+    const std::atomic<int>& breaker = clockMetrics.providers[PROVIDER_OPENWEATHER].breaker_open;
+    ProviderHealth expected(seed);   // the worker's OpenWeather health, replayed
+    std::vector<time_t> tries;
+    for (time_t now = start; now < start + 3600 && tries.size() < 6; ++now) {
+        http.now = now;
+        size_t before = http.requests.size();
+        worker.RunUntil(now);
+        for (size_t i = before; i < http.requests.size(); ++i) {
+            if (http.requests[i].provider != PROVIDER_OPENWEATHER) continue;
+            if (!tries.empty() && now != expected.retry_at()) {
+                std::cerr << "OpenWeather retried after " << now - tries.back()
+                          << " s, not " << expected.retry_at() - tries.back() << std::endl;
+                return false;
+            }
+            tries.push_back(now);
+            if (tries.size() < 6) {
+                expected.Allow(now, false);
+                expected.Failure(now);
+            }
+        }
+        if (tries.size() == BREAKER_FAILURES && now == tries.back()) {
+            // Open: a forced refresh goes nowhere
+            if (breaker.load() != 1) {
+                std::cerr << "Breaker not open after " << BREAKER_FAILURES << " failures"
+                          << std::endl;
+                return false;
+            }
+            size_t asked = http.requests.size();
+            worker.RequestRefresh();
+            worker.RunUntil(now);
+            for (size_t i = asked; i < http.requests.size(); ++i) {
+                if (http.requests[i].provider == PROVIDER_OPENWEATHER) {
+                    std::cerr << "A forced refresh went through an open breaker" << std::endl;
+                    return false;
+                }
+            }
+        }
+    }
+    if (tries.size() != 6 || breaker.load() != 0) {
+        std::cerr << "OpenWeather tried " << tries.size() << " times, breaker "
+                  << (breaker.load() ? "open" : "closed") << " after the probe" << std::endl;
+        return false;
+    }
+    for (size_t i = 1; i < tries.size(); ++i) {
+        const int full = std::min(BACKOFF_BASE_SECONDS << (i - 1), BACKOFF_MAX_SECONDS);
+        if (tries[i] - tries[i - 1] < full / 2 || tries[i] - tries[i - 1] > full) {
+            std::cerr << "Backoff " << tries[i] - tries[i - 1] << " s after " << i
+                      << " failures" << std::endl;
+            return false;
+        }
+    }
+    for (const ScriptedHttp::Request& r : http.requests) {
+        for (const std::string& header : r.headers) {
+            if (header.find("\"bad\"") != std::string::npos) {
+                std::cerr << "A bad answer was cached: " << header << std::endl;
+                return false;
+            }
+        }
+    }
+    std::unique_ptr<WeatherData> shown = worker.TakeSnapshot();
+    if (!shown || strcmp(shown->description.c_str(), "scattered clouds") != 0) {
+        std::cerr << "OpenWeather's answer not shown after the probe" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// How the icon was picked before conditions.h: the description lowercased
+// and searched for keywords, first match wins.
+IconId SelectIconBySubstring(const WeatherData& data, bool night) {
+    std::string desc = data.description.c_str();
+    std::transform(desc.begin(), desc.end(), desc.begin(), ::tolower);
+    auto has = [&](const char* word) { return desc.find(word) != std::string::npos; };
+    if (has("clear")) return night ? IconId::Moon : IconId::Sun;
+    if (has("partly") || has("few cloud") || has("light cloud") || has("scattered cloud"))
+        return night ? IconId::MoonPartlyCloud : IconId::PartlyCloudy;
+    if (has("cloud")) return night ? IconId::MoonCloud : IconId::Cloud;
+    if (has("thunder")) return IconId::Thunder;
+    if (has("drizzle")) return IconId::Drizzle;
+    if (has("rain")) return IconId::Rain;
+    if (has("haze")) return IconId::Haze;
+    if (has("ash")) return IconId::Ash;
+    if (has("smoke")) return IconId::Smoke;
+    if (has("snow")) return IconId::Snow;
+    if (has("fog") || has("mist")) return IconId::Fog;
+    return IconId::Friend;
+}
+
+// The condition table must pick the same icon as the old matching for
+// OpenWeather's descriptions, except where the old order was wrong.
+bool CheckSelectIcon() {
+    struct { int id; const char* description; } cases[] = {
+        {200, "thunderstorm with light rain"}, {211, "thunderstorm"},
+        {300, "light intensity drizzle"}, {500, "light rain"}, {502, "heavy intensity rain"},
+        {600, "light snow"}, {701, "mist"}, {711, "smoke"}, {721, "haze"}, {741, "fog"},
+        {762, "volcanic ash"}, {800, "clear sky"}, {801, "few clouds"},
+        {802, "scattered clouds"}, {803, "broken clouds"}, {804, "overcast clouds"},
+    };
+    bool ok = true;
+    for (const auto& c : cases) {
+        WeatherData data;
+        data.description = c.description;
+        data.condition = c.id;
+        for (bool night : {false, true}) {
+            if (SelectIcon(data, night) != SelectIconBySubstring(data, night)) {
+                std::cerr << "Icon mismatch for " << c.id << " " << c.description << std::endl;
+                ok = false;
+            }
+        }
+    }
+    // "light rain and snow": the old matching found "rain" first.
+    WeatherData sleet;
+    sleet.condition = 615;
+    ok = ok && SelectIcon(sleet, false) == IconId::Snow;
+    return ok;
+}
+
+// The 128x64 screen stays where it was before layouts were resolved, and
+// 256x128 is that design at scale 2, with the 12x24 font for the text.
+bool CheckLayout(LayoutEngine& engine) {
+    struct Expected {
+        int width, height, scale, clock_baseline, temp_center_x, day_baseline, date_baseline;
+        Rect icon;
+    };
+    const Expected expected[] = {
+        {128, 64, 1, 20, 35, 50, 62, Rect(16, 23, 32, 32)},
+        {256, 128, 2, 40, 70, 99, 123, Rect(32, 46, 64, 64)},
+    };
+    for (const Expected& e : expected) {
+        const Layout& l = engine.Resolve(e.width, e.height);
+        if (l.scale != e.scale || l.clock_baseline != e.clock_baseline ||
+            l.temp_center_x != e.temp_center_x || l.day_baseline != e.day_baseline ||
+            l.date_baseline != e.date_baseline || l.icon.x != e.icon.x || l.icon.y != e.icon.y ||
+            l.icon.w != e.icon.w || l.icon.h != e.icon.h) {
+            std::cerr << "Layout for " << e.width << "x" << e.height << " moved: clock "
+                      << l.clock_baseline << ", temperature " << l.temp_center_x << ", day "
+                      << l.day_baseline << ", date " << l.date_baseline << ", icon at "
+                      << l.icon.x << "," << l.icon.y << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// A frame where every layer changes; `i` picks the weather and time.
+FrameUpdate ChangingFrame(const WeatherData* weathers, int i) {
+    static const char* const times[] = {"10:00:00", "11:11:11", "9:59:59", "12:34:56"};
+    FrameUpdate update;
+    update.weather = &weathers[i % 3];
+    update.icon = SelectIcon(weathers[i % 3], i % 2);
+    update.icon_frame = i;
+    update.date = i % 2 ? "10/16/26" : "10/17/26";
+    update.time = times[i % 4];
+    update.forecast = &weathers[i % 3].hourly;
+    update.now = weathers[i % 3].hourly.start(i % 4);
+    return update;
+}
+
+// The day line of `layout`, scrolling through a description too long for it.
+Ticker LongTicker(const Layout& layout) {
+    Ticker ticker(layout.ticker, layout.date_x - layout.ticker.x, layout.day_baseline,
+                  TICKER_SPEED * layout.scale);
+    ticker.SetText(*layout.text_font, "Wednesday  thunderstorm with heavy rain", 0);
+    return ticker;
+}
+
+// Any number of bands, drawn on any number of threads, must give the
+// frames one band gives, including when only the clock changes and with
+// the ticker between two pixels.
+bool CheckTiled(const Layout& layout, const WeatherData* weathers) {
+    WorkPool pool(4);
+    Ticker ticker = LongTicker(layout);
+    for (int bands : {2, 3, 7, BandsForThreads(4, layout.height)}) {
+        TiledRenderer one(layout, 2, 1, pool), tiled(layout, 2, bands, pool);
+        MemoryCanvas one_buffers[2] = {MemoryCanvas(layout.width, layout.height),
+                                       MemoryCanvas(layout.width, layout.height)};
+        MemoryCanvas tiled_buffers[2] = {MemoryCanvas(layout.width, layout.height),
+                                         MemoryCanvas(layout.width, layout.height)};
+        int one_back = 0, tiled_back = 0;
+        for (int i = 0; i < 12; ++i) {
+            FrameUpdate update = ChangingFrame(weathers, i);
+            if (i % 3) update.weather = nullptr, update.date = nullptr, update.forecast = nullptr;
+            if (ticker.Advance(2000000000LL + i * 433000000LL)) update.ticker = &ticker;
+            bool a = one.Render(update, &one_buffers[one_back], false);
+            bool b = tiled.Render(update, &tiled_buffers[tiled_back], true);
+            if (a) one_back ^= 1;
+            if (b) tiled_back ^= 1;
+            const MemoryCanvas& x = one_buffers[one_back ^ 1];
+            const MemoryCanvas& y = tiled_buffers[tiled_back ^ 1];
+            if (a != b || memcmp(x.data(), y.data(), x.size()) != 0) {
+                std::cerr << "Tiled frame " << i << " differs at " << layout.width << "x"
+                          << layout.height << " with " << bands << " bands" << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Still text is drawn just as DrawText() draws it, and scrolling text,
+// at a whole pixel, just as DrawText() a pixel further left each time.
+bool CheckTicker(const Layout& layout) {
+    const rgb_matrix::Color color(255, 160, 0);
+    const Rect& box = layout.ticker;
+    Layer expected(layout.width, layout.height), shown(layout.width, layout.height);
+    Ticker ticker(box, layout.date_x - box.x, layout.day_baseline, TICKER_SPEED);
+    auto same = [&] {
+        uint8_t r1, g1, b1, r2, g2, b2;
+        for (int y = box.y; y < box.bottom(); ++y) {
+            for (int x = box.x; x < box.right(); ++x) {
+                bool a = expected.Get(x, y, r1, g1, b1), b = shown.Get(x, y, r2, g2, b2);
+                if (a != b || (a && (r1 != r2 || g1 != g2 || b1 != b2))) return false;
+            }
+        }
+        return true;
+    };
+
+    ticker.SetText(*layout.text_font, "Friday", 0);
+    DrawText(&expected, *layout.text_font, layout.date_x, layout.day_baseline, color, "Friday");
+    ticker.Draw(&shown, color);
+    if (ticker.scrolls() || !same()) {
+        std::cerr << "Still ticker text differs from DrawText()" << std::endl;
+        return false;
+    }
+
+    const char* text = "Friday  thunderstorm with heavy rain";
+    ticker.SetText(*layout.text_font, text, 0);
+    for (int k = 0; k <= 40; ++k) {
+        // 1/20 s a pixel, after the two seconds at the start
+        ticker.Advance(2000000000LL + k * 50000000LL);
+        expected.Clear();
+        DrawText(&expected, *layout.text_font, layout.date_x - k, layout.day_baseline, color, text);
+        ticker.Draw(&shown, color);
+        if (!ticker.scrolls() || ticker.offset() != (uint32_t)k * 256 || !same()) {
+            std::cerr << "Ticker scrolled " << k << " pixels differs from DrawText()" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Setting an icon or ring again replaces it in place: the old pixels go,
+// and the ones stored after them are still found.
+bool CheckIconReplace() {
+    std::vector<Pixel> a(4 * 4, Pixel{10, 0, 0}), b(4 * 4, Pixel{0, 20, 0}), c(2 * 2, Pixel{0, 0, 30});
+    IconAtlas atlas;
+    atlas.Set(IconId::Sun, a.data(), 4, 4);
+    atlas.Set(IconId::Moon, b.data(), 4, 4);
+    atlas.Set(IconId::Sun, c.data(), 2, 2);
+    IconView sun = atlas.Get(IconId::Sun), moon = atlas.Get(IconId::Moon);
+    bool ok = sun.width == 2 && sun.pixels[3].b == 30 && sun.span_count == 2 &&
+              moon.width == 4 && moon.pixels[15].g == 20 && moon.span_count == 4 &&
+              moon.spans[3].y == 3 && moon.pixels + 16 == sun.pixels;
+
+    IconAnimations animations;
+    animations.Set(IconId::Rain, a.data(), 2, 2, 4);
+    animations.Set(IconId::Snow, b.data(), 4, 4, 1);
+    animations.Set(IconId::Rain, c.data(), 2, 2, 1);
+    IconView rain = animations.Frame(IconId::Rain, 0), snow = animations.Frame(IconId::Snow, 0);
+    ok = ok && animations.frames(IconId::Rain) == 1 && rain.pixels[0].b == 30 &&
+         animations.frames(IconId::Snow) == 1 && snow.pixels[15].g == 20 &&
+         snow.span_count == 4 && snow.pixels + 16 == rain.pixels;
+    if (!ok) std::cerr << "Replacing an icon lost or kept the wrong pixels" << std::endl;
+    return ok;
+}
+
+// Rain falls out of the still icon a row a frame, the cloud staying put,
+// and a new frame redraws no more than the icon's box.
+bool CheckIconAnimations(const Layout& layout, const WeatherData* weathers) {
+    const IconView still = layout.icons->Get(IconId::Rain);
+    std::vector<Pixel> frames;
+    int count = 0;
+    if (!FallingFrames(still, frames, count) || count < 2) {
+        std::cerr << "No falling frames for the rain icon" << std::endl;
+        return false;
+    }
+    const int w = still.width, h = still.height, top = h - count;
+    auto same = [](const Pixel& a, const Pixel& b) { return a.r == b.r && a.g == b.g && a.b == b.b; };
+    for (int k = 0; k < count; ++k) {
+        const Pixel* frame = &frames[(size_t)k * w * h];
+        for (int y = 0; y < h; ++y) {
+            int from = y < top ? y : top + (y - top - k + count) % count;
+            for (int x = 0; x < w; ++x) {
+                if (!same(frame[y * w + x], still.pixels[from * w + x])) {
+                    std::cerr << "Rain frame " << k << " differs at " << x << "," << y << std::endl;
+                    return false;
+                }
+            }
+        }
+    }
+
+    if (!layout.animations || layout.animations->frames(IconId::Rain) == 0) {
+        std::cerr << "The rain icon doesn't move" << std::endl;
+        return false;
+    }
+    WorkPool pool(1);
+    TiledRenderer renderer(layout, 2, 1, pool);
+    MemoryCanvas buffers[2] = {MemoryCanvas(layout.width, layout.height),
+                               MemoryCanvas(layout.width, layout.height)};
+    FrameUpdate update = ChangingFrame(weathers, 0);
+    update.icon = IconId::Rain;
+    renderer.Render(update, &buffers[0], false);
+    // The first frame after it also catches the other buffer up
+    for (int k = 1; k <= 4; ++k) {
+        FrameUpdate next;
+        next.icon = IconId::Rain;
+        next.icon_frame = k;
+        bool drawn = renderer.Render(next, &buffers[k % 2], false);
+        if (!drawn || (k > 1 && renderer.last_area() > layout.icon.w * layout.icon.h)) {
+            std::cerr << "Icon frame " << k << " redrew " << renderer.last_area()
+                      << " pixels" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Counts pixels instead of storing them, so only the drawing code is timed.
+class NullCanvas : public rgb_matrix::Canvas {
+public:
+    int width() const override { return 128; }
+    int height() const override { return 64; }
+    void SetPixel(int, int, uint8_t, uint8_t, uint8_t) override { ++pixels; }
+    void Clear() override {}
+    void Fill(uint8_t, uint8_t, uint8_t) override {}
+
+    size_t pixels = 0;
+};
+
+// Keeps every pixel, for comparing renderers.
+class RecordingCanvas : public rgb_matrix::Canvas {
+public:
+    int width() const override { return 128; }
+    int height() const override { return 64; }
+    void SetPixel(int x, int y, uint8_t r, uint8_t g, uint8_t b) override {
+        if (x < 0 || x >= 128 || y < 0 || y >= 64) return;
+        pixels[y * 128 + x] = (r << 16) | (g << 8) | b | 0x1000000;
+    }
+    void Clear() override { pixels.assign(128 * 64, 0); }
+    void Fill(uint8_t, uint8_t, uint8_t) override {}
+
+    std::vector<uint32_t> pixels = std::vector<uint32_t>(128 * 64, 0);
+};
+
+// The outline renderer clock.cc used before OutlineFont: the text drawn
+// at the eight neighbouring offsets, then on top.
+void DrawTextOutlineNinePass(rgb_matrix::Canvas* canvas, const BitmapFont& font, int x, int y,
+                             const rgb_matrix::Color& outline, const rgb_matrix::Color& fill,
+                             const char* text) {
+    static const int offsets[8][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1},
+                                      {-1, -1}, {1, 1}, {-1, 1}, {1, -1}};
+    for (const auto& d : offsets) DrawText(canvas, font, x + d[0], y + d[1], outline, text);
+    DrawText(canvas, font, x, y, fill, text);
+}
+
+// Single-pass and nine-pass outlines must match pixel for pixel,
+// including text clipped by the canvas edges.
+bool CheckOutline(const BitmapFont& font, const OutlineFont& outline) {
+    const char* texts[] = {"72\xC2\xB0" "F", "-4\xC2\xB0" "C", "108\xC2\xB0" "F", "API error", "", "W"};
+    const int positions[][2] = {{27, 62}, {0, 0}, {-3, 5}, {120, 63}, {60, 70}, {-20, 30}};
+    const rgb_matrix::Color outline_color(255, 80, 0), fill(0, 0, 0);
+    for (const char* text : texts) {
+        for (const auto& pos : positions) {
+            RecordingCanvas expected, actual;
+            DrawTextOutlineNinePass(&expected, font, pos[0], pos[1], outline_color, fill, text);
+            outline.DrawText(&actual, pos[0], pos[1], outline_color, fill, text);
+            if (expected.pixels != actual.pixels) {
+                std::cerr << "Outline mismatch for \"" << text << "\" at "
+                          << pos[0] << "," << pos[1] << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+// LocalTime's counted-on text must match strftime's every second, across
+// DST changes in either direction and with the wall clock stepping back:
+// Los Angeles' hour, Lord Howe Island's half hour, and the same half hour
+// at quarter past and quarter to, where no hour boundary falls.
+bool CheckLocalTime() {
+    const char* old_tz = getenv("TZ");
+    std::string saved = old_tz ? old_tz : "";
+    const struct { const char* tz; int mon, mday, hour; } cases[] = {
+        {"America/Los_Angeles", 9, 31, 23},   // October 31st, the night before DST ends
+        {"Australia/Lord_Howe", 3, 4, 23},    // DST ends at 2:00 on April 5th
+        {"Australia/Lord_Howe", 9, 3, 23},    // and starts at 2:00 on October 4th
+        {"<+1030>-10:30<+11>-11,M10.1.0/2:15,M4.1.0/2:45", 3, 4, 23},
+        {"<+1030>-10:30<+11>-11,M10.1.0/2:15,M4.1.0/2:45", 9, 3, 23},
+    };
+
+    bool ok = true;
+    for (const auto& c : cases) {
+        setenv("TZ", c.tz, 1);
+        tzset();
+        struct tm start_tm = {};
+        start_tm.tm_year = 2026 - 1900;
+        start_tm.tm_mon = c.mon;
+        start_tm.tm_mday = c.mday;
+        start_tm.tm_hour = c.hour;
+        start_tm.tm_isdst = -1;
+        time_t start = mktime(&start_tm);
+
+        LocalTime local;
+        for (int i = 0; ok && i < 4 * 3600; ++i) {
+            time_t now = start + i * 7 - (i >= 2 * 3600 ? 5 * 3600 : 0);
+            local.Update(now);
+            struct tm tm_now;
+            localtime_r(&now, &tm_now);
+            char time_str[16], day_str[32], date_str[16];
+            strftime(time_str, sizeof(time_str), "%-I:%M:%S", &tm_now);
+            strftime(day_str, sizeof(day_str), "%A", &tm_now);
+            strftime(date_str, sizeof(date_str), "%m/%d/%y", &tm_now);
+            if (strcmp(time_str, local.time_str()) || strcmp(day_str, local.day_str()) ||
+                strcmp(date_str, local.date_str()) || tm_now.tm_hour != local.hour()) {
+                std::cerr << "LocalTime in " << c.tz << " at " << now << ": " << local.day_str()
+                          << " " << local.date_str() << " " << local.time_str() << ", strftime: "
+                          << day_str << " " << date_str << " " << time_str << std::endl;
+                ok = false;
+            }
+        }
+    }
+
+    if (old_tz) setenv("TZ", saved.c_str(), 1);
+    else unsetenv("TZ");
+    tzset();
+    return ok;
+}
+
+// The palette must give what the ramp gives for every temperature shown
+// with one decimal, in range or clamped.
+bool CheckTempPalette() {
+    for (int tenths = 0; tenths <= 1300; ++tenths) {
+        char text[16];
+        snprintf(text, sizeof(text), "%.1f", tenths / 10.0);
+        float t = strtof(text, nullptr);
+        rgb_matrix::Color a = TempToColor(t), b = TempToColorRamp(t);
+        if (a.r != b.r || a.g != b.g || a.b != b.b) {
+            std::cerr << "Temperature palette differs from the ramp at " << text << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// With metric units Open-Meteo is asked for °C, the hourly strip still
+// holds °F, and the shown temperature is coloured as its °F equivalent.
+bool CheckMetricTemps(const Layout& layout, const std::string& meteo_forecast) {
+    if (OpenMeteoURL("1", "2", Units::Metric).find("temperature_unit=celsius") == std::string::npos) {
+        std::cerr << "Metric Open-Meteo URL asks for the wrong unit" << std::endl;
+        return false;
+    }
+    HourlyForecast imperial, metric;
+    ParseOpenMeteo(meteo_forecast, &imperial);
+    ParseOpenMeteo(meteo_forecast, &metric, Units::Metric);
+    if (metric.size() != imperial.size() ||
+        metric.temp(0) != CelsiusToFahrenheit(imperial.temp(0))) {
+        std::cerr << "Metric hourly forecast not turned into °F" << std::endl;
+        return false;
+    }
+    const struct { const char* text; float fahrenheit; } temps[] = {
+        {"15.0\xC2\xB0" "C", 59.0f}, {"5.0\xC2\xB0" "C", 41.0f},
+        {"-5.0\xC2\xB0" "C", 23.0f}, {"59.0\xC2\xB0" "F", 59.0f},
+    };
+    for (const auto& t : temps) {
+        WeatherData weather;
+        weather.temp = t.text;
+        rgb_matrix::Color got = PlanTemp(weather, layout, rgb_matrix::Color()).fill;
+        rgb_matrix::Color want = TempToColor(t.fahrenheit);
+        if (got.r != want.r || got.g != want.g || got.b != want.b) {
+            std::cerr << "Temperature " << t.text << " coloured wrong" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// A dimmed frame is the undimmed one passed through the table, and a
+// change of table alone redraws the whole screen from the same layers.
+bool CheckColorLut(const Layout& layout, const WeatherData& weather) {
+    WeatherData weathers[3] = {weather, weather, weather};
+    WorkPool pool(1);
+    TiledRenderer plain(layout, 2, 1, pool), dimmed(layout, 2, 1, pool);
+    ColorLut lut(30, 1.8f);
+    dimmed.SetColorLut(&lut);
+    MemoryCanvas plain_frame(layout.width, layout.height);
+    MemoryCanvas dimmed_frames[2] = {MemoryCanvas(layout.width, layout.height),
+                                     MemoryCanvas(layout.width, layout.height)};
+    FrameUpdate update = ChangingFrame(weathers, 0);
+    plain.Render(update, &plain_frame, false);
+    dimmed.Render(update, &dimmed_frames[0], false);
+
+    ColorLut full;
+    dimmed.SetColorLut(&full);
+    FrameUpdate nothing;
+    bool redrawn = dimmed.Render(nothing, &dimmed_frames[1], false) &&
+                   dimmed.last_area() == layout.width * layout.height;
+
+    const uint8_t* p = plain_frame.data();
+    const uint8_t* d = dimmed_frames[0].data();
+    bool ok = redrawn && memcmp(p, dimmed_frames[1].data(), plain_frame.size()) == 0;
+    for (size_t i = 0; ok && i + 2 < plain_frame.size(); i += 3) {
+        uint8_t r = p[i], g = p[i + 1], b = p[i + 2];
+        lut.Apply(r, g, b);
+        ok = d[i] == r && d[i + 1] == g && d[i + 2] == b;
+    }
+    if (!ok) std::cerr << "Colour table frames differ from the plain ones" << std::endl;
+    return ok;
+}
+
+// Icons show the light they ask for: PanelValue() undoes PanelLight();
+// white at half alpha, or a white and clear checkerboard at twice the
+// size, loads as half the light; and a value dithered over its 4x4
+// pattern is never further from its light than the panel shows it
+// undithered, and on the whole much nearer.
+bool CheckIconLight() {
+    for (int v = 0; v < 256; ++v) {
+        if (PanelValue(PanelLight((uint8_t)v)) != v) {
+            std::cerr << "PanelValue(PanelLight(" << v << ")) is "
+                      << (int)PanelValue(PanelLight((uint8_t)v)) << std::endl;
+            return false;
+        }
+    }
+
+    const std::string half_alpha = "bench/data/half_alpha.png", checker = "bench/data/checker.png";
+    std::vector<unsigned char> rgba(32 * 32 * 4, 255);
+    for (size_t i = 3; i < rgba.size(); i += 4) rgba[i] = 128;
+    lodepng::encode(half_alpha, rgba, 32, 32);
+    rgba.assign(64 * 64 * 4, 0);
+    for (int i = 0; i < 64 * 64; ++i) {
+        if ((i % 64 + i / 64) % 2) std::fill(&rgba[4 * i], &rgba[4 * i + 4], 255);
+    }
+    lodepng::encode(checker, rgba, 64, 64);
+    const uint8_t half = PanelValue(0.5f);
+    for (const std::string& path : {half_alpha, checker}) {
+        IconAtlas atlas;
+        bool loaded = LoadIconFromPNG(path, atlas, IconId::Sun);
+        remove(path.c_str());
+        IconView icon = atlas.Get(IconId::Sun);
+        bool ok = loaded && icon.width == ICON_SIZE && icon.height == ICON_SIZE;
+        for (int i = 0; ok && i < ICON_SIZE * ICON_SIZE; ++i) {
+            const Pixel& p = icon.pixels[i];
+            ok = std::abs(p.r - half) <= 1 && p.r == p.g && p.g == p.b;
+        }
+        if (!ok) {
+            std::cerr << path << " doesn't load as half the light (" << (int)half << ")" << std::endl;
+            return false;
+        }
+    }
+
+    for (int bits : {3, 5, 7, 9}) {
+        PanelDither dither(bits);
+        float plain_total = 0, dithered_total = 0;
+        for (int v = 0; v < 256; ++v) {
+            float shown = 0;
+            for (int y = 0; y < 4; ++y) {
+                for (int x = 0; x < 4; ++x) shown += PanelShown(dither.Apply((uint8_t)v, x, y), bits);
+            }
+            const float light = PanelLight((uint8_t)v);
+            const float plain = std::fabs(PanelShown((uint8_t)v, bits) - light);
+            const float dithered = std::fabs(shown / 16 - light);
+            if (dithered > plain + 1e-6f || dither.Apply(0, v % 4, v / 4 % 4) != 0) {
+                std::cerr << "Dithering " << v << " to " << bits << " PWM bits is off by " << dithered
+                          << " instead of " << plain << std::endl;
+                return false;
+            }
+            plain_total += plain;
+            dithered_total += dithered;
+        }
+        if (dithered_total > plain_total / 4) {
+            std::cerr << "Dithering to " << bits << " PWM bits is off by " << dithered_total
+                      << " in all, " << plain_total << " undithered" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Dimmed, the dithered icons must still average out to the light asked
+// for once the compositor's table has moved them: an icon of 4x4 blocks,
+// one per value, is dithered through the night table and composed with it.
+bool CheckDimmedDither() {
+    const int size = 64;
+    std::vector<Pixel> blocks(size * size);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            const uint8_t v = (uint8_t)(y / 4 * (size / 4) + x / 4);
+            blocks[y * size + x] = {v, v, v};
+        }
+    }
+    IconAtlas source;
+    source.Set(IconId::Sun, blocks.data(), size, size);
+
+    for (int bits : {5, 7}) {
+        for (float gamma : {1.0f, 1.8f}) {
+            const ColorLut lut(BrightnessSchedule().night, gamma);
+            // Off by how much in all, with the icons dithered through `table`
+            auto error = [&](const ColorLut* table, bool dithered) {
+                IconAtlas icons;
+                if (dithered) DitherIcons(source, bits, icons, table);
+                Layer layer(size, size);
+                DrawIcon(&layer, 0, 0, (dithered ? icons : source).Get(IconId::Sun));
+                Compositor compositor(size, size, 1);
+                compositor.AddLayer(&layer);
+                compositor.SetColorLut(&lut);
+                MemoryCanvas frame(size, size);
+                compositor.Compose(&frame);
+                float total = 0;
+                for (int v = 0; v < 256; ++v) {
+                    const int bx = v % (size / 4) * 4, by = v / (size / 4) * 4;
+                    float shown = 0;
+                    for (int y = by; y < by + 4; ++y) {
+                        for (int x = bx; x < bx + 4; ++x)
+                            shown += PanelShown(frame.data()[(y * size + x) * 3], bits);
+                    }
+                    total += std::fabs(shown / 16 - PanelLight(lut.Map((uint8_t)v)));
+                }
+                return total;
+            };
+            const float plain = error(nullptr, false), bright = error(nullptr, true),
+                        dimmed = error(&lut, true);
+            if (dimmed > plain / 4 || dimmed >= bright) {
+                std::cerr << "Dimmed to " << lut.brightness() << "% at gamma " << gamma << ", "
+                          << bits << " PWM bits: dithered through the table off by " << dimmed
+                          << ", without it " << bright << ", undithered " << plain << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// The clock's tick must not touch the heap once the first frames are
+// drawn. Two hours of seconds around midnight, so the date, ticker text,
+// forecast hour and weather layer change on the way, with the rain icon
+// moving on a frame each second. Each tick makes the calls clock.cc's
+// loop makes: the simulated scheduler, the config watcher, night and
+// brightness, IconMap::Select, the frame budgets, rendering and the
+// metrics. The weather worker and a real display swap are left out.
+bool CheckTickAllocations(const Layout& layout, const WeatherData& weather) {
+    WorkPool pool(1);
+    TiledRenderer renderer(layout, 2, 1, pool);
+    MemoryCanvas buffers[2] = {MemoryCanvas(layout.width, layout.height),
+                               MemoryCanvas(layout.width, layout.height)};
+    LocalTime local;
+    WeatherData described = weather;
+    described.description = "thunderstorm with heavy rain";
+    Ticker ticker(layout.ticker, layout.date_x - layout.ticker.x, layout.day_baseline,
+                  TICKER_SPEED * layout.scale);
+    ClockConfig config;
+    char config_path[] = "/tmp/clock_config_XXXXXX";
+    int fd = mkstemp(config_path);
+    if (fd >= 0) close(fd);
+    ConfigWatcher watcher(config_path);
+    FrameBudget ticker_budget(30, 0.25f), icon_budget(10, 0.1f);
+
+    time_t start = time(nullptr);
+    struct tm start_tm;
+    localtime_r(&start, &start_tm);
+    start_tm.tm_hour = 23;
+    start_tm.tm_min = 0;
+    start_tm.tm_sec = 0;
+    start_tm.tm_isdst = -1;
+    start = mktime(&start_tm);
+    TickScheduler scheduler(1, 0);
+    scheduler.Simulate((int64_t)start * 1000000000LL);
+
+    const int WARM_UP = 10, TICKS = 2 * 3600;
+    size_t allocs = 0;
+    int back = 0, brightness = 0;
+    IconId shown_icon = IconId::Count;
+    for (int i = 0; i < TICKS; ++i) {
+        if (i == WARM_UP) allocs = AllocCount();
+        struct timespec due = scheduler.WaitForRender();
+        const time_t now = due.tv_sec;
+        const int64_t due_ns = due.tv_sec * 1000000000LL + due.tv_nsec;
+        if (watcher.Changed()) std::cerr << "Config changed during the check" << std::endl;
+        FrameUpdate update;
+        bool date_changed = local.Update(now);
+        bool night = IsNight(described, now, local.hour());
+        brightness += config.brightness.Level(night, local.hour());
+        if (date_changed) {
+            update.weather = &described;
+            update.date = local.date_str();
+            char text[96];
+            snprintf(text, sizeof(text), "%s  %s", local.day_str(), described.description.c_str());
+            if (ticker.SetText(*layout.text_font, text, due_ns)) update.ticker = &ticker;
+        }
+        if (ticker_budget.Due(due_ns) && ticker.Advance(due_ns)) update.ticker = &ticker;
+        IconId icon = config.icons.Select(described, night);
+        bool icon_frame = icon == shown_icon && icon_budget.Due(due_ns);
+        if (icon != shown_icon || icon_frame) {
+            update.icon = icon;
+            update.icon_frame = i;
+            shown_icon = icon;
+        }
+        if (now % 3600 == 0 || i == 0) {
+            update.forecast = &weather.hourly;
+            update.now = now;
+        }
+        update.time = local.time_str();
+        int64_t render_start = MonotonicNs();
+        bool changed = renderer.Render(update, &buffers[back], false);
+        int64_t render_ns = MonotonicNs() - render_start;
+        (update.weather || update.date ? clockMetrics.static_render : clockMetrics.tick_render)
+            .Record(render_ns);
+        if (update.ticker) ticker_budget.Spent(due_ns, render_ns);
+        if (icon_frame) icon_budget.Spent(due_ns, render_ns);
+        if (changed) {
+            scheduler.WaitForTick();
+            int64_t swap_start = MonotonicNs();
+            back ^= 1;
+            clockMetrics.swap.Record(MonotonicNs() - swap_start);
+            scheduler.Swapped();
+        }
+    }
+    size_t count = AllocCount() - allocs;
+    std::remove(config_path);
+    sink = brightness;
+    if (count != 0) {
+        std::cerr << count << " heap allocations in " << TICKS - WARM_UP
+                  << " ticks after warm-up" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// bench/data/replay_midnight.jsonl, replayed as clock.cc --replay runs it,
+// must give the same frames every time, however slow the frames are to
+// draw. It crosses midnight UTC, where the new date asks for a refresh,
+// and OpenWeather answers that with a 304 that the replay resolves to the
+// 200 it confirmed.
+bool CheckReplay(const Layout& layout) {
+    const char* path = "bench/data/replay_midnight.jsonl";
+    const char* old_tz = getenv("TZ");
+    std::string saved = old_tz ? old_tz : "";
+    setenv("TZ", "UTC", 1);
+    tzset();
+
+    // The checksum of every frame shown, and the weather shown last. The
+    // ticker scrolls, so as in clock.cc the ticks come at its rate and its
+    // frames and the icon's are paced by budgets fixed for replays;
+    // `slow_ns` is added to what each frame is measured to cost.
+    const int RATE = 30, ICON_FPS = 10;
+    auto replay = [&](std::vector<uint64_t>& sums, WeatherData& shown, int64_t slow_ns) {
+        ReplayHttp http;
+        std::string error;
+        if (!http.Load(path, &error)) {
+            std::cerr << error << std::endl;
+            return false;
+        }
+        WeatherWorker worker(WeatherConfig(), "", &http, 1);
+        WorkPool pool(1);
+        TiledRenderer renderer(layout, 2, 1, pool);
+        MemoryCanvas buffers[2] = {MemoryCanvas(layout.width, layout.height),
+                                   MemoryCanvas(layout.width, layout.height)};
+        LocalTime local;
+        Ticker ticker(layout.ticker, layout.date_x - layout.ticker.x, layout.day_baseline,
+                      TICKER_SPEED * layout.scale);
+        FrameBudget ticker_budget(RATE, 0.25f), icon_budget(ICON_FPS, 0.1f);
+        ticker_budget.FixCost(0);
+        icon_budget.FixCost(0);
+        IconMap icons;
+        IconId shown_icon = IconId::Count;
+        int shown_frame = 0, back = 0, dates = 0;
+        const int64_t end_ns = (http.last() + 60) * 1000000000LL;
+        for (int64_t due = http.first() * 1000000000LL; due <= end_ns; due += 1000000000LL / RATE) {
+            const time_t now = due / 1000000000LL;
+            http.SetTime(now);
+            worker.RunUntil(now);
+            FrameUpdate update;
+            bool date_changed = local.Update(now);
+            if (date_changed && now > http.first()) {
+                worker.RequestRefresh();
+                ++dates;
+            }
+            std::unique_ptr<WeatherData> fresh = worker.TakeSnapshot();
+            if (fresh) shown = *fresh;
+            if (fresh || date_changed) {
+                update.weather = &shown;
+                update.date = local.date_str();
+                update.forecast = &shown.hourly;
+                update.now = now;
+                char text[96];
+                snprintf(text, sizeof(text), "%s  %s", local.day_str(), shown.description.c_str());
+                if (ticker.SetText(*layout.text_font, text, due)) update.ticker = &ticker;
+            }
+            if (ticker.scrolls() && ticker_budget.Due(due) && ticker.Advance(due)) {
+                update.ticker = &ticker;
+            }
+            IconId icon = icons.Select(shown, IsNight(shown, now, local.hour()));
+            int frames = layout.animations ? layout.animations->frames(icon) : 0;
+            int frame = frames > 0 ? (int)(due / (1000000000LL / ICON_FPS) % frames) : 0;
+            bool icon_frame = false;
+            if (icon != shown_icon) {
+                update.icon = icon;
+            } else if (frame != shown_frame && icon_budget.Due(due)) {
+                update.icon = icon;
+                icon_frame = true;
+            }
+            if (update.icon != IconId::Count) {
+                update.icon_frame = frame;
+                shown_icon = icon;
+                shown_frame = frame;
+            }
+            update.time = local.time_str();
+            int64_t start = MonotonicNs();
+            bool changed = renderer.Render(update, &buffers[back], false);
+            int64_t cost = MonotonicNs() - start + slow_ns;
+            if (update.ticker) ticker_budget.Spent(due, cost);
+            if (icon_frame) icon_budget.Spent(due, cost);
+            if (changed) {
+                sums.push_back(FrameChecksum(buffers[back].data(), buffers[back].size()));
+                back ^= 1;
+            }
+        }
+        if (dates != 1) std::cerr << "Replay crossed " << dates << " midnights" << std::endl;
+        return dates == 1;
+    };
+
+    // Twice as it runs here, then as if every frame took 50 ms
+    std::vector<uint64_t> first, second, slow;
+    WeatherData first_shown, second_shown, slow_shown;
+    bool ok = replay(first, first_shown, 0) && replay(second, second_shown, 0) &&
+              replay(slow, slow_shown, 50000000);
+    if (ok && (first.empty() || first != second || first != slow)) {
+        std::cerr << "Replaying " << path << " gave different frames on different runs"
+                  << std::endl;
+        ok = false;
+    }
+    // After midnight: Open-Meteo's new reading, OpenWeather's confirmed one
+    if (ok && (strcmp(first_shown.temp.c_str(), "55.4\xC2\xB0" "F") != 0 ||
+               strcmp(first_shown.description.c_str(), "light rain") != 0)) {
+        std::cerr << "Replay ended showing " << first_shown.description << " / "
+                  << first_shown.temp << std::endl;
+        ok = false;
+    }
+    ReplayHttp http;
+    std::string error;
+    if (ok && http.Load(path, &error)) {
+        http.SetTime(http.last());
+        HttpResponse owm = http.PerformAll({{OpenWeatherURL(WeatherConfig().lat, WeatherConfig().lon,
+                                                            "key", Units::Imperial), {}}})[0];
+        if (owm.status != 200 || owm.body.find("light rain") == std::string::npos) {
+            std::cerr << "Recorded 304 replayed as " << owm.status << std::endl;
+            ok = false;
+        }
+    }
+
+    if (old_tz) setenv("TZ", saved.c_str(), 1);
+    else unsetenv("TZ");
+    tzset();
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    std::string json_path;
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--json=", 7) == 0) {
+            json_path = argv[i] + 7;
+        } else if (strncmp(argv[i], "--filter=", 9) == 0) {
+            filter = argv[i] + 9;
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--json=PATH] [--filter=TEXT]" << std::endl;
+            return 1;
+        }
+    }
+
+    const std::string owm = ReadFile("bench/data/owm_current.json");
+    const std::string owm_forecast = ReadFile("bench/data/owm_forecast.json");
+    const std::string meteo = ReadFile("bench/data/meteo_current.json");
+    const std::string meteo_hourly = ReadFile("bench/data/meteo_hourly.json");
+    const std::string meteo_forecast = ReadFile("bench/data/meteo_forecast.json");
+
+    if (!CheckConfig() || !CheckProviderHealth() || !CheckRecordedKey()) return 1;
+    if (!CheckWorkerFailures(ReadFile("bench/data/owm_current.json"),
+                             ReadFile("bench/data/meteo_current.json"))) return 1;
+    if (!CheckParseWeather() ||
+        ParseOpenMeteoTemp(meteo) != ParseOpenMeteoTempDOM(meteo) ||
+        ParseOpenMeteoTemp(meteo_hourly) != ParseOpenMeteoTempDOM(meteo_hourly)) {
+        std::cerr << "Streaming extractor disagrees with the DOM parser" << std::endl;
+        return 1;
+    }
+    HourlyForecast hourly;
+    ParseOpenMeteo(meteo_forecast, &hourly);
+    if (hourly.size() != HourlyForecast::CAPACITY || hourly.temp(0) != 57.1f) {
+        std::cerr << "Hourly forecast parsed wrong: " << hourly.size() << " hours" << std::endl;
+        return 1;
+    }
+
+    std::cout << "--- JSON parse (" << owm.size() << " B current, "
+              << owm_forecast.size() << " B forecast, " << meteo.size() << " B / "
+              << meteo_hourly.size() << " B Open-Meteo) ---" << std::endl;
+
+    Run("ParseWeather/owm_current/dom", [&] {
+        sink = ParseWeatherDOM(owm, Units::Imperial).temp.size();
+    }, owm.size());
+    Run("ParseWeather/owm_current/stream", [&] {
+        sink = ParseWeather(owm, Units::Imperial).temp.size();
+    }, owm.size());
+
+    Run("OpenMeteoTemp/meteo_current/dom", [&] {
+        sink = (size_t)ParseOpenMeteoTempDOM(meteo);
+    }, meteo.size());
+    Run("OpenMeteoTemp/meteo_current/stream", [&] {
+        sink = (size_t)ParseOpenMeteoTemp(meteo);
+    }, meteo.size());
+    Run("OpenMeteoTemp/meteo_hourly/dom", [&] {
+        sink = (size_t)ParseOpenMeteoTempDOM(meteo_hourly);
+    }, meteo_hourly.size());
+    Run("OpenMeteoTemp/meteo_hourly/stream", [&] {
+        sink = (size_t)ParseOpenMeteoTemp(meteo_hourly);
+    }, meteo_hourly.size());
+    // The same request with the hourly arrays copied into the ring as well
+    Run("OpenMeteo/meteo_forecast/current", [&] {
+        sink = (size_t)ParseOpenMeteo(meteo_forecast).temp;
+    }, meteo_forecast.size());
+    Run("OpenMeteo/meteo_forecast/hourly", [&] {
+        HourlyForecast parsed;
+        sink = (size_t)ParseOpenMeteo(meteo_forecast, &parsed).temp + parsed.size();
+    }, meteo_forecast.size());
+
+    // First forecast slot of the 5 day / 3 hour OpenWeather forecast.
+    Run("FirstSlot/owm_forecast/dom", [&] {
+        nlohmann::json j = nlohmann::json::parse(owm_forecast);
+        sink = (size_t)j["list"][0]["main"]["temp"].get<double>() +
+               j["list"][0]["weather"][0]["description"].get<std::string>().size();
+    }, owm_forecast.size());
+    Run("FirstSlot/owm_forecast/stream", [&] {
+        JsonField f[] = {JsonField("list.0.main.temp"),
+                         JsonField("list.0.weather.0.description")};
+        ExtractJsonFields(owm_forecast, f, 2);
+        sink = (size_t)f[0].number + f[1].raw_len;
+    }, owm_forecast.size());
+
+    // What main() does before the first frame: everything from the pack,
+    // or decoding the PNGs and parsing the BDF fonts.
+    std::cout << "--- Startup asset loading ---" << std::endl;
+    AssetPack probe;
+    if (!probe.Open(ASSET_PACK_PATH)) {
+        std::cout << "(no " << ASSET_PACK_PATH << ", run 'make assets')" << std::endl;
+    } else {
+        Run("LoadAssets/pack", [&] {
+            AssetPack pack;
+            pack.Open(ASSET_PACK_PATH);
+            IconAtlas atlas;
+            BitmapFont clock_font, temp_font;
+            LoadIcons(atlas, pack);
+            LoadFont(clock_font, pack, "fonts/12x24.bdf");
+            LoadFont(temp_font, pack, "fonts/6x12.bdf");
+            sink = clock_font.glyph_count() + temp_font.glyph_count();
+        });
+    }
+    Run("LoadAssets/source_files", [&] {
+        AssetPack none;
+        IconAtlas atlas;
+        BitmapFont clock_font, temp_font;
+        LoadIcons(atlas, none);
+        LoadFont(clock_font, none, "fonts/12x24.bdf");
+        LoadFont(temp_font, none, "fonts/6x12.bdf");
+        sink = clock_font.glyph_count() + temp_font.glyph_count();
+    });
+    // Icons as they load, then dithered as for --led-pwm-bits=6
+    if (!CheckIconLight() || !CheckDimmedDither()) return 1;
+    IconAtlas loaded;
+    LoadIcons(loaded, probe);
+    Run("LoadAssets/DitherIcons", [&] {
+        IconAtlas dithered;
+        DitherIcons(loaded, 6, dithered);
+        sink = dithered.Get(IconId::Sun).span_count;
+    });
+
+    // One clock tick's text: measure the time to center it, then draw it.
+    std::cout << "--- Clock text ---" << std::endl;
+    rgb_matrix::Font bdf_font;
+    BitmapFont glyph_cache;
+    if (!bdf_font.LoadFont("fonts/12x24.bdf") || !glyph_cache.LoadFont("fonts/12x24.bdf")) {
+        std::cerr << "Couldn't load fonts/12x24.bdf" << std::endl;
+        return 1;
+    }
+    const rgb_matrix::Color white(255, 255, 255);
+    NullCanvas canvas;
+    Run("ClockText/rgb_matrix_font", [&] {
+        int width = rgb_matrix::DrawText(&canvas, bdf_font, 0, 0, white, nullptr, "12:34:56");
+        rgb_matrix::DrawText(&canvas, bdf_font, (128 - width) / 2, 20, white, nullptr, "12:34:56");
+        sink = canvas.pixels;
+    });
+    Run("ClockText/glyph_cache", [&] {
+        int width = TextWidth(glyph_cache, "12:34:56");
+        DrawText(&canvas, glyph_cache, (128 - width) / 2, 20, white, "12:34:56");
+        sink = canvas.pixels;
+    });
+    Run("TextWidth/glyph_cache", [&] {
+        sink = TextWidth(glyph_cache, "12:34:56");
+    });
+
+    // The temperature readout: 6x12 text with a 1-pixel outline.
+    std::cout << "--- Outlined text ---" << std::endl;
+    BitmapFont temp_font;
+    if (!temp_font.LoadFont("fonts/6x12.bdf")) {
+        std::cerr << "Couldn't load fonts/6x12.bdf" << std::endl;
+        return 1;
+    }
+    OutlineFont temp_outline(temp_font);
+    if (!CheckOutline(temp_font, temp_outline)) return 1;
+    const rgb_matrix::Color orange(255, 165, 0), black(0, 0, 0);
+    Run("TextOutline/nine_pass", [&] {
+        DrawTextOutlineNinePass(&canvas, temp_font, 27, 62, orange, black, "72\xC2\xB0" "F");
+        sink = canvas.pixels;
+    });
+    Run("TextOutline/single_pass", [&] {
+        temp_outline.DrawText(&canvas, 27, 62, orange, black, "72\xC2\xB0" "F");
+        sink = canvas.pixels;
+    });
+    // Into the layer the clock actually draws on.
+    Layer layer(128, 64);
+    Run("TextOutline/nine_pass/layer", [&] {
+        DrawTextOutlineNinePass(&layer, temp_font, 27, 62, orange, black, "72\xC2\xB0" "F");
+        Damage damage;
+        layer.TakeDamage(damage);
+    });
+    Run("TextOutline/single_pass/layer", [&] {
+        temp_outline.DrawText(&layer, 27, 62, orange, black, "72\xC2\xB0" "F");
+        Damage damage;
+        layer.TakeDamage(damage);
+    });
+    size_t before = canvas.pixels;
+    DrawTextOutlineNinePass(&canvas, temp_font, 27, 62, orange, black, "72\xC2\xB0" "F");
+    size_t nine_pass = canvas.pixels - before;
+    before = canvas.pixels;
+    temp_outline.DrawText(&canvas, 27, 62, orange, black, "72\xC2\xB0" "F");
+    std::cout << "SetPixel calls: " << nine_pass << " nine-pass, "
+              << canvas.pixels - before << " single-pass" << std::endl;
+
+    // The functions main() calls each tick or on weather/date changes,
+    // drawing into memory as in headless mode.
+    std::cout << "--- Render ---" << std::endl;
+    AssetPack pack;
+    pack.Open(ASSET_PACK_PATH);
+    LoadIcons(iconAtlas, pack);
+    IconAnimations iconAnimations;
+    LoadAnimations(iconAnimations, iconAtlas, pack);
+    LayoutEngine layout_engine({&temp_font, &glyph_cache}, iconAtlas, &iconAnimations);
+    if (!CheckLayout(layout_engine)) return 1;
+    MemoryCanvas frame(128, 64);
+    WeatherData weather{"light rain", "58.3\xC2\xB0" "F"};
+    weather.condition = 500;
+    weather.hourly = hourly;
+    rgb_matrix::Color clock_color(255, 255, 255), outline_color(0, 0, 0), rain_color(0, 40, 120);
+
+    if (!CheckTempPalette()) return 1;
+    int temp_i = 0;
+    Run("Render/TempToColor/ramp", [&] {
+        rgb_matrix::Color c = TempToColorRamp(20.0f + (temp_i++ % 100));
+        sink = c.r + c.g + c.b;
+    });
+    Run("Render/TempToColor/table", [&] {
+        rgb_matrix::Color c = TempToColor(20.0f + (temp_i++ % 100));
+        sink = c.r + c.g + c.b;
+    });
+    Run("Render/MeasureTextWidth", [&] {
+        sink = MeasureTextWidth(temp_font, weather.temp.c_str());
+    });
+    if (!CheckSelectIcon()) {
+        std::cerr << "Condition table disagrees with description matching" << std::endl;
+        return 1;
+    }
+    Run("Render/SelectIcon/substring", [&] {
+        sink = (size_t)SelectIconBySubstring(weather, false);
+    });
+    Run("Render/SelectIcon/table", [&] {
+        sink = (size_t)SelectIcon(weather, false);
+    });
+    Run("Render/DrawIcon", [&] {
+        DrawIcon(&frame, 16, 23, iconAtlas.Get(IconId::Rain));
+    });
+    Run("Render/DrawTextOutline", [&] {
+        DrawTextOutline(&frame, temp_outline, 27, 62, orange, black, weather.temp.c_str());
+    });
+    // Resolving for a new size, scaled fonts and icons included; after
+    // that the layout is only looked up.
+    int size_i = 0;
+    Run("Render/LayoutResolve", [&] {
+        int s = 1 + size_i++ % 2;
+        sink = layout_engine.Resolve(128 * s, 64 * s).scale;
+    });
+    const Layout& layout = layout_engine.Resolve(128, 64);
+    if (!CheckMetricTemps(layout, meteo_forecast)) return 1;
+
+    Layer weather_layer(128, 64), date_layer(128, 64), forecast_layer(128, 64),
+          clock_layer(128, 64), icon_layer(128, 64);
+    Run("Render/UpdateWeatherLayer", [&] {
+        UpdateWeatherLayer(&weather_layer, weather, layout, outline_color);
+        Damage damage;
+        weather_layer.TakeDamage(damage);
+    });
+    Run("Render/UpdateForecastLayer", [&] {
+        UpdateForecastLayer(&forecast_layer, hourly, hourly.start(0), layout, rain_color);
+        Damage damage;
+        forecast_layer.TakeDamage(damage);
+    });
+    Run("Render/UpdateDateLayer", [&] {
+        UpdateDateLayer(&date_layer, "10/16/26", layout, clock_color);
+        Damage damage;
+        date_layer.TakeDamage(damage);
+    });
+
+    // A whole one-second tick: the time moves on by a second, the clock
+    // layer updates the changed glyphs and the damage is recomposed into
+    // one of two alternating buffers.
+    Compositor compositor(128, 64);
+    compositor.AddLayer(&date_layer);
+    compositor.AddLayer(&icon_layer);
+    compositor.AddLayer(&weather_layer);
+    compositor.AddLayer(&clock_layer);
+    MemoryCanvas buffers[2] = {MemoryCanvas(128, 64), MemoryCanvas(128, 64)};
+    ShownTime shown;
+    LocalTime local_time;
+    int seconds = 0, back = 0;
+    char time_str[16];
+    Run("Render/Tick", [&] {
+        int t = 10 * 3600 + seconds++ % 3600;
+        snprintf(time_str, sizeof(time_str), "%d:%02d:%02d", t / 3600, t / 60 % 60, t % 60);
+        UpdateClockLayer(&clock_layer, layout, clock_color, time_str, shown);
+        if (compositor.Compose(&buffers[back])) back ^= 1;
+    });
+    if (!CheckLocalTime() || !CheckTickAllocations(layout, weather)) return 1;
+    if (!CheckReplay(layout)) return 1;
+    // One 60 fps frame of the scrolling day line, drawn and composed from
+    // the strip, and drawing a new text into the strip.
+    if (!CheckTicker(layout)) return 1;
+    Layer ticker_layer(128, 64);
+    Compositor ticker_compositor(128, 64);
+    ticker_compositor.AddLayer(&ticker_layer);
+    Ticker ticker = LongTicker(layout);
+    int64_t ticker_ns = 2000000000LL;
+    Run("Render/Ticker/Frame", [&] {
+        ticker.Advance(ticker_ns += 16666667);
+        ticker.Draw(&ticker_layer, clock_color);
+        if (ticker_compositor.Compose(&buffers[back])) back ^= 1;
+    });
+    int text_i = 0;
+    Run("Render/Ticker/SetText", [&] {
+        sink = ticker.SetText(*layout.text_font, text_i++ % 2 ? "Thursday  light rain"
+                                                              : "Friday  overcast clouds", 0);
+    });
+    // The next frame of the rain icon, drawn into its own layer and
+    // composed.
+    WeatherData weathers[3] = {weather, weather, weather};
+    if (!CheckIconReplace() || !CheckIconAnimations(layout, weathers)) return 1;
+    int icon_frame = 0;
+    Run("Render/IconFrame", [&] {
+        UpdateIconLayer(&icon_layer, layout, IconId::Rain, icon_frame++);
+        if (compositor.Compose(&buffers[back])) back ^= 1;
+    });
+    Run("Render/LocalTime", [&] {
+        sink = local_time.Update(1792000000 + seconds++) + local_time.time_str()[0];
+    });
+    // The same with every layer redrawn, as after a weather update.
+    Run("Render/FullFrame", [&] {
+        UpdateIconLayer(&icon_layer, layout, SelectIcon(weather, false), 0);
+        UpdateWeatherLayer(&weather_layer, weather, layout, outline_color);
+        UpdateDateLayer(&date_layer, "10/16/26", layout, clock_color);
+        shown = ShownTime();
+        UpdateClockLayer(&clock_layer, layout, clock_color, "10:00:00", shown);
+        if (compositor.Compose(&buffers[back])) back ^= 1;
+    });
+    // A new brightness: the whole screen recomposed through the colour
+    // table, no layer redrawn.
+    if (!CheckColorLut(layout, weather)) return 1;
+    ColorLut dims[2] = {ColorLut(100), ColorLut(40, 2.2f)};
+    int dim_i = 0;
+    Run("Render/Brightness", [&] {
+        compositor.SetColorLut(&dims[dim_i++ % 2]);
+        if (compositor.Compose(&buffers[back])) back ^= 1;
+    });
+    compositor.SetColorLut(nullptr);
+
+    // Every layer redrawn through the tiled renderer, at growing wall sizes
+    // and on 1, 2 and 4 threads.
+    std::cout << "--- Tiled render (" << std::thread::hardware_concurrency() << " cores) ---"
+              << std::endl;
+    weathers[1].temp = "101.2\xC2\xB0" "F";
+    weathers[1].condition = 800;
+    weathers[2].temp = "-3.0\xC2\xB0" "F";
+    weathers[2].condition = 601;
+    weathers[2].hourly.DropBefore(hourly.start(2));
+    const int sizes[][2] = {{128, 64}, {256, 128}, {512, 256}};
+    for (const auto& size : sizes) {
+        const int w = size[0], h = size[1];
+        LayoutEngine wall_engine({&temp_font, &glyph_cache}, iconAtlas, &iconAnimations);
+        const Layout& wall = wall_engine.Resolve(w, h);
+        if (!CheckTiled(wall, weathers)) return 1;
+
+        for (int threads : {1, 2, 4}) {
+            WorkPool pool(threads);
+            TiledRenderer renderer(wall, 2, BandsForThreads(threads, h), pool);
+            MemoryCanvas wall_buffers[2] = {MemoryCanvas(w, h), MemoryCanvas(w, h)};
+            int frame_i = 0, wall_back = 0;
+            std::string name = "Tiled/FullFrame/" + std::to_string(w) + "x" + std::to_string(h) +
+                               "/" + std::to_string(threads) + "t";
+            Run(name, [&] {
+                FrameUpdate update = ChangingFrame(weathers, frame_i++);
+                if (renderer.Render(update, &wall_buffers[wall_back], true)) wall_back ^= 1;
+            }, (size_t)w * h * 3);
+        }
+    }
+
+    // What instrumenting the tick costs, and one rewrite of the metrics file
+    std::cout << "--- Metrics ---" << std::endl;
+    LatencyHistogram histogram;
+    Run("Metrics/TimeAndRecord", [&] {
+        int64_t start = MonotonicNs();
+        histogram.Record(MonotonicNs() - start);
+    });
+    ClockMetrics metrics;
+    for (int i = 0; i < 1000; ++i) metrics.tick_render.Record(i * 997);
+    Run("Metrics/WriteMetrics", [&] {
+        std::ostringstream text;
+        WriteMetrics(text, metrics, 0);
+    });
+
+    if (!json_path.empty() && !WriteJson(json_path)) {
+        std::cerr << "Couldn't write " << json_path << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,306 @@
+#include "bitmap_font.h"
+#include "compositor.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace {
+
+const uint32_t REPLACEMENT_CODEPOINT = 0xFFFD;
+
+// Records what rgb_matrix::Font draws, one 32-bit mask per row. The origin
+// sits in the middle so glyphs reaching above or below the cell still fit.
+class GlyphCapture : public rgb_matrix::Canvas {
+public:
+    static const int ROWS = 128;
+    static const int ORIGIN = ROWS / 2;
+
+    int width() const override { return 32; }
+    int height() const override { return ROWS; }
+    void SetPixel(int x, int y, uint8_t, uint8_t, uint8_t) override {
+        if (x < 0 || x >= 32 || y < 0 || y >= ROWS) return;
+        rows[y] |= 0x80000000u >> x;
+    }
+    void Clear() override { memset(rows, 0, sizeof(rows)); }
+    void Fill(uint8_t, uint8_t, uint8_t) override {}
+
+    uint32_t rows[ROWS];
+};
+
+// ORs a row mask whose bit 63 is column `col` into a bitset of `words`
+// 64-bit words, bit 63 of word 0 being column 0. Columns outside the
+// bitset are dropped.
+void OrRow(uint64_t* row, int words, int col, uint64_t bits) {
+    if (col < 0) {
+        if (col <= -64) return;
+        bits <<= -col;
+        col = 0;
+    }
+    int w = col / 64, shift = col % 64;
+    if (w >= words) return;
+    row[w] |= bits >> shift;
+    if (shift && w + 1 < words) row[w + 1] |= bits << (64 - shift);
+}
+
+}  // namespace
+
+std::vector<uint32_t> FontSubset() {
+    std::vector<uint32_t> subset;
+    for (uint32_t c = 0x20; c < 0x7F; ++c) subset.push_back(c);
+    subset.push_back(0xB0);  // degree sign
+    subset.push_back(REPLACEMENT_CODEPOINT);
+    return subset;
+}
+
+void BitmapFont::Attach(int height, int baseline,
+                        const GlyphBitmap* glyphs, size_t glyph_count, const uint32_t* rows) {
+    height_ = height;
+    baseline_ = baseline;
+    glyphs_ = glyphs;
+    glyph_count_ = glyph_count;
+    rows_ = rows;
+    BuildIndex();
+}
+
+void BitmapFont::Adopt(int height, int baseline,
+                       std::vector<GlyphBitmap> glyphs, std::vector<uint32_t> rows) {
+    std::sort(glyphs.begin(), glyphs.end(),
+              [](const GlyphBitmap& a, const GlyphBitmap& b) { return a.codepoint < b.codepoint; });
+    owned_glyphs_ = std::move(glyphs);
+    owned_rows_ = std::move(rows);
+    Attach(height, baseline, owned_glyphs_.data(), owned_glyphs_.size(), owned_rows_.data());
+}
+
+bool BitmapFont::LoadFont(const char* path) {
+    rgb_matrix::Font font;
+    if (!font.LoadFont(path)) return false;
+
+    std::vector<GlyphBitmap> glyphs;
+    std::vector<uint32_t> rows;
+    GlyphCapture capture;
+    const rgb_matrix::Color white(255, 255, 255);
+
+    for (uint32_t cp : FontSubset()) {
+        int advance = font.CharacterWidth(cp);
+        if (advance < 0) continue;  // would draw the replacement glyph
+
+        capture.Clear();
+        font.DrawGlyph(&capture, 0, GlyphCapture::ORIGIN, white, cp);
+
+        int first = 0, last = GlyphCapture::ROWS - 1;
+        while (first <= last && !capture.rows[first]) ++first;
+        while (last >= first && !capture.rows[last]) --last;
+
+        GlyphBitmap g = {};
+        g.codepoint = cp;
+        g.advance = (int16_t)advance;
+        g.first_row = (uint32_t)rows.size();
+        if (first <= last) {
+            g.top = (int16_t)(first - GlyphCapture::ORIGIN);
+            g.row_count = (uint16_t)(last - first + 1);
+            rows.insert(rows.end(), capture.rows + first, capture.rows + last + 1);
+        }
+        glyphs.push_back(g);
+    }
+
+    Adopt(font.height(), font.baseline(), std::move(glyphs), std::move(rows));
+    return true;
+}
+
+bool BitmapFont::Scale(const BitmapFont& font, int factor) {
+    if (factor < 1 || font.InkWidth() * factor > 32) return false;
+
+    std::vector<GlyphBitmap> glyphs;
+    std::vector<uint32_t> rows;
+    glyphs.reserve(font.glyph_count());
+    for (size_t i = 0; i < font.glyph_count(); ++i) {
+        GlyphBitmap g = font.glyphs()[i];
+        const uint32_t* src = font.Rows(g);
+        g.advance = (int16_t)(g.advance * factor);
+        g.top = (int16_t)(g.top * factor);
+        g.row_count = (uint16_t)(g.row_count * factor);
+        g.first_row = (uint32_t)rows.size();
+        for (int r = 0; r < g.row_count; ++r) {
+            uint32_t in = src[r / factor], out = 0;
+            for (uint32_t bits = in; bits;) {
+                int col = __builtin_clz(bits);
+                for (int k = 0; k < factor; ++k) out |= 0x80000000u >> (col * factor + k);
+                bits &= ~(0x80000000u >> col);
+            }
+            rows.push_back(out);
+        }
+        glyphs.push_back(g);
+    }
+
+    Adopt(font.height() * factor, font.baseline() * factor, std::move(glyphs), std::move(rows));
+    return true;
+}
+
+int BitmapFont::InkWidth() const {
+    uint32_t ink = 0;
+    for (size_t i = 0; i < glyph_count_; ++i) {
+        const uint32_t* rows = Rows(glyphs_[i]);
+        for (int r = 0; r < glyphs_[i].row_count; ++r) ink |= rows[r];
+    }
+    return ink ? 32 - __builtin_ctz(ink) : 0;
+}
+
+void BitmapFont::BuildIndex() {
+    for (int16_t& i : ascii_) i = -1;
+    for (size_t i = 0; i < glyph_count_; ++i) {
+        if (glyphs_[i].codepoint < 128) ascii_[glyphs_[i].codepoint] = (int16_t)i;
+    }
+}
+
+const GlyphBitmap* BitmapFont::Find(uint32_t codepoint) const {
+    if (codepoint < 128) {
+        return ascii_[codepoint] < 0 ? nullptr : &glyphs_[ascii_[codepoint]];
+    }
+    const GlyphBitmap* end = glyphs_ + glyph_count_;
+    const GlyphBitmap* it = std::lower_bound(
+        glyphs_, end, codepoint,
+        [](const GlyphBitmap& g, uint32_t cp) { return g.codepoint < cp; });
+    return (it != end && it->codepoint == codepoint) ? it : nullptr;
+}
+
+int BitmapFont::CharacterWidth(uint32_t codepoint) const {
+    const GlyphBitmap* g = Find(codepoint);
+    return g ? g->advance : -1;
+}
+
+const GlyphBitmap* BitmapFont::Glyph(uint32_t codepoint) const {
+    const GlyphBitmap* g = Find(codepoint);
+    return g ? g : Find(REPLACEMENT_CODEPOINT);
+}
+
+int BitmapFont::DrawGlyph(rgb_matrix::Canvas* canvas, int x, int y,
+                          const rgb_matrix::Color& color, uint32_t codepoint) const {
+    const GlyphBitmap* g = Glyph(codepoint);
+    if (!g) return 0;
+
+    // Only the rows the canvas keeps, and within them jump straight from
+    // one lit pixel to the next instead of testing every column.
+    const Rect area = DrawableArea(canvas);
+    const int top = y + g->top;
+    const int first = std::max(0, area.y - top), end = std::min<int>(g->row_count, area.bottom() - top);
+    const uint32_t* rows = Rows(*g);
+    for (int r = first; r < end; ++r) {
+        for (uint32_t bits = rows[r]; bits;) {
+            int col = __builtin_clz(bits);
+            canvas->SetPixel(x + col, y + g->top + r, color.r, color.g, color.b);
+            bits &= ~(0x80000000u >> col);
+        }
+    }
+    return g->advance;
+}
+
+uint32_t NextCodepoint(const char*& text) {
+    uint32_t cp = (uint8_t)*text++;
+    int extra = 0;
+    if (cp >= 0xF0) { cp &= 0x07; extra = 3; }
+    else if (cp >= 0xE0) { cp &= 0x0F; extra = 2; }
+    else if (cp >= 0xC0) { cp &= 0x1F; extra = 1; }
+    for (; extra > 0 && (*text & 0xC0) == 0x80; --extra) {
+        cp = (cp << 6) | (*text++ & 0x3F);
+    }
+    return cp;
+}
+
+int TextWidth(const BitmapFont& font, const char* utf8_text) {
+    int width = 0;
+    while (*utf8_text) width += font.Advance(NextCodepoint(utf8_text));
+    return width;
+}
+
+int DrawText(rgb_matrix::Canvas* canvas, const BitmapFont& font, int x, int y,
+             const rgb_matrix::Color& color, const char* utf8_text) {
+    const int start = x;
+    while (*utf8_text) {
+        x += font.DrawGlyph(canvas, x, y, color, NextCodepoint(utf8_text));
+    }
+    return x - start;
+}
+
+// --- Outlined text ---
+OutlineFont::OutlineFont(const BitmapFont& font) : font_(font) {
+    first_row_.reserve(font.glyph_count());
+    for (size_t i = 0; i < font.glyph_count(); ++i) {
+        const GlyphBitmap& g = font.glyphs()[i];
+        const uint32_t* src = font.Rows(g);
+        first_row_.push_back((uint32_t)rows_.size());
+
+        // Grow each row sideways, then OR each output row with the rows
+        // above and below it.
+        auto spread = [&](int r) -> uint64_t {
+            if (r < 0 || r >= g.row_count) return 0;
+            uint64_t bits = (uint64_t)src[r] << 31;  // column 0 at bit 62
+            return bits | (bits << 1) | (bits >> 1);
+        };
+        for (int r = -1; r <= g.row_count; ++r) {
+            rows_.push_back(spread(r - 1) | spread(r) | spread(r + 1));
+        }
+    }
+}
+
+int OutlineFont::DrawText(rgb_matrix::Canvas* canvas, int x, int y,
+                          const rgb_matrix::Color& outline_color,
+                          const rgb_matrix::Color& text_color,
+                          const char* utf8_text) const {
+    // Lay the text out once; every row below walks this list.
+    struct Placed {
+        const GlyphBitmap* glyph;
+        int x;
+    };
+    thread_local std::vector<Placed> layout;
+    layout.clear();
+    int pen = x, top = 0, bottom = 0;
+    for (const char* p = utf8_text; *p;) {
+        const GlyphBitmap* g = font_.Glyph(NextCodepoint(p));
+        if (!g) continue;
+        if (g->row_count) {
+            layout.push_back(Placed{g, pen});
+            top = std::min(top, g->top - 1);
+            bottom = std::max(bottom, g->top + g->row_count + 1);
+        }
+        pen += g->advance;
+    }
+
+    const int canvas_width = canvas->width();
+    const int words = (canvas_width + 63) / 64;
+    thread_local std::vector<uint64_t> fill, edge;
+    fill.resize(words);
+    edge.resize(words);
+
+    const Rect area = DrawableArea(canvas);
+    const int first_row = std::max(y + top, area.y);
+    const int last_row = std::min(y + bottom, area.bottom());
+    for (int row = first_row; row < last_row; ++row) {
+        std::fill(fill.begin(), fill.end(), 0);
+        std::fill(edge.begin(), edge.end(), 0);
+
+        // Build this row of the whole string, so pixels where one glyph's
+        // outline meets the next glyph are resolved before drawing.
+        for (const Placed& placed : layout) {
+            const GlyphBitmap& g = *placed.glyph;
+            int r = row - y - g.top;
+            if (r < -1 || r > g.row_count) continue;
+            if (r >= 0 && r < g.row_count) {
+                OrRow(fill.data(), words, placed.x, (uint64_t)font_.Rows(g)[r] << 32);
+            }
+            OrRow(edge.data(), words, placed.x - 1, Dilated(g)[r + 1]);
+        }
+
+        for (int w = 0; w < words; ++w) {
+            for (uint64_t bits = fill[w] | edge[w]; bits;) {
+                int lead = __builtin_clzll(bits);
+                int col = w * 64 + lead;
+                if (col >= canvas_width) break;
+                uint64_t bit = 1ull << (63 - lead);
+                const rgb_matrix::Color& c = (fill[w] & bit) ? text_color : outline_color;
+                canvas->SetPixel(col, row, c.r, c.g, c.b);
+                bits &= ~bit;
+            }
+        }
+    }
+    return pen - x;
+}
@@ -0,0 +1,126 @@
+#ifndef BITMAP_FONT_H
+#define BITMAP_FONT_H
+
+#include "canvas.h"
+#include "graphics.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// One glyph as a stack of 1-bit rows, bit 31 being the leftmost column.
+// Plain old data so it can be stored in the asset pack as is.
+struct GlyphBitmap {
+    uint32_t codepoint;
+    int16_t advance;     // pen advance in pixels
+    int16_t top;         // first row, relative to the baseline
+    uint16_t row_count;
+    uint16_t reserved;
+    uint32_t first_row;  // index into the font's row array
+};
+
+// Codepoints the clock can display: printable ASCII, the degree sign and
+// the replacement character. Only these are kept from the BDF files.
+std::vector<uint32_t> FontSubset();
+
+// Fixed-size bitmap font drawing exactly like rgb_matrix::Font, but from a
+// compact glyph table that is either borrowed (e.g. from the mapped asset
+// pack) or rasterized once from a BDF font.
+class BitmapFont {
+public:
+    // Borrows the arrays; `glyphs` must be sorted by codepoint.
+    void Attach(int height, int baseline,
+                const GlyphBitmap* glyphs, size_t glyph_count, const uint32_t* rows);
+
+    // Takes ownership of the arrays and sorts the glyphs.
+    void Adopt(int height, int baseline,
+               std::vector<GlyphBitmap> glyphs, std::vector<uint32_t> rows);
+
+    // Loads a BDF font through rgb_matrix::Font and rasterizes FontSubset().
+    bool LoadFont(const char* path);
+
+    // Copies `font` with every pixel grown to factor x factor. Returns
+    // false if the glyphs would not fit in 32 columns.
+    bool Scale(const BitmapFont& font, int factor);
+
+    // Columns the widest glyph covers, from column 0.
+    int InkWidth() const;
+
+    int height() const { return height_; }
+    int baseline() const { return baseline_; }
+
+    const GlyphBitmap* Find(uint32_t codepoint) const;
+    // Advance of `codepoint`, or -1 if the font doesn't have it.
+    int CharacterWidth(uint32_t codepoint) const;
+
+    // The glyph DrawGlyph() draws for `codepoint`: its own, else the
+    // replacement character, else nullptr (nothing is drawn).
+    const GlyphBitmap* Glyph(uint32_t codepoint) const;
+    // How far DrawGlyph() moves the pen for `codepoint`.
+    int Advance(uint32_t codepoint) const {
+        const GlyphBitmap* g = Glyph(codepoint);
+        return g ? g->advance : 0;
+    }
+
+    const uint32_t* Rows(const GlyphBitmap& glyph) const { return rows_ + glyph.first_row; }
+    const GlyphBitmap* glyphs() const { return glyphs_; }
+    size_t glyph_count() const { return glyph_count_; }
+
+    // Draws one glyph with its baseline at y; returns the advance.
+    int DrawGlyph(rgb_matrix::Canvas* canvas, int x, int y,
+                  const rgb_matrix::Color& color, uint32_t codepoint) const;
+
+private:
+    void BuildIndex();
+
+    int height_ = 0;
+    int baseline_ = 0;
+    const GlyphBitmap* glyphs_ = nullptr;
+    size_t glyph_count_ = 0;
+    const uint32_t* rows_ = nullptr;
+    int16_t ascii_[128];  // index into glyphs_ for codepoints < 128, or -1
+
+    std::vector<GlyphBitmap> owned_glyphs_;
+    std::vector<uint32_t> owned_rows_;
+};
+
+// The glyphs of a BitmapFont grown by one pixel in all eight directions,
+// for drawing outlined text in a single pass. Built once per font; the
+// font must outlive it.
+class OutlineFont {
+public:
+    explicit OutlineFont(const BitmapFont& font);
+
+    const BitmapFont& font() const { return font_; }
+
+    // Draws the text in text_color with a 1-pixel outline_color border,
+    // setting every pixel once. The result is the same as drawing the
+    // text in outline_color at the eight neighbouring offsets and then in
+    // text_color on top. Returns the width like DrawText().
+    int DrawText(rgb_matrix::Canvas* canvas, int x, int y,
+                 const rgb_matrix::Color& outline_color, const rgb_matrix::Color& text_color,
+                 const char* utf8_text) const;
+
+private:
+    // Dilated rows of glyph i start at first_row_[i] and span row_count + 2
+    // rows from its top - 1. Bit 63 is the column left of the glyph.
+    const uint64_t* Dilated(const GlyphBitmap& glyph) const {
+        return rows_.data() + first_row_[&glyph - font_.glyphs()];
+    }
+
+    const BitmapFont& font_;
+    std::vector<uint64_t> rows_;
+    std::vector<uint32_t> first_row_;
+};
+
+// Decodes the next UTF-8 codepoint and advances `text`.
+uint32_t NextCodepoint(const char*& text);
+
+// Width DrawText() would return for the text, without drawing it.
+int TextWidth(const BitmapFont& font, const char* utf8_text);
+
+// Same contract as rgb_matrix::DrawText: baseline at y, returns the width.
+int DrawText(rgb_matrix::Canvas* canvas, const BitmapFont& font, int x, int y,
+             const rgb_matrix::Color& color, const char* utf8_text);
+
+#endif
@@ -1,8 +1,26 @@
 #include "led-matrix.h"
 #include "graphics.h"
 
+#include "assets.h"
+#include "bitmap_font.h"
+#include "color_lut.h"
+#include "conditions.h"
+#include "config.h"
+#include "display.h"
+#include "icons.h"
+#include "layout.h"
+#include "local_time.h"
+#include "metrics.h"
+#include "render.h"
+#include "replay.h"
+#include "scheduler.h"
+#include "ticker.h"
+#include "tiled_renderer.h"
+#include "weather.h"
+
 #include <curl/curl.h>
-#include <nlohmann/json.hpp>
+#include <signal.h>
+#include <sys/resource.h>
 #include <unistd.h>
 #include <time.h>
 #include <sstream>
@@ -10,669 +28,563 @@
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
+#include <chrono>
 #include <cmath>
-#include "lodepng.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
 // g++ -o clock clock.cc -I../include -L../lib -lrgbmatrix -lcurl
 
 using rgb_matrix::Canvas;
 using rgb_matrix::RGBMatrix;
-using rgb_matrix::Font;
 using rgb_matrix::Color;
 
-enum class Units { Metric, Imperial };
-
-const int LEFT_PANEL_WIDTH = 64;
-const int RIGHT_PANEL_X = 64;
-const int TOTAL_WIDTH = 128;
-const int ICON_SIZE = 32;
-
-
-
-struct Pixel {
-    uint8_t r, g, b;
-};
-
-// Icon buffers
-Pixel sunIcon[ICON_SIZE][ICON_SIZE];
-Pixel moonIcon[ICON_SIZE][ICON_SIZE];
-Pixel cloudIcon[ICON_SIZE][ICON_SIZE];
-Pixel rainIcon[ICON_SIZE][ICON_SIZE];
-Pixel snowIcon[ICON_SIZE][ICON_SIZE];
-Pixel fogIcon[ICON_SIZE][ICON_SIZE];
-Pixel partlyCloudyIcon[ICON_SIZE][ICON_SIZE];
-Pixel drizzleIcon[ICON_SIZE][ICON_SIZE];
-Pixel thunderIcon[ICON_SIZE][ICON_SIZE];
-Pixel friendIcon[ICON_SIZE][ICON_SIZE];
-Pixel hazeIcon[ICON_SIZE][ICON_SIZE];
-Pixel ashIcon[ICON_SIZE][ICON_SIZE];
-Pixel smokeIcon[ICON_SIZE][ICON_SIZE];
-Pixel moonCloudIcon[ICON_SIZE][ICON_SIZE];
-Pixel moonPartlyCloudIcon[ICON_SIZE][ICON_SIZE];
-
-
-// --- Weather Fetch Helpers ---
-static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
-    ((std::string*)userp)->append((char*)contents, size * nmemb);
-    return size * nmemb;
-}
-
-
-std::string GetWeather(const std::string& lat, const std::string& lon,
-                       const std::string& api_key, Units units) {
-    CURL* curl;
-    CURLcode res;
-    std::string readBuffer;
-
-    curl = curl_easy_init();
-    if (curl) {
-        std::ostringstream url;
-		url << "http://api.openweathermap.org/data/2.5/weather?lat="
-			<< lat << "&lon=" << lon
-			<< "&appid=" << api_key
-			<< "&units=" << (units == Units::Metric ? "metric" : "imperial");
-
-
-        curl_easy_setopt(curl, CURLOPT_URL, url.str().c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
-
-        res = curl_easy_perform(curl);
-        if (res != CURLE_OK) {
-            std::cerr << "curl error: " << curl_easy_strerror(res) << std::endl;
-        }
-        curl_easy_cleanup(curl);
-    }
-    return readBuffer;
-}
-
-struct WeatherData {
-    std::string description;
-    std::string temp;
+// --- Command line ---
+// Our own flags; everything else is left for rgb_matrix's --led-* parser.
+struct ClockFlags {
+    bool headless = false;   // --headless: render into memory, no GPIO
+    std::string dump_path;   // --dump=PATH: write frames (see MemoryDisplay)
+    long max_ticks = -1;     // --ticks=N: exit after N ticks
+    int tick_rate = 1;       // --tick-rate=N: ticks per second, for animations
+    int ticker_fps = 30;     // --ticker-fps=N: frames a second of scrolling text, 0 for none
+    int icon_fps = 10;       // --icon-fps=N: frames a second of animated icons, 0 for still
+    int render_ahead_ms = 10; // --render-ahead=MS: how long before a tick to render it
+    int render_threads = 1;  // --render-threads=N: draw bands of the screen in parallel
+    std::string metrics_path; // --metrics=PATH: keep a Prometheus text file of timings
+    int metrics_interval = 15; // --metrics-interval=S: seconds between rewrites
+    std::string weather_server; // --weather-server=URL: ask this host instead (tools/weather_stub)
+    BrightnessSchedule brightness; // --brightness=PCT, --night-brightness=PCT, --dim-hours=FROM-TO
+    float gamma = 1.0f;      // --gamma=G: extra gamma applied when composing
+    std::string config_path = "clock.conf"; // --config=PATH: settings file, reloaded when saved
+    std::string record_path; // --record=PATH: append every weather response to PATH
+    std::string replay_path; // --replay=PATH: run on a simulated clock from a recording
+    std::string checksums_path; // --checksums=PATH: a checksum line per shown frame
 };
 
-WeatherData ParseWeather(const std::string& jsonStr, Units units) {
-    WeatherData data;
-    if (jsonStr.empty()) return {"No data", ""};
-
-    try {
-        nlohmann::json j = nlohmann::json::parse(jsonStr);
-
-        int cod_val = j["cod"].is_string() ? std::stoi(j["cod"].get<std::string>())
-                                           : j["cod"].get<int>();
-        if (cod_val != 200) return {j.value("message", "API error"), ""};
-
-        data.description = j["weather"][0].value("description", "Unknown");
-        double temp_val = j["main"].value("temp", 0.0);
-        const char* unit_label = (units == Units::Metric) ? "°C" : "°F";
-
-        std::ostringstream oss;
-        oss << std::fixed << std::setprecision(1) << temp_val << unit_label;
-        data.temp = oss.str();
-    } catch (...) {
-        data = {"Parse error", ""};
-    }
-    return data;
-}
-
-
-
-bool LoadIconFromPNG(const std::string& filename, Pixel icon[ICON_SIZE][ICON_SIZE]) {
-
-    std::vector<unsigned char> image; // raw RGBA pixels
-    unsigned width, height;
-
-    unsigned error = lodepng::decode(image, width, height, filename);
-    if (error) {
-        std::cerr << "PNG decode error in " << filename << ": "
-                  << lodepng_error_text(error) << std::endl;
+// Percent for the brightness flags; false if out of range.
+bool ParsePercent(const char* flag, const char* value, int* out) {
+    char* end;
+    long pct = strtol(value, &end, 10);
+    if (*end || pct < 1 || pct > 100) {
+        std::cerr << "Bad value for " << flag << " (1-100): " << value << std::endl;
         return false;
     }
-
-    // Clear icon buffer
-    for (int y = 0; y < ICON_SIZE; ++y)
-        for (int x = 0; x < ICON_SIZE; ++x)
-            icon[y][x] = {0, 0, 0};
-
-    // Copy pixels into icon buffer (clipped to ICON_SIZE)
-    for (unsigned y = 0; y < std::min(height, (unsigned)ICON_SIZE); ++y) {
-        for (unsigned x = 0; x < std::min(width, (unsigned)ICON_SIZE); ++x) {
-            int idx = 4 * (y * width + x); // RGBA
-            uint8_t r = image[idx];
-            uint8_t g = image[idx + 1];
-            uint8_t b = image[idx + 2];
-            uint8_t a = image[idx + 3];
-
-            if (a > 128) icon[y][x] = {r, g, b}; // skip transparent pixels
-        }
-    }
-
+    *out = (int)pct;
     return true;
 }
 
-
-// --- Helpers to clear and prerender icons ---
-void ClearIcon(Pixel icon[ICON_SIZE][ICON_SIZE]) {
-    for (int y = 0; y < ICON_SIZE; y++)
-        for (int x = 0; x < ICON_SIZE; x++)
-            icon[y][x] = {0, 0, 0};
-}
-
-void PreRenderSun() {
-    ClearIcon(sunIcon);
-    for (int y = 0; y < ICON_SIZE; y++) {
-        for (int x = 0; x < ICON_SIZE; x++) {
-            int dx = x - ICON_SIZE / 2;
-            int dy = y - ICON_SIZE / 2;
-            if (dx * dx + dy * dy <= 64) sunIcon[y][x] = {0, 255, 255};
-        }
-    }
-}
-
-void PreRenderMoon() {
-    ClearIcon(moonIcon);
-    for (int y = 0; y < ICON_SIZE; y++) {
-        for (int x = 0; x < ICON_SIZE; x++) {
-            int dx = x - ICON_SIZE / 2;
-            int dy = y - ICON_SIZE / 2;
-            if (dx * dx + dy * dy <= 64) moonIcon[y][x] = {255, 200, 200};
-            int dx2 = x - ICON_SIZE / 2 - 4;
-            if (dx2 * dx2 + dy * dy <= 64) moonIcon[y][x] = {0, 0, 0};
-        }
-    }
-}
-
-void PreRenderCloud() {
-    ClearIcon(cloudIcon);
-    for (int y = 0; y < ICON_SIZE; y++) {
-        for (int x = 0; x < ICON_SIZE; x++) {
-            int dx = x - 16, dy = y - 16;
-            if (dx * dx + dy * dy <= 36) cloudIcon[y][x] = {200, 200, 200};
-            dx = x - 12; dy = y - 18;
-            if (dx * dx + dy * dy <= 36) cloudIcon[y][x] = {200, 200, 200};
-            dx = x - 20; dy = y - 18;
-            if (dx * dx + dy * dy <= 36) cloudIcon[y][x] = {200, 200, 200};
-        }
-    }
-}
-
-void PreRenderRain() {
-    PreRenderCloud();
-    for (int i = 0; i < 3; i++) {
-        int px = 12 + i * 4;
-        rainIcon[22][px] = {255, 128, 0};
-        rainIcon[24][px] = {255, 128, 0};
-    }
-}
-
-void PreRenderSnow() {
-    PreRenderCloud();
-    for (int i = 0; i < 3; i++) {
-        int px = 12 + i * 4;
-        snowIcon[22][px] = {255, 255, 255};
-        snowIcon[24][px] = {255, 255, 255};
-    }
-}
-void PreRenderPartlyCloudy() {
-    ClearIcon(partlyCloudyIcon);
-
-    // Sun (top-left corner)
-    for (int y = 0; y < ICON_SIZE; y++) {
-        for (int x = 0; x < ICON_SIZE; x++) {
-            int dx = x - 10, dy = y - 10;
-            if (dx * dx + dy * dy <= 36) {
-                partlyCloudyIcon[y][x] = {255, 255, 0};  // yellow sun
+bool ParseClockFlags(int* argc, char** argv, ClockFlags* flags) {
+    int out = 1;
+    for (int i = 1; i < *argc; ++i) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--headless") == 0) {
+            flags->headless = true;
+        } else if (strncmp(arg, "--dump=", 7) == 0) {
+            flags->dump_path = arg + 7;
+        } else if (strncmp(arg, "--ticks=", 8) == 0) {
+            char* end;
+            flags->max_ticks = strtol(arg + 8, &end, 10);
+            if (*end || flags->max_ticks < 0) {
+                std::cerr << "Bad value for --ticks: " << arg + 8 << std::endl;
+                return false;
             }
-        }
-    }
-
-    // Cloud (center-right)
-    for (int y = 0; y < ICON_SIZE; y++) {
-        for (int x = 0; x < ICON_SIZE; x++) {
-            int dx1 = x - 18, dy1 = y - 18;
-            int dx2 = x - 22, dy2 = y - 16;
-            if (dx1 * dx1 + dy1 * dy1 <= 36 || dx2 * dx2 + dy2 * dy2 <= 36) {
-                partlyCloudyIcon[y][x] = {200, 200, 200};  // light gray cloud
+        } else if (strncmp(arg, "--tick-rate=", 12) == 0) {
+            char* end;
+            long rate = strtol(arg + 12, &end, 10);
+            if (*end || rate < 1 || rate > 1000) {
+                std::cerr << "Bad value for --tick-rate (1-1000): " << arg + 12 << std::endl;
+                return false;
             }
-        }
-    }
-}
-
-void PreRenderFog() {
-    ClearIcon(fogIcon);
-    for (int y = 12; y <= 20; y += 4) {
-        for (int x = 8; x < 24; x++) {
-            fogIcon[y][x] = {180, 180, 180};
-        }
-    }
-}
-
-// --- Blit function ---
-void DrawIcon(rgb_matrix::FrameCanvas* canvas, int x, int y, Pixel icon[ICON_SIZE][ICON_SIZE]) {
-    if (!canvas) {
-        std::cerr << "Canvas is null\n";
-        return;
-    }
-
-    for (int row = 0; row < ICON_SIZE; row++) {
-        for (int col = 0; col < ICON_SIZE; col++) {
-            Pixel p = icon[row][col];
-            if (p.r || p.g || p.b) {
-                canvas->SetPixel(x + col, y + row, p.r, p.g, p.b);
+            flags->tick_rate = (int)rate;
+        } else if (strncmp(arg, "--ticker-fps=", 13) == 0) {
+            char* end;
+            long fps = strtol(arg + 13, &end, 10);
+            if (*end || fps < 0 || fps > 120) {
+                std::cerr << "Bad value for --ticker-fps (0-120): " << arg + 13 << std::endl;
+                return false;
             }
-        }
-    }
-}
-
-
-void DrawBorder(rgb_matrix::FrameCanvas* canvas, Color color) {
-    int width = canvas->width();
-    int height = canvas->height();
-
-    for (int x = 0; x < width; ++x) {
-        canvas->SetPixel(x, 0, color.r, color.g, color.b);             // top
-        canvas->SetPixel(x, height - 1, color.r, color.g, color.b);    // bottom
-    }
-
-    for (int y = 0; y < height; ++y) {
-    for (int y = 0; y < height; ++y) {
-        canvas->SetPixel(0, y, color.r, color.g, color.b);             // left
-        canvas->SetPixel(width - 1, y, color.r, color.g, color.b);     // right
-    }
-}
-}
-void DrawTextOutline(rgb_matrix::FrameCanvas* canvas, const rgb_matrix::Font& font, int x, int y,
-                     const rgb_matrix::Color& outline_color, const rgb_matrix::Color& text_color,
-                     const char* text) {
-    // Draw the outline by shifting the text in all 8 directions
-    rgb_matrix::DrawText(canvas, font, x - 1, y, outline_color, nullptr, text);
-    rgb_matrix::DrawText(canvas, font, x + 1, y, outline_color, nullptr, text);
-    rgb_matrix::DrawText(canvas, font, x, y - 1, outline_color, nullptr, text);
-    rgb_matrix::DrawText(canvas, font, x, y + 1, outline_color, nullptr, text);
-    rgb_matrix::DrawText(canvas, font, x - 1, y - 1, outline_color, nullptr, text);
-    rgb_matrix::DrawText(canvas, font, x + 1, y + 1, outline_color, nullptr, text);
-    rgb_matrix::DrawText(canvas, font, x - 1, y + 1, outline_color, nullptr, text);
-    rgb_matrix::DrawText(canvas, font, x + 1, y - 1, outline_color, nullptr, text);
-
-    // Draw the main text on top
-    rgb_matrix::DrawText(canvas, font, x, y, text_color, nullptr, text);
-}
-
-int MeasureTextWidth(const rgb_matrix::Font& font, const std::string& text) {
-    int width = 0;
-    for (char c : text) {
-        width += font.CharacterWidth(c);
-    }
-    return width;
-}
-
-
-void DrawFilledRoundedBox(rgb_matrix::FrameCanvas* canvas,
-                          int x, int y, int w, int h,
-                          const rgb_matrix::Color& fill,
-                          const rgb_matrix::Color& border,
-                          bool rounded = true) {
-    for (int dy = 0; dy < h; ++dy) {
-        for (int dx = 0; dx < w; ++dx) {
-            int px = x + dx;
-            int py = y + dy;
-
-            if (rounded) {
-                bool top = dy == 0;
-                bool bottom = dy == h - 1;
-                bool left = dx == 0;
-                bool right = dx == w - 1;
-                if ((top && left) || (top && right) ||
-                    (bottom && left) || (bottom && right)) continue;
+            flags->ticker_fps = (int)fps;
+        } else if (strncmp(arg, "--icon-fps=", 11) == 0) {
+            char* end;
+            long fps = strtol(arg + 11, &end, 10);
+            if (*end || fps < 0 || fps > 60) {
+                std::cerr << "Bad value for --icon-fps (0-60): " << arg + 11 << std::endl;
+                return false;
             }
-
-            bool isEdge = (dy == 0 || dy == h - 1 || dx == 0 || dx == w - 1);
-            const rgb_matrix::Color& c = isEdge ? border : fill;
-            canvas->SetPixel(px, py, c.r, c.g, c.b);
+            flags->icon_fps = (int)fps;
+        } else if (strncmp(arg, "--render-ahead=", 15) == 0) {
+            char* end;
+            long ms = strtol(arg + 15, &end, 10);
+            if (*end || ms < 0 || ms > 500) {
+                std::cerr << "Bad value for --render-ahead (0-500 ms): " << arg + 15 << std::endl;
+                return false;
+            }
+            flags->render_ahead_ms = (int)ms;
+        } else if (strncmp(arg, "--render-threads=", 17) == 0) {
+            char* end;
+            long threads = strtol(arg + 17, &end, 10);
+            if (*end || threads < 1 || threads > 16) {
+                std::cerr << "Bad value for --render-threads (1-16): " << arg + 17 << std::endl;
+                return false;
+            }
+            flags->render_threads = (int)threads;
+        } else if (strncmp(arg, "--weather-server=", 17) == 0) {
+            flags->weather_server = arg + 17;
+        } else if (strncmp(arg, "--record=", 9) == 0) {
+            flags->record_path = arg + 9;
+        } else if (strncmp(arg, "--replay=", 9) == 0) {
+            flags->replay_path = arg + 9;
+        } else if (strncmp(arg, "--checksums=", 12) == 0) {
+            flags->checksums_path = arg + 12;
+        } else if (strncmp(arg, "--config=", 9) == 0) {
+            flags->config_path = arg + 9;
+        } else if (strncmp(arg, "--brightness=", 13) == 0) {
+            if (!ParsePercent("--brightness", arg + 13, &flags->brightness.day)) return false;
+        } else if (strncmp(arg, "--night-brightness=", 19) == 0) {
+            if (!ParsePercent("--night-brightness", arg + 19, &flags->brightness.night)) return false;
+        } else if (strncmp(arg, "--dim-hours=", 12) == 0) {
+            int from, to;
+            char extra;
+            if (sscanf(arg + 12, "%d-%d%c", &from, &to, &extra) != 2 ||
+                from < 0 || from > 23 || to < 0 || to > 23) {
+                std::cerr << "Bad value for --dim-hours (FROM-TO, e.g. 22-7): " << arg + 12 << std::endl;
+                return false;
+            }
+            flags->brightness.dim_from = from;
+            flags->brightness.dim_to = to;
+        } else if (strncmp(arg, "--gamma=", 8) == 0) {
+            char* end;
+            flags->gamma = strtof(arg + 8, &end);
+            if (*end || !(flags->gamma >= 0.5f && flags->gamma <= 3.0f)) {
+                std::cerr << "Bad value for --gamma (0.5-3): " << arg + 8 << std::endl;
+                return false;
+            }
+        } else if (strncmp(arg, "--metrics=", 10) == 0) {
+            flags->metrics_path = arg + 10;
+        } else if (strncmp(arg, "--metrics-interval=", 19) == 0) {
+            char* end;
+            long seconds = strtol(arg + 19, &end, 10);
+            if (*end || seconds < 1 || seconds > 3600) {
+                std::cerr << "Bad value for --metrics-interval (1-3600 s): " << arg + 19 << std::endl;
+                return false;
+            }
+            flags->metrics_interval = (int)seconds;
+        } else {
+            argv[out++] = argv[i];
         }
     }
-}
-
-std::string FetchURL(const std::string& url) {
-    CURL* curl = curl_easy_init();
-    std::string response;
-
-    if (curl) {
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-        curl_easy_setopt(curl, CURLOPT_USERAGENT, "libcurl-agent/1.0");
-        curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);  // handle redirects
-
-        CURLcode res = curl_easy_perform(curl);
-        if (res != CURLE_OK) {
-            fprintf(stderr, "curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
+    *argc = out;
+    argv[out] = nullptr;
+    if (!flags->headless) {
+        const char* needs = !flags->dump_path.empty() ? "--dump"
+                          : !flags->replay_path.empty() ? "--replay"
+                          : !flags->checksums_path.empty() ? "--checksums" : nullptr;
+        if (needs) {
+            std::cerr << needs << " needs --headless" << std::endl;
+            return false;
         }
-
-        curl_easy_cleanup(curl);
     }
-
-    return response;
-}
-
-
-
-rgb_matrix::Color TempToColor(float tempF) {
-    float minT = 32.0f;   // freezing
-    float maxT = 100.0f;  // hot
-    float clamped = std::max(minT, std::min(maxT, tempF));
-
-    // Normalize 0..1
-    float t = (clamped - minT) / (maxT - minT);
-
-    uint8_t r, g, b;
-
-    if (t < 0.33f) {
-        // Blue → Cyan
-        float u = t / 0.33f;
-        r = 0;
-        g = static_cast<uint8_t>(255 * u);
-        b = 255;
-    } else if (t < 0.66f) {
-        // Cyan → Orange
-        float u = (t - 0.33f) / 0.33f;
-        r = static_cast<uint8_t>(255 * u);
-        g = static_cast<uint8_t>(255 - (90 * u));   // 255 → 165
-        b = static_cast<uint8_t>(255 * (1.0f - u)); // 255 → 0
-    } else {
-        // Orange → Red
-        float u = (t - 0.66f) / 0.34f;
-        r = 255;
-        g = static_cast<uint8_t>(165 * (1.0f - u));
-        b = 0;
+    if (!flags->record_path.empty() && !flags->replay_path.empty()) {
+        std::cerr << "--record and --replay can't be used together" << std::endl;
+        return false;
     }
-
-    return rgb_matrix::Color(r, g, b);
+    return true;
 }
 
+// Most of a core the scrolling ticker and the icon animation may take,
+// draw and compose included
+const float TICKER_CPU_SHARE = 0.25f;
+const float ICON_CPU_SHARE = 0.1f;
 
-float GetCurrentTempFromOpenMeteo(const std::string& lat, const std::string& lon) {
-    std::string url = "https://api.open-meteo.com/v1/forecast"
-                      "?latitude=" + lat +
-                      "&longitude=" + lon +
-                      "&current_weather=true"
-                      "&temperature_unit=fahrenheit";
-
-    std::string response = FetchURL(url);  // your libcurl wrapper
-    auto data = nlohmann::json::parse(response);
-
-    return data["current_weather"]["temperature"];
-}
-
-
-
-
-
-
-// --- Update static frame ---
-void UpdateStaticFrame(rgb_matrix::FrameCanvas* staticFrame,
-                       const WeatherData &weatherData,
-                       const char *day_str,
-                       const char *date_str,
-                       Font &tempFont,
-                       Color &weatherColor,
-                       Color &clockColor,
-                       bool isNight) {
-    
-	if (!staticFrame) {
-		std::cerr << "staticFrame is null!\n";
-    return;
-	}
-	//std::cerr << "staticFrame size: " << staticFrame->width() << "x" << staticFrame->height() << std::endl;
-
-	staticFrame->Clear();
-	//std::cerr << "sTransform\n";
-	std::string desc = weatherData.description;
-	std::transform(desc.begin(), desc.end(), desc.begin(), ::tolower);
-
-	//DrawBorder(staticFrame, Color(128, 128, 128));
-    // Weather icon shifted upward to y = 24
-	//std::cerr << "Draw Icons!\n";
-	try{
-		if (desc.find("clear") != std::string::npos) {
-			if (isNight) DrawIcon(staticFrame, 16, 23, moonIcon);
-			else {
-				DrawIcon(staticFrame, 16, 23, sunIcon);
-			}
-		} else if (desc.find("partly") != std::string::npos ||
-				desc.find("few cloud") != std::string::npos ||
-				desc.find("light cloud") != std::string::npos ||
-				desc.find("scattered cloud") != std::string::npos){
-			if (isNight) DrawIcon(staticFrame, 16, 23, moonPartlyCloudIcon);
-			else {
-				DrawIcon(staticFrame, 16, 23, partlyCloudyIcon);
-			}
-		} else if (desc.find("cloud") != std::string::npos) {
-				if (isNight) DrawIcon(staticFrame, 16, 23, moonCloudIcon);
-				else {
-				DrawIcon(staticFrame, 16, 23, cloudIcon);
-			}
-		} else if (desc.find("thunder") != std::string::npos) {
-			DrawIcon(staticFrame, 16, 23, thunderIcon);
-		} else if (desc.find("drizzle") != std::string::npos) {
-			DrawIcon(staticFrame, 16, 23, drizzleIcon);
-		} else if (desc.find("rain") != std::string::npos) {
-			DrawIcon(staticFrame, 16, 23, rainIcon);
-		} else if (desc.find("haze") != std::string::npos) {
-			DrawIcon(staticFrame, 16, 23, hazeIcon);
-		} else if (desc.find("ash") != std::string::npos) {
-			DrawIcon(staticFrame, 16, 23, ashIcon);
-		} else if (desc.find("smoke") != std::string::npos) {
-			DrawIcon(staticFrame, 16, 23, smokeIcon);			
-		} else if (desc.find("snow") != std::string::npos) {
-			DrawIcon(staticFrame, 16, 23, snowIcon);
-		} else if (desc.find("fog") != std::string::npos || desc.find("mist") != std::string::npos) {
-			DrawIcon(staticFrame, 16, 23, fogIcon);
-		} else {
-			DrawIcon(staticFrame, 16, 23, friendIcon);
-			}
-	} catch (...) {
-		std::cerr << "Failed to Draw Icons: " << weatherData.temp << std::endl;
-	}
-	float tempF = 62.0f;  // default fallback
-	try {
-		std::string tempClean = weatherData.temp;
-		tempClean.erase(std::remove_if(tempClean.begin(), tempClean.end(),
-									   [](char c) { return !std::isdigit(c) && c != '.'; }),
-						tempClean.end());
-		if (!tempClean.empty()) {
-			tempF = std::stof(tempClean);
-		}
-	} catch (...) {
-		std::cerr << "Failed to parse temperature: " << weatherData.temp << std::endl;
-	}
-	//std::cerr << "Temp to colo!\n";
-	
-	//std::cerr << "Draw Text temperature!\n";
-	if (!weatherData.temp.empty() &&
-		weatherData.temp != "Parse error" &&
-		weatherData.temp != "API error") {
-		
-	rgb_matrix::DrawText(staticFrame, tempFont, 0, 0,
-										  weatherColor, nullptr,
-										  weatherData.temp.c_str());
-
-	}
-	int temp_width = MeasureTextWidth(tempFont, weatherData.temp);
-
-	//std::cerr << "Get color and fill box!\n";
-	int icon_center_x = 16 + ICON_SIZE / 2;
-
-	//const int TEMP_BOX_WIDTH = 48;
-	const int TEMP_BOX_PADDING = 0;
-	int box_w = temp_width + TEMP_BOX_PADDING * 2;
-	int box_h = tempFont.height() + TEMP_BOX_PADDING * 2;
-	int box_x = icon_center_x - box_w / 2;
-	int box_y = 64 - box_h;  // aligns bottom edge 
-
-
-	rgb_matrix::Color fill = TempToColor(tempF);
-	rgb_matrix::Color border(255, 255, 255);
-
-	try {
-		//DrawFilledRoundedBox(staticFrame, box_x, box_y, box_w, box_h, fill, border);
-		//rgb_matrix::DrawText(staticFrame, tempFont, box_x + 3, box_y + box_h - 4,
-							 //rgb_matrix::Color(255, 255, 255), nullptr,
-							 //weatherData.temp.c_str());
-		DrawTextOutline(staticFrame, tempFont, box_x + 3, 62,fill, rgb_matrix::Color(0, 0, 0), weatherData.temp.c_str());
-	} catch (...) {
-		std::cerr << "Failed to draw temperature box or text: " << weatherData.temp << std::endl;
-	}
-	if (day_str && date_str) {
-    rgb_matrix::DrawText(staticFrame, tempFont, RIGHT_PANEL_X + 6, 50,
-                         clockColor, nullptr, day_str);
-    rgb_matrix::DrawText(staticFrame, tempFont, RIGHT_PANEL_X + 6, 62,
-                         clockColor, nullptr, date_str);
-	}
-
-
-
-
-
-
+// SIGUSR1 asks for the tick lateness histograms on stderr
+volatile sig_atomic_t statsRequested = 0;
 
+void RequestStats(int) {
+    statsRequested = 1;
 }
 
 // --- Main Program ---
 int main(int argc, char* argv[]) {
 	std::cerr << "Entered main()\n";
+    const auto startTime = std::chrono::steady_clock::now();
+    bool firstFrame = true;
     RGBMatrix::Options defaults;
     defaults.rows = 64;
     defaults.cols = 64;
     defaults.chain_length = 2;
     defaults.parallel = 1;
-	
-	std::string lastDayStr, lastDateStr;
 
-	
+    ClockFlags flags;
+    if (!ParseClockFlags(&argc, argv, &flags)) return 1;
+
+    // Headless runs the same loop into memory, sized by the --led-* flags
     rgb_matrix::RuntimeOptions runtime_opt;
-    RGBMatrix* matrix = rgb_matrix::CreateMatrixFromFlags(&argc, &argv,
-                                                          &defaults, &runtime_opt);
-    if (matrix == nullptr) return 1;
+    std::unique_ptr<Display> display;
+    MemoryDisplay* memoryDisplay = nullptr;
+    if (flags.headless) {
+        if (!rgb_matrix::ParseOptionsFromFlags(&argc, &argv, &defaults, &runtime_opt)) {
+            rgb_matrix::PrintMatrixFlags(stderr, defaults, runtime_opt);
+            return 1;
+        }
+        memoryDisplay = new MemoryDisplay(defaults.cols * defaults.chain_length,
+                                          defaults.rows * defaults.parallel,
+                                          flags.dump_path);
+        display.reset(memoryDisplay);
+    } else {
+        RGBMatrix* matrix = rgb_matrix::CreateMatrixFromFlags(&argc, &argv,
+                                                              &defaults, &runtime_opt);
+        if (matrix == nullptr) return 1;
+        display.reset(new MatrixDisplay(matrix));
+    }
+
+    // Icons and glyphs come straight out of the mapped asset pack; without
+    // one they are decoded from icons/ and fonts/ as before.
+    AssetPack assets;
+    if (!assets.Open(ASSET_PACK_PATH)) {
+        std::cerr << "No asset pack, loading icons and fonts from source files\n";
+    }
 
-    Font clockFont, tempFont;
-    if (!clockFont.LoadFont("fonts/12x24.bdf")) {
+    BitmapFont clockFont, tempFont;
+    if (!LoadFont(clockFont, assets, "fonts/12x24.bdf")) {
         std::cerr << "Couldn't load clock font\n";
         return 1;
     }
-    if (!tempFont.LoadFont("fonts/6x12.bdf")) {
+    if (!LoadFont(tempFont, assets, "fonts/6x12.bdf")) {
         std::cerr << "Couldn't load temp font\n";
         return 1;
     }
 
-    Color clockColor(255, 255, 255);
-    Color weatherColor(0, 255, 255);
-
-    std::string api_key = "YOUR API KEY";
-    std::string city = "Los%20Angeles,US";
-	std::string lat = "34.078";
-	std::string lon = "-118.260";
-    Units units = Units::Imperial;
+    // Settings: the flags, with the config file's over them. The file is
+    // watched, and saving it applies what changed without a restart.
+    ClockConfig baseConfig;
+    baseConfig.weather.server = flags.weather_server;
+    baseConfig.brightness = flags.brightness;
+    baseConfig.gamma = flags.gamma;
+    ClockConfig config = baseConfig;
+    std::string configError;
+    if (!LoadConfig(flags.config_path, &config, &configError)) {
+        std::cerr << configError << ", using the defaults" << std::endl;
+    }
+    ConfigWatcher configWatcher(flags.config_path);
+    if (!configWatcher.ok()) std::cerr << "Not watching " << flags.config_path << std::endl;
 
     WeatherData weatherData;
-    time_t lastWeatherUpdate = 0;
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    // Responses from the network, optionally recorded, or from a recording.
+    // A replay fetches on the loop's simulated clock instead of a thread,
+    // with an in-memory cache and fixed jitter, so every run is the same.
+    const bool replaying = !flags.replay_path.empty();
+    std::unique_ptr<HttpClient> network;
+    std::unique_ptr<RecordingHttp> recorder;
+    ReplayHttp replay;
+    HttpSource* http = nullptr;   // the worker's own client
+    if (replaying) {
+        std::string error;
+        if (!replay.Load(flags.replay_path, &error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        if (replay.size() == 0) {
+            std::cerr << "Nothing recorded in " << flags.replay_path << std::endl;
+            return 1;
+        }
+        http = &replay;
+    } else if (!flags.record_path.empty()) {
+        network.reset(new HttpClient);
+        recorder.reset(new RecordingHttp(network.get(), flags.record_path));
+        if (!recorder->ok()) {
+            std::cerr << "Couldn't open " << flags.record_path << std::endl;
+            return 1;
+        }
+        http = recorder.get();
+    }
+    WeatherWorker weatherWorker(config.weather, replaying ? "" : DefaultCachePath(),
+                                http, replaying ? 1 : 0);
+    if (!replaying) weatherWorker.Start();
 	
-    // Pre-render icons once
+    // Load icons once
 	try {
-		LoadIconFromPNG("icons/sun.png", sunIcon);
-		LoadIconFromPNG("icons/moon.png", moonIcon);
-		LoadIconFromPNG("icons/cloud.png", cloudIcon);
-		LoadIconFromPNG("icons/drizzle.png", drizzleIcon);
-		LoadIconFromPNG("icons/rain.png", rainIcon);
-		LoadIconFromPNG("icons/snow.png", snowIcon);
-		LoadIconFromPNG("icons/fog.png", fogIcon);
-		LoadIconFromPNG("icons/light_cloud.png", partlyCloudyIcon);
-		LoadIconFromPNG("icons/friend.png", friendIcon);
-		LoadIconFromPNG("icons/thunder.png", thunderIcon);
-		LoadIconFromPNG("icons/ash.png", ashIcon);
-		LoadIconFromPNG("icons/haze.png", hazeIcon);
-		LoadIconFromPNG("icons/smoke.png", smokeIcon);
-		LoadIconFromPNG("icons/night_lightcloud.png", moonPartlyCloudIcon);
-		LoadIconFromPNG("icons/night_cloud.png", moonCloudIcon);
+		LoadIcons(iconAtlas, assets);
 	} catch (...) {
     std::cerr << "Failed to load png: " << std::endl;
 	}
 
-    // Buffers
-    rgb_matrix::FrameCanvas* offscreen = matrix->CreateFrameCanvas();
-    rgb_matrix::FrameCanvas* staticFrame = matrix->CreateFrameCanvas();
-
-    while (true) {
-        time_t now = time(NULL);
-        struct tm* tm_now = localtime(&now);
-
-        char time_str[64];
-        strftime(time_str, sizeof(time_str), "%-I:%M:%S", tm_now);
-
-        char date_str[64];
-        strftime(date_str, sizeof(date_str), "%m/%d/%y", tm_now);
-
-        char day_str[64];
-        strftime(day_str, sizeof(day_str), "%A", tm_now);
-		
-		std::string currentDayStr(day_str);
-		std::string currentDateStr(date_str);
-		//std::cerr << "Check Dates: " << time_str << std::endl;
-		bool dateChanged = (currentDayStr != lastDayStr || currentDateStr != lastDateStr);
-
-		
-        // Update weather every 15 minutes
-        if (difftime(now, lastWeatherUpdate) > 900 || weatherData.temp.empty() || dateChanged) {
-			//std::cerr << "Update Weather: " << time_str << std::endl;
-            std::string weatherJson = GetWeather(lat, lon, api_key, units);
-            weatherData = ParseWeather(weatherJson, units);
-			try {
-				float tempF = GetCurrentTempFromOpenMeteo(lat, lon);  // Los Angeles
-				std::ostringstream oss;
-				oss << std::fixed << std::setprecision(1) << tempF << "°F";
-				weatherData.temp = oss.str();
-
-			} catch (...) {
-				std::cerr << "Failed to get temp from open meteo, Using OWM " << std::endl;
-			}
-            lastWeatherUpdate = now;
-
-            int hour = tm_now->tm_hour;
-            bool isNight = (hour < 6 || hour >= 18);
-			std::cerr << "Update static fram: " << time_str << std::endl;
-            UpdateStaticFrame(staticFrame, weatherData, day_str, date_str,
-                              tempFont, weatherColor, clockColor, isNight);
+    // Every frame of the icons that move, worked out before the first tick
+    IconAnimations iconAnimations;
+    if (flags.icon_fps > 0) LoadAnimations(iconAnimations, iconAtlas, assets);
+
+    // Fewer --led-pwm-bits, for a faster refresh, leave fewer steps of
+    // light; the icons are dithered to them, through the brightness table,
+    // each time the table changes (the first on the first tick)
+    const bool dither = defaults.pwm_bits < PANEL_PWM_BITS;
+    IconAtlas ditheredIcons;
+    IconAnimations ditheredAnimations;
+    const IconAtlas* icons = dither ? &ditheredIcons : &iconAtlas;
+    const IconAnimations* animations = dither ? &ditheredAnimations : &iconAnimations;
+
+    // Positions, fonts and icon sizes for this display, worked out once
+    LayoutEngine layoutEngine({&tempFont, &clockFont}, *icons, animations);
+    const Layout& layout = layoutEngine.Resolve(display->width(), display->height());
+    std::cerr << "Layout for " << layout.width << "x" << layout.height
+              << " at scale " << layout.scale << std::endl;
+
+    // Buffers: the layers are composed bottom to top, and only what changed
+    // in them is redrawn into the display's back buffer. With more than one
+    // render thread the screen is cut into bands drawn in parallel.
+    WorkPool renderPool(flags.render_threads);
+    TiledRenderer renderer(layout, display->buffer_count(),
+                           BandsForThreads(flags.render_threads, layout.height), renderPool);
+    // The strip is redrawn for new forecast data or a new hour only
+    HourlyForecast shownForecast;
+    time_t shownHour = -1;
+    // The time, day and date text, without localtime() or the heap per tick
+    LocalTime localTime;
+    // Dimmed by the composing step, so a new level redraws no layer
+    ColorLut colorLut;
+    // The day line, scrolling on through the weather description. Drawn
+    // once per text; each frame only moves the window onto it, and frames
+    // come less often if they would take too much of the core.
+    Ticker ticker(layout.ticker, layout.date_x - layout.ticker.x, layout.day_baseline,
+                  TICKER_SPEED * layout.scale);
+    FrameBudget tickerBudget(flags.ticker_fps, TICKER_CPU_SHARE);
+    // The weather icon shown, and which frame of it if it moves. Frames
+    // only redraw the icon's layer, paced like the ticker's.
+    IconId shownIcon = IconId::Count;
+    int shownFrame = 0;
+    FrameBudget iconBudget(flags.icon_fps, ICON_CPU_SHARE);
+    const int64_t iconFrameNs = flags.icon_fps > 0 ? 1000000000LL / flags.icon_fps : 0;
+    auto animated = [&](IconId icon) {
+        return flags.icon_fps > 0 && layout.animations && layout.animations->frames(icon) > 0;
+    };
+
+    // Each tick is rendered ahead of its wall-clock boundary and swapped
+    // in on it; `kill -USR1` prints how late the ticks have been. A moving
+    // icon needs ticks at its frame rate and scrolling text at its own,
+    // only while they are shown; otherwise the clock wakes at --tick-rate.
+    TickScheduler scheduler(flags.tick_rate, flags.render_ahead_ms * 1000000LL);
+    signal(SIGUSR1, RequestStats);
+    auto printStats = [&] {
+        scheduler.PrintStats(std::cerr);
+        if (ticker.scrolls()) {
+            std::cerr << "ticker: up to " << tickerBudget.fps() << " fps, "
+                      << tickerBudget.cost_ns() / 1000 << " us a frame" << std::endl;
+        }
+        if (shownIcon != IconId::Count && animated(shownIcon)) {
+            std::cerr << "icon: up to " << iconBudget.fps() << " fps, "
+                      << iconBudget.cost_ns() / 1000 << " us a frame" << std::endl;
+        }
+    };
+    // A replay runs from the first recorded response to the last, unless
+    // --ticks says otherwise
+    time_t replayEnd = -1;
+    if (replaying) {
+        scheduler.Simulate((int64_t)replay.first() * 1000000000LL);
+        // Frames drawn at the full rates, however long this host takes
+        tickerBudget.FixCost(0);
+        iconBudget.FixCost(0);
+        if (flags.max_ticks < 0) replayEnd = replay.last();
+        std::cerr << "Replaying " << replay.size() << " responses, "
+                  << replay.last() - replay.first() + 1 << " s" << std::endl;
+    }
+    std::ofstream checksums;
+    if (!flags.checksums_path.empty()) {
+        checksums.open(flags.checksums_path, std::ios::trunc);
+        if (!checksums) {
+            std::cerr << "Couldn't write " << flags.checksums_path << std::endl;
+            return 1;
+        }
+    }
+
+    // Fetch, parse and render timings for fleet monitoring
+    clockMetrics.scheduler = &scheduler;
+    std::unique_ptr<MetricsExporter> metricsExporter;
+    if (!flags.metrics_path.empty()) {
+        metricsExporter.reset(new MetricsExporter(flags.metrics_path, flags.metrics_interval,
+                                                  clockMetrics));
+        metricsExporter->Start();
+    }
+
+    long tick = 0;
+    for (; flags.max_ticks < 0 || tick < flags.max_ticks; ++tick) {
+        if (statsRequested) {
+            statsRequested = 0;
+            printStats();
         }
-		lastDateStr = currentDateStr;
-		lastDayStr = currentDayStr;
-		
-
-        // Compose frame: copy static + overlay time
-		//std::cerr << "Clear offscreen: " << time_str << std::endl;
-        offscreen->Clear();
-		//std::cerr << "write offscreen: " << time_str << std::endl;
-        offscreen->CopyFrom(*staticFrame);
-		
-		
+
+        // The time shown is the tick's, which is still a moment away
+        struct timespec due = scheduler.WaitForRender();
+        time_t now = due.tv_sec;
+        int64_t dueNs = due.tv_sec * 1000000000LL + due.tv_nsec;
+        if (replayEnd >= 0 && now > replayEnd) break;
+        if (replaying) {
+            replay.SetTime(now);
+            weatherWorker.RunUntil(now);
+        }
+        // Day and date only change at midnight; the time is counted on
+        bool dateChanged = localTime.Update(now);
+        const char* time_str = localTime.time_str();
+
+        // A saved config file takes effect on this tick, redoing only what
+        // it changed: a refetch for the location, a redraw of the layers
+        // whose colour changed. The time compares its own colour.
+        bool dateColorChanged = false, tickerColorChanged = false;
+        bool outlineChanged = false, rainChanged = false;
+        if (configWatcher.Changed()) {
+            ClockConfig loaded = baseConfig;
+            if (LoadConfig(flags.config_path, &loaded, &configError)) {
+                std::cerr << "Reloaded " << flags.config_path << std::endl;
+                if (loaded.weather != config.weather) weatherWorker.Configure(loaded.weather);
+                auto differs = [](const Color& a, const Color& b) {
+                    return a.r != b.r || a.g != b.g || a.b != b.b;
+                };
+                dateColorChanged = differs(loaded.date_color, config.date_color);
+                tickerColorChanged = differs(loaded.ticker_color, config.ticker_color);
+                outlineChanged = differs(loaded.outline_color, config.outline_color);
+                rainChanged = differs(loaded.rain_color, config.rain_color);
+                config = loaded;
+            } else {
+                std::cerr << configError << ", keeping the settings in use" << std::endl;
+            }
+        }
+
+        // Pick up a new snapshot from the fetch worker, if one has arrived
+        std::unique_ptr<WeatherData> fresh = weatherWorker.TakeSnapshot();
+        if (fresh) weatherData = std::move(*fresh);
+
+        // A new day needs new text, and gets a weather revalidation as well
+        if (dateChanged && tick > 0) weatherWorker.RequestRefresh();
+
+        // Sunrise and sunset swap the icon without waiting for new data
+        bool isNight = IsNight(weatherData, now, localTime.hour());
+
+        int brightness = config.brightness.Level(isNight, localTime.hour());
+        if (tick == 0 || brightness != colorLut.brightness() || config.gamma != colorLut.gamma()) {
+            std::cerr << "Brightness " << brightness << "%" << std::endl;
+            colorLut = ColorLut(brightness, config.gamma);
+            renderer.SetColorLut(&colorLut);
+            if (dither) {
+                DitherIcons(iconAtlas, defaults.pwm_bits, ditheredIcons, &colorLut);
+                DitherAnimations(iconAnimations, defaults.pwm_bits, ditheredAnimations, &colorLut);
+                layoutEngine.RescaleIcons();
+                shownIcon = IconId::Count;   // redrawn from the new pixels
+                std::cerr << "Icons dithered to " << defaults.pwm_bits << " PWM bits" << std::endl;
+            }
+        }
+
+        FrameUpdate update;
+        update.clock_color = config.clock_color;
+        update.date_color = config.date_color;
+        update.ticker_color = config.ticker_color;
+        update.outline_color = config.outline_color;
+        update.rain_color = config.rain_color;
+        if (fresh || dateChanged || outlineChanged) update.weather = &weatherData;
+
+        // A new icon is drawn at once; the next frame of a moving one when
+        // the budget allows
+        IconId icon = config.icons.Select(weatherData, isNight);
+        int frame = animated(icon) ? (int)(dueNs / iconFrameNs % layout.animations->frames(icon))
+                                   : 0;
+        bool iconFrame = false;
+        if (icon != shownIcon) {
+            update.icon = icon;
+        } else if (frame != shownFrame && iconBudget.Due(dueNs)) {
+            update.icon = icon;
+            iconFrame = true;
+        }
+        if (update.icon != IconId::Count) {
+            update.icon_frame = frame;
+            shownIcon = icon;
+            shownFrame = frame;
+        }
+        if ((fresh && weatherData.hourly != shownForecast) || now / 3600 != shownHour ||
+            rainChanged) {
+            update.forecast = &weatherData.hourly;
+            update.now = now;
+            shownForecast = weatherData.hourly;
+            shownHour = now / 3600;
+        }
+        if (dateChanged || dateColorChanged) update.date = localTime.date_str();
+
+        // The day, then what the weather is doing or why it is missing
+        if (dateChanged || fresh) {
+            char tickerText[96];
+            if (weatherData.description.empty()) {
+                snprintf(tickerText, sizeof(tickerText), "%s", localTime.day_str());
+            } else {
+                snprintf(tickerText, sizeof(tickerText), "%s  %s", localTime.day_str(),
+                         weatherData.description.c_str());
+            }
+            if (ticker.SetText(*layout.text_font, tickerText, dueNs)) update.ticker = &ticker;
+        }
+        if (tickerColorChanged) update.ticker = &ticker;
+        if (flags.ticker_fps > 0 && ticker.scrolls() && tickerBudget.Due(dueNs) &&
+            ticker.Advance(dueNs)) {
+            update.ticker = &ticker;
+        }
+
 		if (strlen(time_str) == 0) {
-			std::cerr << "Empty time string — skipping draw\n";
-			continue;
+			std::cerr << "Empty time string — skipping clock\n";
+		} else {
+			update.time = time_str;
 		}
-		//std::cerr << "Drawing time: " << time_str << std::endl;
-		
-        int time_width = rgb_matrix::DrawText(offscreen, clockFont, 0, 0,
-                                              clockColor, nullptr, time_str);
-        int time_x = (TOTAL_WIDTH - time_width) / 2;
-		//std::cerr << "Draw Offscreen: " << time_str << std::endl;
-        rgb_matrix::DrawText(offscreen, clockFont, time_x, 20,
-                             clockColor, nullptr, time_str);
-		
-		//std::cerr << "Swap Frame: " << time_str << std::endl;
-        // Swap completed frame
-        offscreen = matrix->SwapOnVSync(offscreen);
-
-        usleep(1000 * 1000); // refresh once per second
+
+        // Redraw the damaged regions and swap on the tick; nothing
+        // changed, no swap
+        int64_t renderStart = MonotonicNs();
+        bool changed = renderer.Render(update, display->BackBuffer(), display->concurrent_rows());
+        int64_t renderNs = MonotonicNs() - renderStart;
+        LatencyHistogram& renderTime = update.weather || update.date ? clockMetrics.static_render
+                                                                     : clockMetrics.tick_render;
+        renderTime.Record(renderNs);
+        if (update.ticker) tickerBudget.Spent(dueNs, renderNs);
+        if (iconFrame) iconBudget.Spent(dueNs, renderNs);
+        if (changed) {
+            scheduler.WaitForTick();
+            int64_t swapStart = MonotonicNs();
+            display->Swap();
+            clockMetrics.swap.Record(MonotonicNs() - swapStart);
+            scheduler.Swapped();
+
+            if (checksums.is_open()) {
+                const MemoryCanvas& frame = memoryDisplay->front();
+                char line[64];
+                snprintf(line, sizeof(line), "%lld.%09ld %016llx\n", (long long)due.tv_sec,
+                         due.tv_nsec, (unsigned long long)FrameChecksum(frame.data(), frame.size()));
+                checksums << line;
+            }
+        }
+
+        if (firstFrame) {
+            firstFrame = false;
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - startTime);
+            struct rusage usage;
+            getrusage(RUSAGE_SELF, &usage);
+            std::cerr << "First frame after " << elapsed.count() << " ms ("
+                      << (assets.is_open() ? "asset pack" : "source files")
+                      << "), max RSS " << usage.ru_maxrss << " KiB" << std::endl;
+        }
+
+        // Faster ticks only while the text scrolls or the icon moves
+        int rate = flags.tick_rate;
+        if (flags.ticker_fps > 0 && ticker.scrolls()) rate = std::max(rate, flags.ticker_fps);
+        bool moving = shownIcon != IconId::Count && animated(shownIcon);
+        if (moving) rate = std::max(rate, flags.icon_fps);
+        scheduler.SetRate(rate);
     }
 
+    printStats();
+    if (replaying) {
+        // Render times are real even on a simulated clock
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - startTime);
+        std::cerr << "Replayed " << tick << " ticks in " << elapsed.count() << " ms\n";
+        clockMetrics.tick_render.Print(std::cerr, "tick render");
+        clockMetrics.static_render.Print(std::cerr, "static render");
+    }
+    if (metricsExporter) metricsExporter->Stop();
     return 0;
 }
    
\ No newline at end of file
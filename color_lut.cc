@@ -0,0 +1,92 @@
+#include "color_lut.h"
+
+#include <algorithm>
+#include <cmath>
+
+ColorLut::ColorLut(int brightness, float gamma)
+    : brightness_(std::max(1, std::min(brightness, 100))), gamma_(gamma) {
+    identity_ = true;
+    for (int v = 0; v < 256; ++v) {
+        float level = std::pow(v / 255.0f, gamma) * brightness_ / 100.0f;
+        int out = (int)std::lround(255 * level);
+        // Anything lit stays lit, so thin outlines don't vanish when dimmed
+        if (v > 0) out = std::max(out, 1);
+        table_[v] = (uint8_t)out;
+        identity_ &= out == v;
+    }
+}
+
+// --- Panel response ---
+float PanelLight(uint8_t v) {
+    // As rgb_matrix's luminance_cie1931() at full brightness
+    float lightness = v * 100.0f / 255.0f;
+    return lightness <= 8.0f ? lightness / 902.3f : std::pow((lightness + 16.0f) / 116.0f, 3.0f);
+}
+
+uint8_t PanelValue(float light) {
+    light = std::max(0.0f, std::min(light, 1.0f));
+    float lightness = light <= 8.0f / 902.3f ? light * 902.3f : 116.0f * std::cbrt(light) - 16.0f;
+    return (uint8_t)std::lround(lightness * 255.0f / 100.0f);
+}
+
+float PanelShown(uint8_t v, int pwm_bits) {
+    const int full = (1 << PANEL_PWM_BITS) - 1;
+    const int dropped = PANEL_PWM_BITS - std::max(1, std::min(pwm_bits, PANEL_PWM_BITS));
+    int duty = (int)(full * PanelLight(v)) >> dropped << dropped;
+    return (float)duty / full;
+}
+
+namespace {
+
+// Which of 16 levels each cell of the 4x4 pattern turns on at
+const uint8_t BAYER[4][4] = {
+    {0, 8, 2, 10},
+    {12, 4, 14, 6},
+    {3, 11, 1, 9},
+    {15, 7, 13, 5},
+};
+
+}  // namespace
+
+PanelDither::PanelDither(int pwm_bits, const ColorLut* lut) {
+    // What each value turns into on the way to the panel, and the light
+    // that shows for it
+    auto out = [&](int v) { return lut ? lut->Map((uint8_t)v) : (uint8_t)v; };
+    float shown[256];
+    for (int v = 0; v < 256; ++v) shown[v] = PanelShown(out(v), pwm_bits);
+
+    // The steps the panel shows, each by the first value that shows it
+    uint8_t step_values[256];
+    int step_count = 0;
+    for (int v = 0; v < 256; ++v) {
+        if (step_count == 0 || shown[v] != shown[step_values[step_count - 1]]) {
+            step_values[step_count++] = (uint8_t)v;
+        }
+    }
+    int s = 0;
+    for (int v = 0; v < 256; ++v) {
+        const float light = PanelLight(out(v));
+        while (s + 1 < step_count && shown[step_values[s + 1]] <= light) ++s;
+        Step& step = steps_[v];
+        step.low = step.high = step_values[s];
+        step.mix = 0;
+        if (s + 1 == step_count) continue;
+        step.high = step_values[s + 1];
+        const float low = shown[step.low], high = shown[step.high];
+        step.mix = (uint8_t)std::lround(16 * (light - low) / (high - low));
+    }
+}
+
+uint8_t PanelDither::Apply(uint8_t v, int x, int y) const {
+    const Step& step = steps_[v];
+    return BAYER[y & 3][x & 3] < step.mix ? step.high : step.low;
+}
+
+int BrightnessSchedule::Level(bool is_night, int hour) const {
+    if (dim_from >= 0 && dim_to >= 0) {
+        // The dim hours may wrap past midnight, e.g. 22 to 7
+        is_night = dim_from <= dim_to ? hour >= dim_from && hour < dim_to
+                                      : hour >= dim_from || hour < dim_to;
+    }
+    return is_night ? night : day;
+}
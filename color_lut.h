@@ -0,0 +1,82 @@
+#ifndef COLOR_LUT_H
+#define COLOR_LUT_H
+
+#include <stdint.h>
+
+// --- Colour pipeline ---
+// The last step of composing a frame: each channel of each pixel goes
+// through a 256-entry table, so brightness and gamma cost one lookup per
+// channel and can change without redrawing any layer.
+class ColorLut {
+public:
+    // `brightness` in percent (1-100). A `gamma` above 1 darkens the mid
+    // tones, on top of the matrix library's own luminance correction.
+    explicit ColorLut(int brightness = 100, float gamma = 1.0f);
+
+    void Apply(uint8_t& r, uint8_t& g, uint8_t& b) const {
+        r = table_[r];
+        g = table_[g];
+        b = table_[b];
+    }
+    uint8_t Map(uint8_t v) const { return table_[v]; }
+
+    int brightness() const { return brightness_; }
+    float gamma() const { return gamma_; }
+    // True if the table changes nothing (full brightness, gamma 1).
+    bool identity() const { return identity_; }
+
+private:
+    uint8_t table_[256];
+    int brightness_;
+    float gamma_;
+    bool identity_;
+};
+
+// --- The panel's response ---
+// rgb_matrix turns each 8-bit channel into light through the CIE1931
+// lightness curve, as an 11-bit PWM duty, and drops the low bits of that
+// when run with fewer --led-pwm-bits.
+const int PANEL_PWM_BITS = 11;   // the library's most, and its default
+
+// The light `v` asks for, 0 to 1.
+float PanelLight(uint8_t v);
+// The value asking for `light` (0 to 1), rounded; PanelLight()'s inverse.
+uint8_t PanelValue(float light);
+// The light the panel actually shows for `v` with `pwm_bits` of PWM.
+float PanelShown(uint8_t v, int pwm_bits);
+
+// Ordered dithering to what `pwm_bits` can show. With fewer bits the
+// dim values fall between the few steps left, so gradients band and dim
+// edges vanish; instead each value is drawn as a 4x4 pattern of the steps
+// either side of it, mixed so the light averages out to its own.
+//
+// With `lut` the steps are those left after the table the compositor
+// passes pixels through, so a dimmed panel gets the same smooth mix; the
+// values returned are still the table's inputs.
+class PanelDither {
+public:
+    explicit PanelDither(int pwm_bits, const ColorLut* lut = nullptr);
+
+    // `v` as drawn at (x, y).
+    uint8_t Apply(uint8_t v, int x, int y) const;
+
+private:
+    struct Step {
+        uint8_t low, high;   // values shown at the steps either side
+        uint8_t mix;         // of the 16 pattern cells, how many get `high`
+    };
+    Step steps_[256];
+};
+
+// How bright the panel is by day and by night. Night is sunset to sunrise
+// as IsNight() has it, or the configured hours if there are any.
+struct BrightnessSchedule {
+    int day = 100;        // percent
+    int night = 40;
+    int dim_from = -1;    // local hours, e.g. 22 and 7; -1 follows the sun
+    int dim_to = -1;
+
+    int Level(bool is_night, int hour) const;
+};
+
+#endif
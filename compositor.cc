@@ -0,0 +1,179 @@
+#include "compositor.h"
+
+#include <algorithm>
+#include <limits.h>
+
+Rect Union(const Rect& a, const Rect& b) {
+    if (a.empty()) return b;
+    if (b.empty()) return a;
+    int x = std::min(a.x, b.x), y = std::min(a.y, b.y);
+    return Rect(x, y, std::max(a.right(), b.right()) - x, std::max(a.bottom(), b.bottom()) - y);
+}
+
+Rect Intersect(const Rect& a, const Rect& b) {
+    int x = std::max(a.x, b.x), y = std::max(a.y, b.y);
+    int w = std::min(a.right(), b.right()) - x, h = std::min(a.bottom(), b.bottom()) - y;
+    if (w <= 0 || h <= 0) return Rect();
+    return Rect(x, y, w, h);
+}
+
+namespace {
+
+// True if the rectangles overlap or share an edge.
+bool Touches(const Rect& a, const Rect& b) {
+    return a.x <= b.right() && b.x <= a.right() && a.y <= b.bottom() && b.y <= a.bottom();
+}
+
+}  // namespace
+
+// --- Damage ---
+void Damage::Add(const Rect& r) {
+    if (r.empty()) return;
+    Rect merged = r;
+    // Absorb every rectangle the new one touches; the union may reach
+    // further ones, so keep going until nothing changes.
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t i = 0; i < count_; ++i) {
+            if (!Touches(merged, rects_[i])) continue;
+            merged = Union(merged, rects_[i]);
+            rects_[i] = rects_[--count_];
+            changed = true;
+            break;
+        }
+    }
+
+    if (count_ == MAX_RECTS) {
+        for (const Rect& rect : *this) merged = Union(merged, rect);
+        count_ = 0;
+    }
+    rects_[count_++] = merged;
+}
+
+void Damage::Add(const Damage& other) {
+    for (const Rect& r : other) Add(r);
+}
+
+int Damage::Area() const {
+    int area = 0;
+    for (const Rect& r : *this) area += r.w * r.h;
+    return area;
+}
+
+// --- Layer ---
+Layer::Layer(int width, int height) : Layer(width, height, Rect(0, 0, width, height)) {}
+
+Layer::Layer(int width, int height, const Rect& area)
+    : width_(width), height_(height), area_(Intersect(area, Rect(0, 0, width, height))),
+      texels_((size_t)area_.w * area_.h, Texel{0, 0, 0, 0}),
+      min_x_(INT_MAX), min_y_(INT_MAX), max_x_(INT_MIN), max_y_(INT_MIN) {}
+
+void Layer::SetPixel(int x, int y, uint8_t r, uint8_t g, uint8_t b) {
+    if (x < area_.x || x >= area_.right() || y < area_.y || y >= area_.bottom()) return;
+    texels_[(y - area_.y) * area_.w + (x - area_.x)] = Texel{r, g, b, 255};
+    if (x < min_x_) min_x_ = x;
+    if (x > max_x_) max_x_ = x;
+    if (y < min_y_) min_y_ = y;
+    if (y > max_y_) max_y_ = y;
+}
+
+void Layer::FlushDrawn() {
+    if (max_x_ < min_x_) return;
+    Rect drawn(min_x_, min_y_, max_x_ - min_x_ + 1, max_y_ - min_y_ + 1);
+    damage_.Add(drawn);
+    content_ = Union(content_, drawn);
+    min_x_ = min_y_ = INT_MAX;
+    max_x_ = max_y_ = INT_MIN;
+}
+
+void Layer::Clear() {
+    FlushDrawn();
+    ClearRect(content_);
+    content_ = Rect();
+}
+
+void Layer::Fill(uint8_t r, uint8_t g, uint8_t b) {
+    std::fill(texels_.begin(), texels_.end(), Texel{r, g, b, 255});
+    content_ = area_;
+    damage_.Add(content_);
+}
+
+void Layer::ClearRect(const Rect& rect) {
+    Rect r = Intersect(rect, area_);
+    if (r.empty()) return;
+    for (int y = r.y; y < r.bottom(); ++y) {
+        Texel* row = &texels_[(y - area_.y) * area_.w + (r.x - area_.x)];
+        std::fill(row, row + r.w, Texel{0, 0, 0, 0});
+    }
+    damage_.Add(r);
+}
+
+void Layer::TakeDamage(Damage& out) {
+    FlushDrawn();
+    out.Add(damage_);
+    damage_.Clear();
+}
+
+Rect DrawableArea(const rgb_matrix::Canvas* canvas) {
+    if (const Layer* layer = dynamic_cast<const Layer*>(canvas)) return layer->area();
+    return Rect(0, 0, canvas->width(), canvas->height());
+}
+
+// --- Compositor ---
+Compositor::Compositor(int width, int height, int buffer_count)
+    : Compositor(Rect(0, 0, width, height), buffer_count) {}
+
+Compositor::Compositor(const Rect& area, int buffer_count)
+    : bounds_(area) {
+    // The buffers start out with unknown contents, so the first frame
+    // drawn into each of them is drawn in full.
+    Damage all;
+    all.Add(bounds_);
+    history_.assign(std::max(buffer_count - 1, 0), all);
+}
+
+bool Compositor::Compose(rgb_matrix::Canvas* target) {
+    if (!Prepare()) return false;
+    Draw(target);
+    return true;
+}
+
+void Compositor::SetColorLut(const ColorLut* lut) {
+    lut_ = lut && !lut->identity() ? lut : nullptr;
+    pending_.Add(bounds_);
+}
+
+bool Compositor::Prepare() {
+    for (Layer* layer : layers_) layer->TakeDamage(pending_);
+    return !pending_.empty();
+}
+
+void Compositor::Draw(rgb_matrix::Canvas* target) {
+    Damage redraw = pending_;
+    for (const Damage& older : history_) redraw.Add(older);
+    if (!history_.empty()) {
+        history_.erase(history_.begin());
+        history_.push_back(pending_);
+    }
+    pending_.Clear();
+
+    last_area_ = 0;
+    for (const Rect& rect : redraw) {
+        Rect r = Intersect(rect, bounds_);
+        ComposeRect(target, r);
+        last_area_ += r.w * r.h;
+    }
+}
+
+void Compositor::ComposeRect(rgb_matrix::Canvas* target, const Rect& rect) const {
+    for (int y = rect.y; y < rect.bottom(); ++y) {
+        for (int x = rect.x; x < rect.right(); ++x) {
+            uint8_t r = 0, g = 0, b = 0;
+            for (auto it = layers_.rbegin(); it != layers_.rend(); ++it) {
+                if ((*it)->Get(x, y, r, g, b)) break;
+            }
+            if (lut_) lut_->Apply(r, g, b);
+            target->SetPixel(x, y, r, g, b);
+        }
+    }
+}
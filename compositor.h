@@ -0,0 +1,153 @@
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include "canvas.h"
+#include "color_lut.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+struct Rect {
+    int x = 0, y = 0, w = 0, h = 0;
+
+    Rect() = default;
+    Rect(int x, int y, int w, int h) : x(x), y(y), w(w), h(h) {}
+
+    bool empty() const { return w <= 0 || h <= 0; }
+    int right() const { return x + w; }
+    int bottom() const { return y + h; }
+};
+
+// Smallest rectangle containing both.
+Rect Union(const Rect& a, const Rect& b);
+Rect Intersect(const Rect& a, const Rect& b);
+
+// A set of damaged rectangles. Overlapping or touching rectangles are
+// merged as they are added, and past MAX_RECTS everything collapses into
+// one bounding box, so the set stays small however much is drawn. The
+// rectangles are stored inline, so copying a set never allocates.
+class Damage {
+public:
+    static const size_t MAX_RECTS = 16;
+
+    void Add(const Rect& r);
+    void Add(const Damage& other);
+    void Clear() { count_ = 0; }
+    bool empty() const { return count_ == 0; }
+    const Rect* begin() const { return rects_; }
+    const Rect* end() const { return rects_ + count_; }
+
+    // Total pixels covered (rectangles never overlap).
+    int Area() const;
+
+private:
+    Rect rects_[MAX_RECTS];
+    size_t count_ = 0;
+};
+
+// An off-screen RGBA canvas that remembers which parts changed. Pixels
+// that were never drawn since the last clear are transparent, so black
+// text (e.g. an outline) still covers the layers below.
+//
+// A layer may store just `area` of its width x height canvas, e.g. one
+// band of the screen for the tiled renderer. Coordinates stay those of
+// the whole canvas and pixels outside the area are dropped.
+class Layer : public rgb_matrix::Canvas {
+public:
+    Layer(int width, int height);
+    Layer(int width, int height, const Rect& area);
+
+    int width() const override { return width_; }
+    int height() const override { return height_; }
+    void SetPixel(int x, int y, uint8_t r, uint8_t g, uint8_t b) override;
+    // Makes everything drawn so far transparent again; only what was
+    // actually drawn is damaged.
+    void Clear() override;
+    void Fill(uint8_t r, uint8_t g, uint8_t b) override;
+
+    // Makes `r` transparent and damages it.
+    void ClearRect(const Rect& r);
+
+    const Rect& area() const { return area_; }
+
+    // Topmost-first lookup used by the compositor; false if transparent.
+    // (x, y) must be inside the area.
+    bool Get(int x, int y, uint8_t& r, uint8_t& g, uint8_t& b) const {
+        const Texel& t = texels_[(y - area_.y) * area_.w + (x - area_.x)];
+        r = t.r; g = t.g; b = t.b;
+        return t.a != 0;
+    }
+
+    // Moves this layer's damage since the last call into `out`.
+    void TakeDamage(Damage& out);
+
+private:
+    struct Texel { uint8_t r, g, b, a; };
+
+    void FlushDrawn();
+
+    int width_, height_;
+    Rect area_;
+    std::vector<Texel> texels_;
+    Damage damage_;
+    // Bounding box of SetPixel calls not yet added to damage_, kept as
+    // min/max so drawing a pixel stays a couple of compares.
+    int min_x_, min_y_, max_x_, max_y_;
+    Rect content_;  // everything drawn since the last Clear()
+};
+
+// The part of `canvas` that keeps what is drawn: a Layer's area, else the
+// whole canvas. Lets drawing code skip the rows a band of the tiled
+// renderer would drop anyway.
+Rect DrawableArea(const rgb_matrix::Canvas* canvas);
+
+// Stacks layers (first added is at the bottom) and recomposes only their
+// damaged regions into the target canvas. Black shows through where no
+// layer is drawn.
+//
+// The target is expected to be one of `buffer_count` canvases that are
+// cycled by SwapOnVSync, so a region damaged in one frame is also redrawn
+// in the next buffer_count - 1 frames to bring every buffer up to date.
+class Compositor {
+public:
+    Compositor(int width, int height, int buffer_count = 2);
+    // Composes only `area` of the target, from layers covering that area.
+    Compositor(const Rect& area, int buffer_count = 2);
+
+    // Layers must cover the compositor's area.
+    void AddLayer(Layer* layer) { layers_.push_back(layer); }
+
+    // Passes every composed pixel through `lut` (nullptr for none) and
+    // damages the whole area, so the next frames recompose it from the
+    // layers as they are. The table must outlive its use.
+    void SetColorLut(const ColorLut* lut);
+
+    // Collects the layers' damage and redraws it into `target`. Returns
+    // false, without touching `target`, if nothing changed since the last
+    // composed frame, in which case the swap can be skipped.
+    bool Compose(rgb_matrix::Canvas* target);
+
+    // Compose() in two steps, for when several compositors share a frame:
+    // Prepare() collects the damage and says whether there is any, and
+    // Draw() redraws it. Once any of them has damage the frame is swapped,
+    // so every one must Draw() to keep its part of each buffer current.
+    bool Prepare();
+    void Draw(rgb_matrix::Canvas* target);
+
+    // Pixels redrawn by the last Compose().
+    int last_area() const { return last_area_; }
+
+private:
+    void ComposeRect(rgb_matrix::Canvas* target, const Rect& r) const;
+
+    Rect bounds_;
+    std::vector<Layer*> layers_;
+    // Damage of the last buffer_count - 1 composed frames, newest last.
+    std::vector<Damage> history_;
+    Damage pending_;   // collected by Prepare(), not yet drawn
+    const ColorLut* lut_ = nullptr;
+    int last_area_ = 0;
+};
+
+#endif
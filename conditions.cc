@@ -0,0 +1,27 @@
+#include "conditions.h"
+
+// Spot checks of the tables, including the cases the old description
+// matching got wrong or depended on branch order for.
+static_assert(OwmSky(201) == Sky::Thunder, "thunderstorm with rain");
+static_assert(OwmSky(313) == Sky::Drizzle, "shower rain and drizzle");
+static_assert(OwmSky(600) == Sky::Snow, "light snow");
+static_assert(OwmSky(616) == Sky::Snow, "rain and snow");
+static_assert(OwmSky(801) == Sky::PartlyCloudy, "few clouds");
+static_assert(OwmSky(804) == Sky::Cloudy, "overcast clouds");
+static_assert(OwmSky(751) == Sky::Unknown, "sand");
+static_assert(OwmSky(0) == Sky::Unknown && WmoSky(-1) == Sky::Unknown, "no code");
+static_assert(WmoSky(3) == Sky::Cloudy && WmoSky(96) == Sky::Thunder, "WMO codes");
+static_assert(ConditionSky(0, 61) == Sky::Rain, "Open-Meteo fills in for OpenWeather");
+static_assert(SelectIcon(Sky::Clear, true) == IconId::Moon, "night variant");
+
+bool IsNight(const WeatherData& data, time_t now, int local_hour) {
+    if (data.sunrise > 0 && data.sunset > data.sunrise) {
+        // The times are for the day the data was fetched; a cached reply
+        // may be from yesterday, so compare the time of day only.
+        const long DAY = 24 * 3600;
+        long since_sunrise = ((long)(now - data.sunrise) % DAY + DAY) % DAY;
+        return since_sunrise >= (long)(data.sunset - data.sunrise);
+    }
+    if (data.is_day >= 0) return data.is_day == 0;
+    return local_hour < 6 || local_hour >= 18;
+}
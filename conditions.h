@@ -0,0 +1,148 @@
+#ifndef CONDITIONS_H
+#define CONDITIONS_H
+
+#include "icons.h"
+#include "weather.h"
+
+#include <array>
+#include <stdint.h>
+#include <time.h>
+
+// --- Weather condition codes to icons ---
+// Both providers report the sky as a number: OpenWeather as its condition
+// id (https://openweathermap.org/weather-conditions), Open-Meteo as a WMO
+// weather code. Each is looked up in a table built at compile time, so
+// picking an icon is one array index and no string handling.
+
+enum class Sky : uint8_t {
+    Unknown, Clear, PartlyCloudy, Cloudy, Thunder, Drizzle, Rain, Snow,
+    Fog, Haze, Smoke, Ash, Count
+};
+
+struct CodeRange {
+    int first, last;
+    Sky sky;
+};
+
+// OpenWeather condition ids, 200-804.
+constexpr CodeRange OWM_CONDITIONS[] = {
+    {200, 299, Sky::Thunder},       // thunderstorm, with or without rain
+    {300, 399, Sky::Drizzle},
+    {500, 599, Sky::Rain},          // incl. freezing rain and showers
+    {600, 699, Sky::Snow},          // incl. sleet and rain and snow
+    {701, 701, Sky::Fog},           // mist
+    {711, 711, Sky::Smoke},
+    {721, 721, Sky::Haze},
+    {741, 741, Sky::Fog},
+    {762, 762, Sky::Ash},           // volcanic ash
+    {800, 800, Sky::Clear},
+    {801, 802, Sky::PartlyCloudy},  // few / scattered clouds
+    {803, 804, Sky::Cloudy},        // broken clouds / overcast
+};
+
+// WMO weather codes as used by Open-Meteo, 0-99.
+constexpr CodeRange WMO_CONDITIONS[] = {
+    {0, 0, Sky::Clear},
+    {1, 2, Sky::PartlyCloudy},      // mainly clear, partly cloudy
+    {3, 3, Sky::Cloudy},            // overcast
+    {45, 48, Sky::Fog},             // fog, depositing rime fog
+    {51, 57, Sky::Drizzle},         // incl. freezing drizzle
+    {61, 67, Sky::Rain},            // incl. freezing rain
+    {71, 77, Sky::Snow},            // snow fall, snow grains
+    {80, 82, Sky::Rain},            // rain showers
+    {85, 86, Sky::Snow},            // snow showers
+    {95, 99, Sky::Thunder},         // incl. hail
+};
+
+const int OWM_FIRST_CODE = 200;
+const int OWM_LAST_CODE = 804;
+const int WMO_LAST_CODE = 99;
+
+template <size_t N, size_t M>
+constexpr std::array<Sky, N> BuildSkyTable(const CodeRange (&ranges)[M], int first_code) {
+    std::array<Sky, N> table{};
+    for (const CodeRange& r : ranges) {
+        for (int code = r.first; code <= r.last; ++code) table[code - first_code] = r.sky;
+    }
+    return table;
+}
+
+constexpr std::array<Sky, OWM_LAST_CODE - OWM_FIRST_CODE + 1> OWM_SKY =
+    BuildSkyTable<OWM_LAST_CODE - OWM_FIRST_CODE + 1>(OWM_CONDITIONS, OWM_FIRST_CODE);
+constexpr std::array<Sky, WMO_LAST_CODE + 1> WMO_SKY =
+    BuildSkyTable<WMO_LAST_CODE + 1>(WMO_CONDITIONS, 0);
+
+constexpr Sky OwmSky(int id) {
+    return id < OWM_FIRST_CODE || id > OWM_LAST_CODE ? Sky::Unknown : OWM_SKY[id - OWM_FIRST_CODE];
+}
+constexpr Sky WmoSky(int code) {
+    return code < 0 || code > WMO_LAST_CODE ? Sky::Unknown : WMO_SKY[code];
+}
+
+// Icon for each Sky, by day and by night.
+struct SkyIcons {
+    IconId day, night;
+};
+constexpr SkyIcons SKY_ICONS[] = {
+    {IconId::Friend, IconId::Friend},              // Unknown
+    {IconId::Sun, IconId::Moon},                   // Clear
+    {IconId::PartlyCloudy, IconId::MoonPartlyCloud},
+    {IconId::Cloud, IconId::MoonCloud},
+    {IconId::Thunder, IconId::Thunder},
+    {IconId::Drizzle, IconId::Drizzle},
+    {IconId::Rain, IconId::Rain},
+    {IconId::Snow, IconId::Snow},
+    {IconId::Fog, IconId::Fog},
+    {IconId::Haze, IconId::Haze},
+    {IconId::Smoke, IconId::Smoke},
+    {IconId::Ash, IconId::Ash},
+};
+static_assert(sizeof(SKY_ICONS) / sizeof(SKY_ICONS[0]) == (size_t)Sky::Count,
+              "SKY_ICONS needs one entry per Sky");
+
+// The sky from the best code available: OpenWeather's, else Open-Meteo's.
+constexpr Sky ConditionSky(int owm_id, int wmo_code) {
+    return OwmSky(owm_id) != Sky::Unknown ? OwmSky(owm_id) : WmoSky(wmo_code);
+}
+
+constexpr IconId SelectIcon(Sky sky, bool night) {
+    return night ? SKY_ICONS[(int)sky].night : SKY_ICONS[(int)sky].day;
+}
+
+inline IconId SelectIcon(const WeatherData& data, bool night) {
+    return SelectIcon(ConditionSky(data.condition, data.wmo_code), night);
+}
+
+// SKY_ICONS with some entries swapped for others, e.g. from the config
+// file. The weather layer picks its icon from one when given one.
+class IconMap {
+public:
+    IconMap() {
+        for (int i = 0; i < (int)Sky::Count; ++i) icons_[i] = SKY_ICONS[i];
+    }
+
+    void Set(Sky sky, IconId day, IconId night) { icons_[(int)sky] = {day, night}; }
+
+    IconId Select(const WeatherData& data, bool night) const {
+        const SkyIcons& icons = icons_[(int)ConditionSky(data.condition, data.wmo_code)];
+        return night ? icons.night : icons.day;
+    }
+
+    bool operator==(const IconMap& other) const {
+        for (int i = 0; i < (int)Sky::Count; ++i) {
+            if (icons_[i].day != other.icons_[i].day || icons_[i].night != other.icons_[i].night)
+                return false;
+        }
+        return true;
+    }
+    bool operator!=(const IconMap& other) const { return !(*this == other); }
+
+private:
+    SkyIcons icons_[(int)Sky::Count];
+};
+
+// Whether it is dark at `now`: from OpenWeather's sunrise/sunset, else
+// Open-Meteo's is_day, else the local hour (before 6 or from 18 on).
+bool IsNight(const WeatherData& data, time_t now, int local_hour);
+
+#endif
@@ -0,0 +1,204 @@
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+namespace {
+
+const char* const SKY_NAMES[] = {
+    "unknown", "clear", "partly_cloudy", "cloudy", "thunder", "drizzle", "rain", "snow",
+    "fog", "haze", "smoke", "ash",
+};
+static_assert(sizeof(SKY_NAMES) / sizeof(SKY_NAMES[0]) == (size_t)Sky::Count,
+              "SKY_NAMES needs one entry per Sky");
+
+std::string Trim(const std::string& s) {
+    size_t begin = s.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) return "";
+    size_t end = s.find_last_not_of(" \t\r");
+    return s.substr(begin, end - begin + 1);
+}
+
+bool ParseInt(const std::string& value, int min, int max, int* out) {
+    char* end;
+    long n = strtol(value.c_str(), &end, 10);
+    if (value.empty() || *end || n < min || n > max) return false;
+    *out = (int)n;
+    return true;
+}
+
+bool ParseText(const std::string& value, std::string* out) {
+    if (value.empty()) return false;
+    *out = value;
+    return true;
+}
+
+bool ParseSwitch(const std::string& value, bool* out) {
+    if (value == "on") *out = true;
+    else if (value == "off") *out = false;
+    else return false;
+    return true;
+}
+
+// "R,G,B" or "#rrggbb"
+bool ParseColor(const std::string& value, rgb_matrix::Color* out) {
+    int r, g, b;
+    char extra;
+    if (value.size() == 7 && value[0] == '#' &&
+        sscanf(value.c_str() + 1, "%2x%2x%2x%c", &r, &g, &b, &extra) == 3) {
+        *out = rgb_matrix::Color(r, g, b);
+        return true;
+    }
+    if (sscanf(value.c_str(), "%d ,%d ,%d%c", &r, &g, &b, &extra) == 3 &&
+        r >= 0 && r <= 255 && g >= 0 && g <= 255 && b >= 0 && b <= 255) {
+        *out = rgb_matrix::Color(r, g, b);
+        return true;
+    }
+    return false;
+}
+
+bool ParseIcon(const std::string& name, IconId* out) {
+    for (size_t i = 0; i < ICON_SOURCE_COUNT; ++i) {
+        if (name == ICON_SOURCES[i].name) {
+            *out = ICON_SOURCES[i].id;
+            return true;
+        }
+    }
+    return false;
+}
+
+// One "key = value" line applied to `config`; false if either is bad.
+bool ApplySetting(const std::string& key, const std::string& value, ClockConfig* config) {
+    WeatherConfig& weather = config->weather;
+    BrightnessSchedule& brightness = config->brightness;
+    if (key == "lat") return ParseText(value, &weather.lat);
+    if (key == "lon") return ParseText(value, &weather.lon);
+    if (key == "api_key") return ParseText(value, &weather.api_key);
+    if (key == "units") {
+        if (value == "imperial") weather.units = Units::Imperial;
+        else if (value == "metric") weather.units = Units::Metric;
+        else return false;
+        return true;
+    }
+    if (key == "openweather") return ParseSwitch(value, &weather.enabled[PROVIDER_OPENWEATHER]);
+    if (key == "open_meteo") return ParseSwitch(value, &weather.enabled[PROVIDER_OPEN_METEO]);
+    if (key == "fresh_seconds") return ParseInt(value, 60, 86400, &weather.fresh_seconds);
+    if (key == "stale_seconds") return ParseInt(value, 60, 7 * 86400, &weather.stale_seconds);
+    if (key == "clock_color") return ParseColor(value, &config->clock_color);
+    if (key == "ticker_color") return ParseColor(value, &config->ticker_color);
+    if (key == "date_color") return ParseColor(value, &config->date_color);
+    if (key == "outline_color") return ParseColor(value, &config->outline_color);
+    if (key == "rain_color") return ParseColor(value, &config->rain_color);
+    if (key == "brightness") return ParseInt(value, 1, 100, &brightness.day);
+    if (key == "night_brightness") return ParseInt(value, 1, 100, &brightness.night);
+    if (key == "dim_hours") {
+        int from, to;
+        char extra;
+        if (value == "sun") {
+            brightness.dim_from = brightness.dim_to = -1;
+            return true;
+        }
+        if (sscanf(value.c_str(), "%d-%d%c", &from, &to, &extra) != 2 ||
+            from < 0 || from > 23 || to < 0 || to > 23) return false;
+        brightness.dim_from = from;
+        brightness.dim_to = to;
+        return true;
+    }
+    if (key == "gamma") {
+        char* end;
+        float gamma = strtof(value.c_str(), &end);
+        if (value.empty() || *end || !(gamma >= 0.5f && gamma <= 3.0f)) return false;
+        config->gamma = gamma;
+        return true;
+    }
+    if (key.compare(0, 5, "icon.") == 0) {
+        const char* const* sky = std::find(std::begin(SKY_NAMES), std::end(SKY_NAMES),
+                                           key.substr(5));
+        if (sky == std::end(SKY_NAMES)) return false;
+        size_t comma = value.find(',');
+        IconId day, night;
+        if (!ParseIcon(Trim(value.substr(0, comma)), &day)) return false;
+        if (comma == std::string::npos) night = day;
+        else if (!ParseIcon(Trim(value.substr(comma + 1)), &night)) return false;
+        config->icons.Set((Sky)(sky - std::begin(SKY_NAMES)), day, night);
+        return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+bool LoadConfig(const std::string& path, ClockConfig* config, std::string* error) {
+    std::ifstream in(path);
+    if (!in) {
+        *error = "can't read " + path;
+        return false;
+    }
+
+    ClockConfig loaded = *config;
+    bool clock_color = false, ticker_color = false, date_color = false;
+    std::string line;
+    for (int number = 1; std::getline(in, line); ++number) {
+        line = Trim(line);
+        if (line.empty() || line[0] == '#') continue;
+        size_t eq = line.find('=');
+        std::string key = eq == std::string::npos ? line : Trim(line.substr(0, eq));
+        std::string value = eq == std::string::npos ? "" : Trim(line.substr(eq + 1));
+        if (eq == std::string::npos || !ApplySetting(key, value, &loaded)) {
+            std::ostringstream message;
+            message << path << ":" << number << ": bad setting \"" << line << "\"";
+            *error = message.str();
+            return false;
+        }
+        clock_color |= key == "clock_color";
+        ticker_color |= key == "ticker_color";
+        date_color |= key == "date_color";
+    }
+    // The day and date follow the time's colour unless given their own
+    if (clock_color && !ticker_color) loaded.ticker_color = loaded.clock_color;
+    if (clock_color && !date_color) loaded.date_color = loaded.clock_color;
+    if (loaded.weather.stale_seconds < loaded.weather.fresh_seconds) {
+        *error = path + ": stale_seconds is shorter than fresh_seconds";
+        return false;
+    }
+    *config = loaded;
+    return true;
+}
+
+// --- ConfigWatcher ---
+ConfigWatcher::ConfigWatcher(const std::string& path) {
+    size_t slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : path.substr(0, slash ? slash : 1);
+    name_ = slash == std::string::npos ? path : path.substr(slash + 1);
+
+    fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ < 0) return;
+    // A finished write, or another file renamed over it
+    if (inotify_add_watch(fd_, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+ConfigWatcher::~ConfigWatcher() {
+    if (fd_ >= 0) close(fd_);
+}
+
+bool ConfigWatcher::Changed() {
+    if (fd_ < 0) return false;
+    bool changed = false;
+    ssize_t n;
+    while ((n = read(fd_, events_, sizeof(events_))) > 0) {
+        for (const char* p = events_; p < events_ + n;) {
+            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(p);
+            if (event->len > 0 && name_ == event->name) changed = true;
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+    return changed;
+}
@@ -0,0 +1,75 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "graphics.h"
+
+#include "color_lut.h"
+#include "conditions.h"
+#include "weather.h"
+
+#include <sys/inotify.h>
+#include <string>
+
+// --- Configuration file ---
+// Settings that can change while the clock runs, as "key = value" lines;
+// lines starting with '#' are comments. Every key is optional:
+//
+//   lat, lon, api_key           where to ask for, and OpenWeather's key
+//   units                       imperial or metric
+//   openweather, open_meteo     on or off
+//   fresh_seconds, stale_seconds  cache TTLs, see weather_cache.h
+//   clock_color                 R,G,B or #rrggbb, for the time, and for the
+//                               day and date unless set below
+//   ticker_color, date_color    the day and weather text, and the date
+//   outline_color               around the temperature
+//   rain_color                  the forecast's chance of rain bars
+//   brightness, night_brightness  percent
+//   dim_hours                   e.g. 22-7, or "sun" for sunset to sunrise
+//   gamma                       0.5-3
+//   icon.<sky>                  icon, or day icon,night icon
+//
+// Skies are unknown, clear, partly_cloudy, cloudy, thunder, drizzle, rain,
+// snow, fog, haze, smoke and ash; icons are named as in ICON_SOURCES
+// (their file names in icons/). clock.conf.example has them all.
+struct ClockConfig {
+    WeatherConfig weather;
+    rgb_matrix::Color clock_color = rgb_matrix::Color(255, 255, 255);
+    rgb_matrix::Color ticker_color = rgb_matrix::Color(255, 255, 255);
+    rgb_matrix::Color date_color = rgb_matrix::Color(255, 255, 255);
+    rgb_matrix::Color outline_color = rgb_matrix::Color(0, 0, 0);
+    rgb_matrix::Color rain_color = rgb_matrix::Color(0, 40, 120);
+    BrightnessSchedule brightness;
+    float gamma = 1.0f;
+    IconMap icons;
+};
+
+// Reads `path` over `config`: what the file sets replaces what `config`
+// holds, everything else is kept. If the file can't be read or has a bad
+// line, returns false with the reason in `error` and leaves `config` as
+// it was.
+bool LoadConfig(const std::string& path, ClockConfig* config, std::string* error);
+
+// Notices the config file being saved, through inotify on its directory so
+// that editors replacing the file by a rename are seen as well. Changed()
+// never blocks and is a single read() while nothing happens, so the render
+// loop asks every tick.
+class ConfigWatcher {
+public:
+    explicit ConfigWatcher(const std::string& path);
+    ~ConfigWatcher();
+
+    ConfigWatcher(const ConfigWatcher&) = delete;
+    ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+    bool ok() const { return fd_ >= 0; }
+
+    // True if the file was written or replaced since the last call.
+    bool Changed();
+
+private:
+    int fd_ = -1;
+    std::string name_;   // the file's name in the watched directory
+    alignas(struct inotify_event) char events_[4096];
+};
+
+#endif
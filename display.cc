@@ -0,0 +1,104 @@
+#include "display.h"
+#include "lodepng.h"
+
+#include <string.h>
+#include <iostream>
+
+namespace {
+
+bool EndsWith(const std::string& s, const char* suffix) {
+    size_t n = strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+// True if `path` holds exactly one %d-style conversion, e.g. "%05d".
+bool IsFramePattern(const std::string& path) {
+    size_t pct = path.find('%');
+    if (pct == std::string::npos) return false;
+    size_t end = path.find_first_not_of("0123456789", pct + 1);
+    return end != std::string::npos && path[end] == 'd' &&
+           path.find('%', end) == std::string::npos;
+}
+
+}  // namespace
+
+void MemoryCanvas::Fill(uint8_t r, uint8_t g, uint8_t b) {
+    for (size_t i = 0; i < pixels_.size(); i += 3) {
+        pixels_[i] = r;
+        pixels_[i + 1] = g;
+        pixels_[i + 2] = b;
+    }
+}
+
+bool WritePPM(const std::string& path, const MemoryCanvas& frame) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    fprintf(f, "P6\n%d %d\n255\n", frame.width(), frame.height());
+    bool ok = fwrite(frame.data(), 1, frame.size(), f) == frame.size();
+    return fclose(f) == 0 && ok;
+}
+
+// --- MatrixDisplay ---
+MatrixDisplay::MatrixDisplay(rgb_matrix::RGBMatrix* matrix)
+    : matrix_(matrix), offscreen_(matrix->CreateFrameCanvas()) {}
+
+MatrixDisplay::~MatrixDisplay() {
+    delete matrix_;
+}
+
+// --- MemoryDisplay ---
+MemoryDisplay::MemoryDisplay(int width, int height, const std::string& dump_path)
+    : width_(width), height_(height),
+      buffers_{MemoryCanvas(width, height), MemoryCanvas(width, height)},
+      dump_path_(dump_path) {
+    if (dump_path.empty()) {
+        dump_ = Dump::None;
+    } else if (EndsWith(dump_path, ".ppm")) {
+        dump_ = Dump::Ppm;
+    } else if (EndsWith(dump_path, ".png")) {
+        dump_ = Dump::Png;
+    } else {
+        dump_ = Dump::Raw;
+        raw_ = dump_path == "-" ? stdout : fopen(dump_path.c_str(), "wb");
+        if (!raw_) {
+            std::cerr << "Couldn't open " << dump_path << " for frames" << std::endl;
+            dump_ = Dump::None;
+        }
+    }
+}
+
+MemoryDisplay::~MemoryDisplay() {
+    if (raw_ && raw_ != stdout) fclose(raw_);
+    else if (raw_) fflush(raw_);
+}
+
+void MemoryDisplay::Swap() {
+    back_ ^= 1;
+    ++frames_;
+    DumpFrame(front());
+}
+
+void MemoryDisplay::DumpFrame(const MemoryCanvas& frame) {
+    if (dump_ == Dump::None) return;
+    if (dump_ == Dump::Raw) {
+        if (fwrite(frame.data(), 1, frame.size(), raw_) != frame.size()) {
+            std::cerr << "Couldn't write frame to " << dump_path_ << ", no longer dumping" << std::endl;
+            dump_ = Dump::None;
+        }
+        return;
+    }
+
+    std::string path = dump_path_;
+    if (IsFramePattern(dump_path_)) {
+        std::vector<char> buf(dump_path_.size() + 32);
+        snprintf(buf.data(), buf.size(), dump_path_.c_str(), frames_);
+        path = buf.data();
+    }
+    bool ok = dump_ == Dump::Ppm
+        ? WritePPM(path, frame)
+        : lodepng::encode(path, frame.data(), width_, height_, LCT_RGB) == 0;
+    if (!ok) {
+        std::cerr << "Couldn't write frame " << path << ", no longer dumping" << std::endl;
+        dump_ = Dump::None;
+    }
+}
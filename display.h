@@ -0,0 +1,115 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include "canvas.h"
+#include "led-matrix.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// Plain RGB framebuffer, row-major, 3 bytes per pixel.
+class MemoryCanvas : public rgb_matrix::Canvas {
+public:
+    MemoryCanvas(int width, int height)
+        : width_(width), height_(height), pixels_((size_t)width * height * 3, 0) {}
+
+    int width() const override { return width_; }
+    int height() const override { return height_; }
+    void SetPixel(int x, int y, uint8_t r, uint8_t g, uint8_t b) override {
+        if (x < 0 || x >= width_ || y < 0 || y >= height_) return;
+        uint8_t* p = &pixels_[((size_t)y * width_ + x) * 3];
+        p[0] = r; p[1] = g; p[2] = b;
+    }
+    void Clear() override { Fill(0, 0, 0); }
+    void Fill(uint8_t r, uint8_t g, uint8_t b) override;
+
+    const uint8_t* data() const { return pixels_.data(); }
+    size_t size() const { return pixels_.size(); }
+
+private:
+    int width_, height_;
+    std::vector<uint8_t> pixels_;
+};
+
+// Where finished frames go: an LED matrix, or memory when there is none.
+// Rendering goes into BackBuffer(); Swap() shows it and makes another
+// buffer the back buffer, which keeps whatever it showed buffer_count()
+// frames ago.
+class Display {
+public:
+    virtual ~Display() {}
+
+    virtual int width() const = 0;
+    virtual int height() const = 0;
+    virtual int buffer_count() const { return 2; }
+    // Whether different rows of the back buffer can be drawn from
+    // different threads at the same time.
+    virtual bool concurrent_rows() const { return false; }
+
+    virtual rgb_matrix::Canvas* BackBuffer() = 0;
+    virtual void Swap() = 0;
+};
+
+// The real panel, double-buffered through SwapOnVSync. Rows that are
+// scanned out together share words of the frame canvas's bit planes, so
+// it is drawn from one thread only.
+class MatrixDisplay : public Display {
+public:
+    explicit MatrixDisplay(rgb_matrix::RGBMatrix* matrix);
+    ~MatrixDisplay() override;
+
+    int width() const override { return matrix_->width(); }
+    int height() const override { return matrix_->height(); }
+    rgb_matrix::Canvas* BackBuffer() override { return offscreen_; }
+    void Swap() override { offscreen_ = matrix_->SwapOnVSync(offscreen_); }
+
+private:
+    rgb_matrix::RGBMatrix* matrix_;
+    rgb_matrix::FrameCanvas* offscreen_;
+};
+
+// Renders into two MemoryCanvas buffers that are swapped like the
+// matrix's, so the compositor behaves exactly as on the device. Each
+// shown frame can be written out, depending on dump_path:
+//   ""                 nothing is written
+//   "*.ppm", "*.png"   one image per frame; a printf pattern such as
+//                      "frames/%05d.png" numbers them, otherwise the file
+//                      is overwritten with the latest frame
+//   "-" or any other   raw RGB24 frames appended to the file (stdout for
+//                      "-"), e.g. for ffmpeg -f rawvideo -pix_fmt rgb24
+class MemoryDisplay : public Display {
+public:
+    MemoryDisplay(int width, int height, const std::string& dump_path);
+    ~MemoryDisplay() override;
+
+    int width() const override { return width_; }
+    int height() const override { return height_; }
+    bool concurrent_rows() const override { return true; }
+    rgb_matrix::Canvas* BackBuffer() override { return &buffers_[back_]; }
+    void Swap() override;
+
+    // The frame shown last.
+    const MemoryCanvas& front() const { return buffers_[back_ ^ 1]; }
+    int frames() const { return frames_; }
+
+private:
+    enum class Dump { None, Ppm, Png, Raw };
+
+    void DumpFrame(const MemoryCanvas& frame);
+
+    int width_, height_;
+    MemoryCanvas buffers_[2];
+    int back_ = 0;
+    int frames_ = 0;
+
+    Dump dump_ = Dump::None;
+    std::string dump_path_;
+    FILE* raw_ = nullptr;
+};
+
+// Writes a binary PPM (P6); false on I/O errors.
+bool WritePPM(const std::string& path, const MemoryCanvas& frame);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef FIXED_STRING_H
+#define FIXED_STRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <ostream>
+#include <string>
+
+// --- Fixed strings ---
+// Short text stored inline, for values the render loop copies and
+// compares: assigning or copying one never touches the heap. Text longer
+// than N - 1 bytes is cut, at a UTF-8 character boundary.
+template <size_t N>
+class FixedString {
+public:
+    FixedString() { data_[0] = 0; }
+    FixedString(const char* s) { assign(s, strlen(s)); }
+    FixedString(const std::string& s) { assign(s.data(), s.size()); }
+
+    void assign(const char* s, size_t n) {
+        if (n > N - 1) {
+            n = N - 1;
+            while (n > 0 && ((uint8_t)s[n] & 0xC0) == 0x80) --n;
+        }
+        memcpy(data_, s, n);
+        data_[n] = 0;
+        size_ = n;
+    }
+
+    const char* c_str() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    char operator[](size_t i) const { return data_[i]; }
+
+private:
+    char data_[N];
+    size_t size_ = 0;
+};
+
+template <size_t N>
+bool operator==(const FixedString<N>& a, const FixedString<N>& b) {
+    return a.size() == b.size() && memcmp(a.c_str(), b.c_str(), a.size()) == 0;
+}
+
+template <size_t N>
+bool operator!=(const FixedString<N>& a, const FixedString<N>& b) { return !(a == b); }
+
+template <size_t N>
+std::ostream& operator<<(std::ostream& out, const FixedString<N>& s) { return out << s.c_str(); }
+
+#endif
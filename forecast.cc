@@ -0,0 +1,48 @@
+#include "forecast.h"
+
+void HourlyForecast::Add(time_t start, float temp, int precip, int code) {
+    const int32_t hour = Hour(start);
+    int i = size_;
+    if (size_ > 0 && hour <= hour_[Slot(size_ - 1)]) {
+        // Not newer than what is held: replace that hour, if it is there
+        i = Find(start);
+        if (i < 0) return;
+    } else if (size_ == CAPACITY) {
+        head_ = Slot(1);
+        i = size_ - 1;
+    } else {
+        ++size_;
+    }
+    const int slot = Slot(i);
+    hour_[slot] = hour;
+    temp_[slot] = temp;
+    precip_[slot] = (int8_t)(precip < 0 || precip > 100 ? UNKNOWN : precip);
+    code_[slot] = (int8_t)(code < 0 || code > 127 ? UNKNOWN : code);
+}
+
+void HourlyForecast::DropBefore(time_t now) {
+    const int32_t hour = Hour(now);
+    while (size_ > 0 && hour_[head_] < hour) {
+        head_ = Slot(1);
+        --size_;
+    }
+}
+
+int HourlyForecast::Find(time_t t) const {
+    const int32_t hour = Hour(t);
+    for (int i = 0; i < size_; ++i) {
+        if (hour_[Slot(i)] == hour) return i;
+    }
+    return -1;
+}
+
+bool operator==(const HourlyForecast& a, const HourlyForecast& b) {
+    if (a.size() != b.size()) return false;
+    for (int i = 0; i < a.size(); ++i) {
+        if (a.start(i) != b.start(i) || a.temp(i) != b.temp(i) ||
+            a.precip(i) != b.precip(i) || a.code(i) != b.code(i)) {
+            return false;
+        }
+    }
+    return true;
+}
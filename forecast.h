@@ -0,0 +1,52 @@
+#ifndef FORECAST_H
+#define FORECAST_H
+
+#include <stdint.h>
+#include <time.h>
+
+// --- Hourly forecast ---
+// Open-Meteo's hourly temperature, chance of precipitation and weather
+// code, kept in a ring of fixed parallel arrays: no allocation per hour,
+// the strip renderer scans the temperatures alone, and hours that have
+// passed drop off the front without moving the rest.
+class HourlyForecast {
+public:
+    static const int CAPACITY = 48;
+    static const int UNKNOWN = -1;    // precipitation or code not given
+
+    void Clear() { head_ = size_ = 0; }
+
+    // Stores the hour starting at `start`. An hour already held is
+    // replaced, one older than all of them ignored; when full, the oldest
+    // drops out to make room.
+    void Add(time_t start, float temp, int precip, int code);
+
+    // Drops the hours that ended before `now`.
+    void DropBefore(time_t now);
+
+    int size() const { return size_; }
+
+    // The i-th hour held, oldest first.
+    time_t start(int i) const { return (time_t)hour_[Slot(i)] * 3600; }
+    float temp(int i) const { return temp_[Slot(i)]; }     // °F
+    int precip(int i) const { return precip_[Slot(i)]; }   // percent, or UNKNOWN
+    int code(int i) const { return code_[Slot(i)]; }       // WMO code, or UNKNOWN
+
+    // Index of the hour holding `t`, or -1.
+    int Find(time_t t) const;
+
+private:
+    int Slot(int i) const { return (head_ + i) % CAPACITY; }
+    static int32_t Hour(time_t t) { return (int32_t)(t / 3600); }
+
+    int32_t hour_[CAPACITY] = {};     // hours since the epoch
+    float temp_[CAPACITY] = {};
+    int8_t precip_[CAPACITY] = {};
+    int8_t code_[CAPACITY] = {};
+    int head_ = 0, size_ = 0;
+};
+
+bool operator==(const HourlyForecast& a, const HourlyForecast& b);
+inline bool operator!=(const HourlyForecast& a, const HourlyForecast& b) { return !(a == b); }
+
+#endif
@@ -0,0 +1,180 @@
+#include "http_client.h"
+
+#include <ctype.h>
+#include <stdint.h>
+
+namespace {
+
+const long CONNECT_TIMEOUT_S = 10;
+const long TRANSFER_TIMEOUT_S = 30;
+const long DNS_CACHE_TIMEOUT_S = 3600;  // outlive the refresh interval
+
+size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
+    ((std::string*)userp)->append((char*)contents, size * nmemb);
+    return size * nmemb;
+}
+
+// Picks the cache validators out of the response headers. Redirects deliver
+// several header blocks; each status line starts the record over.
+size_t HeaderCallback(char* buffer, size_t size, size_t nitems, void* userp) {
+    size_t len = size * nitems;
+    HttpResponse* r = (HttpResponse*)userp;
+    std::string line(buffer, len);
+
+    if (line.compare(0, 5, "HTTP/") == 0) {
+        r->etag.clear();
+        r->last_modified.clear();
+        return len;
+    }
+
+    size_t colon = line.find(':');
+    if (colon == std::string::npos) return len;
+    std::string name = line.substr(0, colon);
+    for (char& c : name) c = tolower((unsigned char)c);
+
+    size_t begin = line.find_first_not_of(" \t", colon + 1);
+    size_t end = line.find_last_not_of(" \t\r\n");
+    std::string value = (begin == std::string::npos || end < begin)
+                            ? std::string() : line.substr(begin, end - begin + 1);
+
+    if (name == "etag") r->etag = value;
+    else if (name == "last-modified") r->last_modified = value;
+    return len;
+}
+
+double InfoSeconds(CURL* handle, CURLINFO info) {
+    curl_off_t us = 0;
+    curl_easy_getinfo(handle, info, &us);
+    return us / 1e6;
+}
+
+}  // namespace
+
+HttpClient::HttpClient() {
+    multi_ = curl_multi_init();
+    share_ = curl_share_init();
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+}
+
+HttpClient::~HttpClient() {
+    for (CURL* handle : idle_) curl_easy_cleanup(handle);
+    curl_multi_cleanup(multi_);
+    curl_share_cleanup(share_);
+}
+
+CURL* HttpClient::AcquireHandle() {
+    CURL* handle;
+    if (idle_.empty()) {
+        handle = curl_easy_init();
+    } else {
+        // Reset drops per-transfer options but keeps the shared caches.
+        handle = idle_.back();
+        idle_.pop_back();
+        curl_easy_reset(handle);
+    }
+    return handle;
+}
+
+void HttpClient::ReleaseHandle(CURL* handle) {
+    idle_.push_back(handle);
+}
+
+std::vector<HttpResponse> HttpClient::PerformAll(const std::vector<HttpRequest>& requests,
+                                                 const DoneFn& on_done) {
+    std::vector<HttpResponse> responses(requests.size());
+    std::vector<CURL*> handles(requests.size(), nullptr);
+    std::vector<curl_slist*> header_lists(requests.size(), nullptr);
+
+    for (size_t i = 0; i < requests.size(); ++i) {
+        CURL* handle = AcquireHandle();
+        if (!handle) {
+            responses[i].error = "curl_easy_init failed";
+            if (on_done) on_done(i, responses[i]);
+            continue;
+        }
+        handles[i] = handle;
+
+        curl_easy_setopt(handle, CURLOPT_URL, requests[i].url.c_str());
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, WriteCallback);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, &responses[i].body);
+        curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, HeaderCallback);
+        curl_easy_setopt(handle, CURLOPT_HEADERDATA, &responses[i]);
+        curl_easy_setopt(handle, CURLOPT_USERAGENT, "libcurl-agent/1.0");
+        curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, 1L);  // handle redirects
+        curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);        // runs off the main thread
+        curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT, CONNECT_TIMEOUT_S);
+        curl_easy_setopt(handle, CURLOPT_TIMEOUT, TRANSFER_TIMEOUT_S);
+        curl_easy_setopt(handle, CURLOPT_DNS_CACHE_TIMEOUT, DNS_CACHE_TIMEOUT_S);
+        curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(handle, CURLOPT_SHARE, share_);
+        curl_easy_setopt(handle, CURLOPT_PRIVATE, (void*)(uintptr_t)i);
+
+        for (const std::string& header : requests[i].headers) {
+            header_lists[i] = curl_slist_append(header_lists[i], header.c_str());
+        }
+        if (header_lists[i]) curl_easy_setopt(handle, CURLOPT_HTTPHEADER, header_lists[i]);
+
+        curl_multi_add_handle(multi_, handle);
+    }
+
+    // Finished transfers are collected as they complete, so the caller
+    // hears about a fast one without waiting for a slow one.
+    int running = 0;
+    do {
+        CURLMcode mc = curl_multi_perform(multi_, &running);
+        if (mc == CURLM_OK) {
+            CURLMsg* msg;
+            int queued = 0;
+            while ((msg = curl_multi_info_read(multi_, &queued))) {
+                if (msg->msg != CURLMSG_DONE) continue;
+
+                void* priv = nullptr;
+                curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &priv);
+                HttpResponse& r = responses[(uintptr_t)priv];
+
+                if (msg->data.result == CURLE_OK) {
+                    r.ok = true;
+                    r.error.clear();
+                    curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &r.status);
+                } else {
+                    r.error = curl_easy_strerror(msg->data.result);
+                }
+
+                HttpTiming& t = r.timing;
+                t.dns = InfoSeconds(msg->easy_handle, CURLINFO_NAMELOOKUP_TIME_T);
+                t.connect = InfoSeconds(msg->easy_handle, CURLINFO_CONNECT_TIME_T);
+                t.tls = InfoSeconds(msg->easy_handle, CURLINFO_APPCONNECT_TIME_T);
+                t.first_byte = InfoSeconds(msg->easy_handle, CURLINFO_STARTTRANSFER_TIME_T);
+                t.total = InfoSeconds(msg->easy_handle, CURLINFO_TOTAL_TIME_T);
+                if (on_done) on_done((uintptr_t)priv, r);
+            }
+        }
+        if (mc == CURLM_OK && running) {
+            mc = curl_multi_poll(multi_, nullptr, 0, 1000, nullptr);
+        }
+        if (mc != CURLM_OK) {
+            for (size_t i = 0; i < responses.size(); ++i) {
+                HttpResponse& r = responses[i];
+                if (r.ok || !r.error.empty()) continue;
+                r.error = curl_multi_strerror(mc);
+                if (on_done) on_done(i, r);
+            }
+            break;
+        }
+    } while (running);
+
+    for (size_t i = 0; i < handles.size(); ++i) {
+        curl_slist_free_all(header_lists[i]);
+        if (!handles[i]) continue;
+        curl_multi_remove_handle(multi_, handles[i]);
+        ReleaseHandle(handles[i]);
+    }
+
+    return responses;
+}
+
+HttpResponse HttpClient::Perform(const HttpRequest& request) {
+    return PerformAll({request}).front();
+}
@@ -0,0 +1,80 @@
+#ifndef HTTP_CLIENT_H
+#define HTTP_CLIENT_H
+
+#include <curl/curl.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Seconds from the start of a transfer until each phase completed, as
+// reported by libcurl. Phases skipped thanks to a reused connection or a
+// cached DNS entry come out as (near) zero, which is exactly what we want
+// to see in the log.
+struct HttpTiming {
+    double dns = 0;
+    double connect = 0;
+    double tls = 0;
+    double first_byte = 0;
+    double total = 0;
+};
+
+struct HttpRequest {
+    std::string url;
+    std::vector<std::string> headers;  // extra request headers, "Name: value"
+};
+
+struct HttpResponse {
+    bool ok = false;        // transfer completed; check status for the HTTP result
+    long status = 0;
+    std::string body;
+    std::string error;      // curl error text when !ok
+    std::string etag;       // validators of the final response, if sent
+    std::string last_modified;
+    HttpTiming timing;
+};
+
+// Where responses come from: the network, or a recording of it (see
+// replay.h).
+class HttpSource {
+public:
+    virtual ~HttpSource() {}
+
+    // Called with a request's index and its response as soon as it has
+    // finished, while the others may still be running.
+    typedef std::function<void(size_t, const HttpResponse&)> DoneFn;
+
+    // Runs all requests concurrently and blocks until every one of them has
+    // finished or timed out. Responses come back in request order.
+    virtual std::vector<HttpResponse> PerformAll(const std::vector<HttpRequest>& requests,
+                                                 const DoneFn& on_done = DoneFn()) = 0;
+};
+
+// Persistent HTTP client. One multi handle drives all transfers, so
+// requests issued together run concurrently, and a share handle keeps the
+// DNS cache, TLS sessions and open connections alive between refreshes.
+// Easy handles are pooled and reset rather than recreated.
+//
+// Not thread safe: use one instance per thread.
+class HttpClient : public HttpSource {
+public:
+    HttpClient();
+    ~HttpClient() override;
+
+    HttpClient(const HttpClient&) = delete;
+    HttpClient& operator=(const HttpClient&) = delete;
+
+    std::vector<HttpResponse> PerformAll(const std::vector<HttpRequest>& requests,
+                                         const DoneFn& on_done = DoneFn()) override;
+
+    HttpResponse Perform(const HttpRequest& request);
+
+private:
+    CURL* AcquireHandle();
+    void ReleaseHandle(CURL* handle);
+
+    CURLM* multi_;
+    CURLSH* share_;
+    std::vector<CURL*> idle_;
+};
+
+#endif
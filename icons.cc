@@ -0,0 +1,549 @@
+#include "icons.h"
+#include "color_lut.h"
+#include "compositor.h"
+#include "lodepng.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+bool Opaque(const Pixel& p) { return p.r || p.g || p.b; }
+
+// Appends the opaque runs of each row of a width x height image.
+void AddSpans(const Pixel* pixels, int width, int height, std::vector<IconSpan>& spans) {
+    for (int y = 0; y < height; ++y) {
+        const Pixel* row = pixels + y * width;
+        int x = 0;
+        while (x < width) {
+            while (x < width && !Opaque(row[x])) ++x;
+            int start = x;
+            while (x < width && Opaque(row[x])) ++x;
+            if (x > start) {
+                spans.push_back({(uint16_t)y, (uint16_t)start, (uint16_t)(x - start)});
+            }
+        }
+    }
+}
+
+// `pixels` (width x height) with every pixel grown to factor x factor.
+void ScalePixels(const Pixel* pixels, int width, int height, int factor,
+                 std::vector<Pixel>& out) {
+    int w = width * factor, h = height * factor;
+    out.resize(w * h);
+    for (int y = 0; y < h; ++y) {
+        const Pixel* src = pixels + (y / factor) * width;
+        for (int x = 0; x < w; ++x) out[y * w + x] = src[x / factor];
+    }
+}
+
+// `pixels` (width x height) dithered to what `dither`'s PWM depth shows.
+void DitherPixels(const Pixel* pixels, int width, int height, const PanelDither& dither,
+                  std::vector<Pixel>& out) {
+    out.resize(width * height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const Pixel& p = pixels[y * width + x];
+            out[y * width + x] = {dither.Apply(p.r, x, y), dither.Apply(p.g, x, y),
+                                  dither.Apply(p.b, x, y)};
+        }
+    }
+}
+
+}  // namespace
+
+// --- Atlas ---
+void IconAtlas::Set(IconId id, const Pixel* pixels, int width, int height) {
+    Remove(id);
+    Entry& e = entries_[(int)id];
+    e.width = width;
+    e.height = height;
+    e.pixel_offset = pixels_.size();
+    e.span_offset = spans_.size();
+
+    pixels_.insert(pixels_.end(), pixels, pixels + width * height);
+    AddSpans(pixels, width, height, spans_);
+    e.span_count = spans_.size() - e.span_offset;
+}
+
+void IconAtlas::Attach(IconId id, const Pixel* pixels, int width, int height,
+                       const IconSpan* spans, size_t span_count) {
+    Remove(id);
+    Entry& e = entries_[(int)id];
+    e.width = width;
+    e.height = height;
+    e.span_count = span_count;
+    e.external_pixels = pixels;
+    e.external_spans = spans;
+}
+
+void IconAtlas::Remove(IconId id) {
+    Entry& old = entries_[(int)id];
+    if (old.width != 0 && !old.external_pixels) {
+        // Close the gap, moving the icons stored after it down
+        const size_t pixel_count = (size_t)old.width * old.height;
+        pixels_.erase(pixels_.begin() + old.pixel_offset,
+                      pixels_.begin() + old.pixel_offset + pixel_count);
+        spans_.erase(spans_.begin() + old.span_offset,
+                     spans_.begin() + old.span_offset + old.span_count);
+        for (Entry& e : entries_) {
+            if (e.width == 0 || e.external_pixels || e.pixel_offset <= old.pixel_offset) continue;
+            e.pixel_offset -= pixel_count;
+            e.span_offset -= old.span_count;
+        }
+    }
+    old = Entry();
+}
+
+IconView IconAtlas::Get(IconId id) const {
+    const Entry& e = entries_[(int)id];
+    IconView view;
+    if (e.width == 0) return view;
+    view.width = e.width;
+    view.height = e.height;
+    view.span_count = e.span_count;
+    if (e.external_pixels) {
+        view.pixels = e.external_pixels;
+        view.spans = e.external_spans;
+    } else {
+        view.pixels = pixels_.data() + e.pixel_offset;
+        view.spans = spans_.data() + e.span_offset;
+    }
+    return view;
+}
+
+void ScaleIcons(const IconAtlas& from, int factor, IconAtlas& to) {
+    std::vector<Pixel> scaled;
+    for (int i = 0; i < (int)IconId::Count; ++i) {
+        IconView icon = from.Get((IconId)i);
+        if (icon.width == 0) continue;
+        ScalePixels(icon.pixels, icon.width, icon.height, factor, scaled);
+        to.Set((IconId)i, scaled.data(), icon.width * factor, icon.height * factor);
+    }
+}
+
+void DitherIcons(const IconAtlas& from, int pwm_bits, IconAtlas& to, const ColorLut* lut) {
+    const PanelDither dither(pwm_bits, lut);
+    std::vector<Pixel> dithered;
+    for (int i = 0; i < (int)IconId::Count; ++i) {
+        IconView icon = from.Get((IconId)i);
+        if (icon.width == 0) continue;
+        DitherPixels(icon.pixels, icon.width, icon.height, dither, dithered);
+        to.Set((IconId)i, dithered.data(), icon.width, icon.height);
+    }
+}
+
+
+// --- Animations ---
+void IconAnimations::Set(IconId id, const Pixel* pixels, int width, int height, int count) {
+    Remove(id);
+    Ring& ring = rings_[(int)id];
+    ring.width = width;
+    ring.height = height;
+    ring.count = count;
+    ring.first = frames_.size();
+    for (int i = 0; i < count; ++i) {
+        const Pixel* frame = pixels + (size_t)i * width * height;
+        Entry f;
+        f.pixel_offset = pixels_.size();
+        f.span_offset = spans_.size();
+        pixels_.insert(pixels_.end(), frame, frame + width * height);
+        AddSpans(frame, width, height, spans_);
+        f.span_count = spans_.size() - f.span_offset;
+        frames_.push_back(f);
+    }
+}
+
+void IconAnimations::Remove(IconId id) {
+    Ring& old = rings_[(int)id];
+    if (old.count != 0) {
+        // A ring's frames, and their pixels and spans, were added together
+        const Entry& first = frames_[old.first];
+        const Entry& last = frames_[old.first + old.count - 1];
+        const size_t pixel_count = (size_t)old.count * old.width * old.height;
+        const size_t pixel_offset = first.pixel_offset, span_offset = first.span_offset;
+        const size_t span_count = last.span_offset + last.span_count - span_offset;
+        pixels_.erase(pixels_.begin() + pixel_offset, pixels_.begin() + pixel_offset + pixel_count);
+        spans_.erase(spans_.begin() + span_offset, spans_.begin() + span_offset + span_count);
+        frames_.erase(frames_.begin() + old.first, frames_.begin() + old.first + old.count);
+        for (Entry& f : frames_) {
+            if (f.pixel_offset <= pixel_offset) continue;
+            f.pixel_offset -= pixel_count;
+            f.span_offset -= span_count;
+        }
+        for (Ring& r : rings_) {
+            if (r.count != 0 && r.first > old.first) r.first -= old.count;
+        }
+    }
+    old = Ring();
+}
+
+IconView IconAnimations::Frame(IconId id, int frame) const {
+    const Ring& ring = rings_[(int)id];
+    IconView view;
+    if (ring.count == 0) return view;
+    const Entry& f = frames_[ring.first + frame % ring.count];
+    view.width = ring.width;
+    view.height = ring.height;
+    view.pixels = pixels_.data() + f.pixel_offset;
+    view.spans = spans_.data() + f.span_offset;
+    view.span_count = f.span_count;
+    return view;
+}
+
+void ScaleAnimations(const IconAnimations& from, int factor, IconAnimations& to) {
+    std::vector<Pixel> frame, ring;
+    for (int i = 0; i < (int)IconId::Count; ++i) {
+        int count = from.frames((IconId)i);
+        if (count == 0) continue;
+        ring.clear();
+        for (int f = 0; f < count; ++f) {
+            IconView icon = from.Frame((IconId)i, f);
+            ScalePixels(icon.pixels, icon.width, icon.height, factor, frame);
+            ring.insert(ring.end(), frame.begin(), frame.end());
+        }
+        IconView first = from.Frame((IconId)i, 0);
+        to.Set((IconId)i, ring.data(), first.width * factor, first.height * factor, count);
+    }
+}
+
+void DitherAnimations(const IconAnimations& from, int pwm_bits, IconAnimations& to,
+                      const ColorLut* lut) {
+    const PanelDither dither(pwm_bits, lut);
+    std::vector<Pixel> frame, ring;
+    for (int i = 0; i < (int)IconId::Count; ++i) {
+        int count = from.frames((IconId)i);
+        if (count == 0) continue;
+        ring.clear();
+        for (int f = 0; f < count; ++f) {
+            IconView icon = from.Frame((IconId)i, f);
+            DitherPixels(icon.pixels, icon.width, icon.height, dither, frame);
+            ring.insert(ring.end(), frame.begin(), frame.end());
+        }
+        IconView first = from.Frame((IconId)i, 0);
+        to.Set((IconId)i, ring.data(), first.width, first.height, count);
+    }
+}
+
+bool FallingFrames(const IconView& still, std::vector<Pixel>& frames, int& count) {
+    const int w = still.width, h = still.height;
+    const Pixel* pixels = still.pixels;
+    auto opaque = [&](int x, int y) { return Opaque(pixels[y * w + x]); };
+
+    // The cloud ends at its last row with a wide run, or below that where
+    // every pixel still hangs from the one above
+    int top = 0;
+    for (size_t i = 0; i < still.span_count; ++i) {
+        if (still.spans[i].len > 2) top = still.spans[i].y + 1;
+    }
+    for (bool hanging = top > 0; hanging && top < h; ) {
+        bool any = false;
+        for (int x = 0; x < w && hanging; ++x) {
+            if (!opaque(x, top)) continue;
+            any = true;
+            hanging = opaque(x, top - 1);
+        }
+        hanging = hanging && any;
+        if (hanging) ++top;
+    }
+    const int rows = h - top;
+    bool falls = false;
+    for (int y = top; y < h && !falls; ++y) {
+        for (int x = 0; x < w && !falls; ++x) falls = opaque(x, y);
+    }
+    if (top == 0 || rows < h / 8 || !falls) return false;
+
+    count = rows;
+    frames.resize((size_t)count * w * h);
+    for (int k = 0; k < count; ++k) {
+        Pixel* frame = frames.data() + (size_t)k * w * h;
+        std::copy(pixels, pixels + top * w, frame);
+        for (int y = top; y < h; ++y) {
+            int from = top + (y - top - k + rows) % rows;
+            std::copy(pixels + from * w, pixels + (from + 1) * w, frame + y * w);
+        }
+    }
+    return true;
+}
+
+
+// --- Loading ---
+namespace {
+
+// The mean of `light` (w x h, three channels a pixel) over the area each
+// pixel of a to_w x to_h grid covers.
+void ResampleLight(const std::vector<float>& light, int w, int h, int to_w, int to_h,
+                   std::vector<float>& out) {
+    out.assign((size_t)to_w * to_h * 3, 0.0f);
+    const float sx = (float)w / to_w, sy = (float)h / to_h;
+    for (int oy = 0; oy < to_h; ++oy) {
+        const float y0 = oy * sy, y1 = y0 + sy;
+        for (int ox = 0; ox < to_w; ++ox) {
+            const float x0 = ox * sx, x1 = x0 + sx;
+            float* sum = &out[((size_t)oy * to_w + ox) * 3];
+            for (int y = (int)y0; y < h && y < y1; ++y) {
+                const float cover_y = std::min(y1, y + 1.0f) - std::max(y0, (float)y);
+                for (int x = (int)x0; x < w && x < x1; ++x) {
+                    const float cover = cover_y * (std::min(x1, x + 1.0f) - std::max(x0, (float)x));
+                    const float* p = &light[((size_t)y * w + x) * 3];
+                    for (int c = 0; c < 3; ++c) sum[c] += p[c] * cover;
+                }
+            }
+            for (int c = 0; c < 3; ++c) sum[c] /= sx * sy;
+        }
+    }
+}
+
+// Decodes `filename` as the panel shows it over black: each channel's
+// light times the pixel's alpha, so soft edges fade out instead of being
+// cut at half transparency. A square icon, or with `strip` each square
+// frame of a strip, that isn't ICON_SIZE high is resampled to it, by
+// light rather than by value so it keeps its brightness. A lodepng error
+// code, or 0.
+unsigned DecodeIcon(const std::string& filename, bool strip, IconImage& icon) {
+    std::vector<unsigned char> image; // raw RGBA pixels
+    unsigned width, height;
+    unsigned error = lodepng::decode(image, width, height, filename);
+    if (error) return error;
+
+    std::vector<float> light((size_t)width * height * 3);
+    for (size_t i = 0; i < (size_t)width * height; ++i) {
+        const unsigned char* p = &image[4 * i];
+        for (int c = 0; c < 3; ++c) light[3 * i + c] = PanelLight(p[c]) * p[3] / 255.0f;
+    }
+    int w = width, h = height;
+    if (h != ICON_SIZE && h > 0 && (strip ? w % h == 0 : w == h)) {
+        std::vector<float> resampled;
+        w = w / h * ICON_SIZE;
+        ResampleLight(light, width, height, w, ICON_SIZE, resampled);
+        light.swap(resampled);
+        h = ICON_SIZE;
+    }
+
+    icon = IconImage(w, h);
+    for (size_t i = 0; i < icon.pixels.size(); ++i) {
+        icon.pixels[i] = {PanelValue(light[3 * i]), PanelValue(light[3 * i + 1]),
+                          PanelValue(light[3 * i + 2])};
+    }
+    return 0;
+}
+
+}  // namespace
+
+bool LoadIconFromPNG(const std::string& filename, IconAtlas& atlas, IconId id) {
+    IconImage icon(0, 0);
+    unsigned error = DecodeIcon(filename, false, icon);
+    if (error) {
+        std::cerr << "PNG decode error in " << filename << ": "
+                  << lodepng_error_text(error) << std::endl;
+        return false;
+    }
+
+    atlas.Set(id, icon.pixels.data(), icon.width, icon.height);
+    return true;
+}
+
+bool SetAnimationStrip(IconAnimations& animations, IconId id,
+                       const Pixel* strip, int width, int height) {
+    if (height == 0 || width % height != 0 || width / height < 2) return false;
+
+    // Frames side by side in the strip, one after another in the ring
+    const int count = width / height;
+    std::vector<Pixel> frames((size_t)width * height);
+    for (int f = 0; f < count; ++f) {
+        for (int y = 0; y < height; ++y) {
+            const Pixel* row = strip + (size_t)y * width + f * height;
+            std::copy(row, row + height, frames.begin() + ((size_t)f * height + y) * height);
+        }
+    }
+    animations.Set(id, frames.data(), height, height, count);
+    return true;
+}
+
+bool LoadAnimationFromPNG(const std::string& filename, IconAnimations& animations, IconId id) {
+    IconImage strip(0, 0);
+    if (DecodeIcon(filename, true, strip)) return false;
+    if (!SetAnimationStrip(animations, id, strip.pixels.data(), strip.width, strip.height)) {
+        std::cerr << filename << ": not a strip of square frames" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+// --- Procedural icons ---
+namespace {
+
+void DrawCloud(IconImage& icon) {
+    for (int y = 0; y < ICON_SIZE; y++) {
+        for (int x = 0; x < ICON_SIZE; x++) {
+            int dx = x - 16, dy = y - 16;
+            if (dx * dx + dy * dy <= 36) icon.at(x, y) = {200, 200, 200};
+            dx = x - 12; dy = y - 18;
+            if (dx * dx + dy * dy <= 36) icon.at(x, y) = {200, 200, 200};
+            dx = x - 20; dy = y - 18;
+            if (dx * dx + dy * dy <= 36) icon.at(x, y) = {200, 200, 200};
+        }
+    }
+}
+
+}  // namespace
+
+IconImage PreRenderSun() {
+    IconImage icon(ICON_SIZE, ICON_SIZE);
+    for (int y = 0; y < ICON_SIZE; y++) {
+        for (int x = 0; x < ICON_SIZE; x++) {
+            int dx = x - ICON_SIZE / 2;
+            int dy = y - ICON_SIZE / 2;
+            if (dx * dx + dy * dy <= 64) icon.at(x, y) = {0, 255, 255};
+        }
+    }
+    return icon;
+}
+
+IconImage PreRenderMoon() {
+    IconImage icon(ICON_SIZE, ICON_SIZE);
+    for (int y = 0; y < ICON_SIZE; y++) {
+        for (int x = 0; x < ICON_SIZE; x++) {
+            int dx = x - ICON_SIZE / 2;
+            int dy = y - ICON_SIZE / 2;
+            if (dx * dx + dy * dy <= 64) icon.at(x, y) = {255, 200, 200};
+            int dx2 = x - ICON_SIZE / 2 - 4;
+            if (dx2 * dx2 + dy * dy <= 64) icon.at(x, y) = {0, 0, 0};
+        }
+    }
+    return icon;
+}
+
+IconImage PreRenderCloud() {
+    IconImage icon(ICON_SIZE, ICON_SIZE);
+    DrawCloud(icon);
+    return icon;
+}
+
+// Drops under the cloud, staggered so they fall (see FallingFrames())
+// as a shower rather than a row.
+IconImage PreRenderRain() {
+    IconImage icon(ICON_SIZE, ICON_SIZE);
+    DrawCloud(icon);
+    for (int i = 0; i < 3; i++) {
+        int px = 12 + i * 4, py = 26 + (i % 2) * 3;
+        icon.at(px, py) = {255, 128, 0};
+        icon.at(px, py + 1) = {255, 128, 0};
+    }
+    return icon;
+}
+
+IconImage PreRenderSnow() {
+    IconImage icon(ICON_SIZE, ICON_SIZE);
+    DrawCloud(icon);
+    for (int i = 0; i < 3; i++) {
+        int px = 12 + i * 4, py = 26 + (i % 2) * 3;
+        icon.at(px, py) = {255, 255, 255};
+    }
+    return icon;
+}
+
+IconImage PreRenderPartlyCloudy() {
+    IconImage icon(ICON_SIZE, ICON_SIZE);
+
+    // Sun (top-left corner)
+    for (int y = 0; y < ICON_SIZE; y++) {
+        for (int x = 0; x < ICON_SIZE; x++) {
+            int dx = x - 10, dy = y - 10;
+            if (dx * dx + dy * dy <= 36) {
+                icon.at(x, y) = {255, 255, 0};  // yellow sun
+            }
+        }
+    }
+
+    // Cloud (center-right)
+    for (int y = 0; y < ICON_SIZE; y++) {
+        for (int x = 0; x < ICON_SIZE; x++) {
+            int dx1 = x - 18, dy1 = y - 18;
+            int dx2 = x - 22, dy2 = y - 16;
+            if (dx1 * dx1 + dy1 * dy1 <= 36 || dx2 * dx2 + dy2 * dy2 <= 36) {
+                icon.at(x, y) = {200, 200, 200};  // light gray cloud
+            }
+        }
+    }
+    return icon;
+}
+
+IconImage PreRenderFog() {
+    IconImage icon(ICON_SIZE, ICON_SIZE);
+    for (int y = 12; y <= 20; y += 4) {
+        for (int x = 8; x < 24; x++) {
+            icon.at(x, y) = {180, 180, 180};
+        }
+    }
+    return icon;
+}
+
+const IconSource ICON_SOURCES[] = {
+    {IconId::Sun, "sun", PreRenderSun},
+    {IconId::Moon, "moon", PreRenderMoon},
+    {IconId::Cloud, "cloud", PreRenderCloud},
+    {IconId::Drizzle, "drizzle", PreRenderRain},
+    {IconId::Rain, "rain", PreRenderRain},
+    {IconId::Snow, "snow", PreRenderSnow},
+    {IconId::Fog, "fog", PreRenderFog},
+    {IconId::PartlyCloudy, "light_cloud", PreRenderPartlyCloudy},
+    {IconId::Friend, "friend", nullptr},
+    {IconId::Thunder, "thunder", nullptr},
+    {IconId::Ash, "ash", nullptr},
+    {IconId::Haze, "haze", PreRenderFog},
+    {IconId::Smoke, "smoke", PreRenderFog},
+    {IconId::MoonPartlyCloud, "night_lightcloud", nullptr},
+    {IconId::MoonCloud, "night_cloud", PreRenderCloud},
+};
+const size_t ICON_SOURCE_COUNT = sizeof(ICON_SOURCES) / sizeof(ICON_SOURCES[0]);
+
+bool LoadIcon(IconAtlas& atlas, const IconSource& source) {
+    std::string file = std::string("icons/") + source.name + ".png";
+    if (LoadIconFromPNG(file, atlas, source.id)) return true;
+    if (!source.fallback) return false;
+    IconImage icon = source.fallback();
+    atlas.Set(source.id, icon.pixels.data(), icon.width, icon.height);
+    return true;
+}
+
+bool IsPrecipitation(IconId id) {
+    return id == IconId::Rain || id == IconId::Drizzle || id == IconId::Snow;
+}
+
+bool LoadAnimation(IconAnimations& animations, const IconSource& source, const IconView& still) {
+    std::string file = std::string("icons/") + source.name + "_anim.png";
+    if (LoadAnimationFromPNG(file, animations, source.id)) return true;
+    if (!IsPrecipitation(source.id) || still.empty()) return false;
+    std::vector<Pixel> frames;
+    int count;
+    if (!FallingFrames(still, frames, count)) return false;
+    animations.Set(source.id, frames.data(), still.width, still.height, count);
+    return true;
+}
+
+
+// --- Blit functions ---
+void BlitSpan(rgb_matrix::Canvas* canvas, int x, int y, const Pixel* pixels, int len) {
+    for (int i = 0; i < len; ++i) {
+        canvas->SetPixel(x + i, y, pixels[i].r, pixels[i].g, pixels[i].b);
+    }
+}
+
+void DrawIcon(rgb_matrix::Canvas* canvas, int x, int y, const IconView& icon) {
+    if (!canvas) {
+        std::cerr << "Canvas is null\n";
+        return;
+    }
+
+    // Spans are in row order, so the rows the canvas keeps are one run
+    const Rect area = DrawableArea(canvas);
+    for (size_t i = 0; i < icon.span_count; ++i) {
+        const IconSpan& s = icon.spans[i];
+        if (y + s.y < area.y) continue;
+        if (y + s.y >= area.bottom()) break;
+        BlitSpan(canvas, x + s.x, y + s.y,
+                 icon.pixels + s.y * icon.width + s.x, s.len);
+    }
+}
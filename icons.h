@@ -0,0 +1,191 @@
+#ifndef ICONS_H
+#define ICONS_H
+
+#include "canvas.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class ColorLut;
+
+const int ICON_SIZE = 32;  // size of the procedural icons, and what PNGs are fitted to
+
+struct Pixel {
+    uint8_t r, g, b;
+};
+
+enum class IconId {
+    Sun, Moon, Cloud, Rain, Snow, Fog, PartlyCloudy, Drizzle, Thunder,
+    Friend, Haze, Ash, Smoke, MoonCloud, MoonPartlyCloud,
+    Count
+};
+
+// Run of opaque pixels within one icon row.
+struct IconSpan {
+    uint16_t y, x, len;
+};
+
+// Borrowed view of one icon in the atlas. Valid until the atlas changes.
+struct IconView {
+    int width = 0;
+    int height = 0;
+    const Pixel* pixels = nullptr;   // width * height, row major
+    const IconSpan* spans = nullptr;
+    size_t span_count = 0;
+
+    bool empty() const { return span_count == 0; }
+};
+
+// Every icon lives in one contiguous pixel array, alongside the list of
+// opaque runs in each of its rows. The runs are worked out once when an
+// icon is added, so drawing an icon costs time proportional to its opaque
+// pixels and never looks at the transparent ones. Icons may have any size.
+class IconAtlas {
+public:
+    // Adds `pixels` (width * height, black = transparent) as icon `id`.
+    // Setting an id twice replaces the icon.
+    void Set(IconId id, const Pixel* pixels, int width, int height);
+
+    // Uses pixels and spans stored elsewhere (e.g. the mapped asset pack)
+    // without copying them. They must outlive the atlas.
+    void Attach(IconId id, const Pixel* pixels, int width, int height,
+                const IconSpan* spans, size_t span_count);
+
+    IconView Get(IconId id) const;
+
+private:
+    // Drops what `id` holds, so replacing an icon doesn't leave its old
+    // pixels behind.
+    void Remove(IconId id);
+
+    struct Entry {
+        int width = 0, height = 0;
+        size_t pixel_offset = 0;
+        size_t span_offset = 0, span_count = 0;
+        const Pixel* external_pixels = nullptr;  // set by Attach()
+        const IconSpan* external_spans = nullptr;
+    };
+
+    std::vector<Pixel> pixels_;
+    std::vector<IconSpan> spans_;
+    Entry entries_[(int)IconId::Count];
+};
+
+// Fills `to` with every icon of `from` grown to factor x factor.
+void ScaleIcons(const IconAtlas& from, int factor, IconAtlas& to);
+
+// --- Animated icons ---
+// Every frame of the icons that move, worked out at load time and stored
+// like atlas icons, so showing the next frame is one DrawIcon() of a ring
+// entry and nothing is decoded or computed while the clock runs.
+class IconAnimations {
+public:
+    // Adds `count` frames of width x height, stored one after another in
+    // `pixels` (black = transparent), as the ring of icon `id`. Setting an
+    // id twice replaces its ring.
+    void Set(IconId id, const Pixel* pixels, int width, int height, int count);
+
+    // Frames in the ring of `id`; 0 if it doesn't move.
+    int frames(IconId id) const { return rings_[(int)id].count; }
+
+    // Frame `frame` of `id`, counted round the ring.
+    IconView Frame(IconId id, int frame) const;
+
+private:
+    void Remove(IconId id);   // as IconAtlas::Remove()
+
+    struct Ring {
+        int width = 0, height = 0, count = 0;
+        size_t first = 0;   // index into frames_
+    };
+    struct Entry {
+        size_t pixel_offset, span_offset, span_count;
+    };
+
+    std::vector<Pixel> pixels_;
+    std::vector<IconSpan> spans_;
+    std::vector<Entry> frames_;
+    Ring rings_[(int)IconId::Count];
+};
+
+// Fills `to` with every ring of `from` grown to factor x factor.
+void ScaleAnimations(const IconAnimations& from, int factor, IconAnimations& to);
+
+// Fills `to` with every icon or ring of `from` dithered to what `pwm_bits`
+// of PWM can show after `lut` (see PanelDither), so frames cost nothing
+// more. Done again whenever the table changes.
+void DitherIcons(const IconAtlas& from, int pwm_bits, IconAtlas& to,
+                 const ColorLut* lut = nullptr);
+void DitherAnimations(const IconAnimations& from, int pwm_bits, IconAnimations& to,
+                      const ColorLut* lut = nullptr);
+
+// Precipitation falling out of a still icon: the rows under the last one
+// with a run wider than two pixels (the cloud) are the drops or flakes,
+// and frame k shows them k rows further down, wrapping round, so the ring
+// has a frame per row. False if fewer than an eighth of the rows fall.
+bool FallingFrames(const IconView& still, std::vector<Pixel>& frames, int& count);
+
+// Scratch image for drawing the procedural icons.
+struct IconImage {
+    IconImage(int w, int h) : width(w), height(h), pixels(w * h, Pixel{0, 0, 0}) {}
+
+    Pixel& at(int x, int y) { return pixels[y * width + x]; }
+
+    int width, height;
+    std::vector<Pixel> pixels;
+};
+
+// Loads a PNG as icon `id`: faded by its alpha against the black panel,
+// and resampled to ICON_SIZE if it is a square of another size.
+bool LoadIconFromPNG(const std::string& filename, IconAtlas& atlas, IconId id);
+
+// Adds a strip of square frames side by side (`width` a multiple of
+// `height`) as the ring of `id`. False if it isn't one.
+bool SetAnimationStrip(IconAnimations& animations, IconId id,
+                       const Pixel* strip, int width, int height);
+
+// Loads a strip, e.g. icons/rain_anim.png for the rain icon, as the ring
+// of `id`, decoded like LoadIconFromPNG() frame by frame. False, quietly,
+// if there is no such file.
+bool LoadAnimationFromPNG(const std::string& filename, IconAnimations& animations, IconId id);
+
+// Simple shape drawn icons, used where no PNG could be loaded.
+IconImage PreRenderSun();
+IconImage PreRenderMoon();
+IconImage PreRenderCloud();
+IconImage PreRenderRain();
+IconImage PreRenderSnow();
+IconImage PreRenderPartlyCloudy();
+IconImage PreRenderFog();
+
+// Where each icon comes from: icons/<name>.png, or the procedural
+// fallback if that can't be loaded. It moves if there is an
+// icons/<name>_anim.png strip, or if it is precipitation (see
+// FallingFrames()).
+struct IconSource {
+    IconId id;
+    const char* name;
+    IconImage (*fallback)();
+};
+extern const IconSource ICON_SOURCES[];
+extern const size_t ICON_SOURCE_COUNT;
+
+// Loads one icon from its PNG, falling back to the procedural version.
+bool LoadIcon(IconAtlas& atlas, const IconSource& source);
+
+// Whether `id` shows something falling, and gets FallingFrames() when it
+// has no strip of its own.
+bool IsPrecipitation(IconId id);
+
+// The ring of one icon: its strip from icons/, else falling frames of
+// `still`.
+bool LoadAnimation(IconAnimations& animations, const IconSource& source, const IconView& still);
+
+// Writes one run of pixels starting at (x, y).
+void BlitSpan(rgb_matrix::Canvas* canvas, int x, int y, const Pixel* pixels, int len);
+
+void DrawIcon(rgb_matrix::Canvas* canvas, int x, int y, const IconView& icon);
+
+#endif
@@ -0,0 +1,351 @@
+#include "json_extract.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+const int MAX_DEPTH = 32;
+
+// One step of the current path: an object key or an array index.
+struct Segment {
+    const char* key;    // nullptr for array elements
+    size_t key_len;
+    size_t index;
+};
+
+bool SegmentMatches(const Segment& seg, const char* part, size_t len) {
+    if (seg.key) return seg.key_len == len && memcmp(seg.key, part, len) == 0;
+    if (len == 0) return false;
+    size_t index = 0;
+    for (size_t i = 0; i < len; ++i) {
+        if (part[i] < '0' || part[i] > '9') return false;
+        index = index * 10 + (part[i] - '0');
+    }
+    return index == seg.index;
+}
+
+// 0 = path diverges from the stack, 1 = stack is a strict prefix of path,
+// 2 = exact match.
+int MatchPath(const char* path, const Segment* stack, int depth) {
+    const char* p = path;
+    for (int d = 0; d < depth; ++d) {
+        if (*p == '\0') return 0;
+        const char* dot = strchr(p, '.');
+        size_t len = dot ? (size_t)(dot - p) : strlen(p);
+        if (!SegmentMatches(stack[d], p, len)) return 0;
+        p += len;
+        if (*p == '.') ++p;
+        else if (d + 1 < depth) return 0;
+    }
+    return *p == '\0' ? 2 : 1;
+}
+
+class Scanner {
+public:
+    Scanner(const std::string& json, JsonField* fields, size_t count)
+        : p_(json.c_str()), end_(json.c_str() + json.size()),
+          fields_(fields), count_(count) {}
+
+    bool Run() {
+        if (!Value(true)) return false;
+        SkipSpace();
+        return p_ == end_;
+    }
+
+private:
+    void SkipSpace() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) ++p_;
+    }
+
+    // Does any requested path lie at or below the current position?
+    bool Wanted() const {
+        for (size_t i = 0; i < count_; ++i) {
+            if (MatchPath(fields_[i].path, stack_, depth_)) return true;
+        }
+        return false;
+    }
+
+    JsonField* Exact() const {
+        for (size_t i = 0; i < count_; ++i) {
+            if (MatchPath(fields_[i].path, stack_, depth_) == 2) return &fields_[i];
+        }
+        return nullptr;
+    }
+
+    bool Literal(const char* word, size_t len) {
+        if ((size_t)(end_ - p_) < len || memcmp(p_, word, len) != 0) return false;
+        p_ += len;
+        return true;
+    }
+
+    // Leaves p_ after the closing quote. Escapes are validated, not decoded.
+    bool String(const char** raw, size_t* raw_len, bool* escaped) {
+        ++p_;  // opening quote
+        const char* start = p_;
+        bool esc = false;
+        while (p_ < end_ && *p_ != '"') {
+            if ((unsigned char)*p_ < 0x20) return false;
+            if (*p_ == '\\') {
+                esc = true;
+                if (++p_ >= end_) return false;
+                if (*p_ == 'u') {
+                    if (end_ - p_ < 5) return false;
+                    for (int i = 1; i <= 4; ++i) {
+                        if (!isxdigit((unsigned char)p_[i])) return false;
+                    }
+                    p_ += 4;
+                } else if (!strchr("\"\\/bfnrt", *p_)) {
+                    return false;
+                }
+            }
+            ++p_;
+        }
+        if (p_ >= end_) return false;
+        *raw = start;
+        *raw_len = p_ - start;
+        *escaped = esc;
+        ++p_;  // closing quote
+        return true;
+    }
+
+    bool Digits() {
+        const char* start = p_;
+        while (p_ < end_ && *p_ >= '0' && *p_ <= '9') ++p_;
+        return p_ > start;
+    }
+
+    // Checks the number grammar; converts the value only if `out` is set.
+    bool Number(double* out) {
+        const char* start = p_;
+        if (p_ < end_ && *p_ == '-') ++p_;
+        if (p_ < end_ && *p_ == '0') ++p_;
+        else if (!Digits()) return false;
+        if (p_ < end_ && *p_ == '.') {
+            ++p_;
+            if (!Digits()) return false;
+        }
+        if (p_ < end_ && (*p_ == 'e' || *p_ == 'E')) {
+            ++p_;
+            if (p_ < end_ && (*p_ == '+' || *p_ == '-')) ++p_;
+            if (!Digits()) return false;
+        }
+        // The input is a std::string, so strtod always finds a terminator.
+        if (out) *out = strtod(start, nullptr);
+        return true;
+    }
+
+    bool Value(bool track) {
+        SkipSpace();
+        if (p_ >= end_) return false;
+        JsonField* field = track ? Exact() : nullptr;
+
+        switch (*p_) {
+        case '{':
+            if (field) field->type = JsonType::Object;
+            return Object(track);
+        case '[':
+            if (field) field->type = JsonType::Array;
+            if (field && field->elements) return Elements(*field);
+            return Array(track);
+        case '"': {
+            const char* raw;
+            size_t len;
+            bool escaped;
+            if (!String(&raw, &len, &escaped)) return false;
+            if (field) {
+                field->type = JsonType::String;
+                field->raw = raw;
+                field->raw_len = len;
+                field->escaped = escaped;
+            }
+            return true;
+        }
+        case 't':
+        case 'f': {
+            bool value = *p_ == 't';
+            if (!(value ? Literal("true", 4) : Literal("false", 5))) return false;
+            if (field) {
+                field->type = JsonType::Bool;
+                field->boolean = value;
+            }
+            return true;
+        }
+        case 'n':
+            if (!Literal("null", 4)) return false;
+            if (field) field->type = JsonType::Null;
+            return true;
+        default:
+            if (!Number(field ? &field->number : nullptr)) return false;
+            if (field) field->type = JsonType::Number;
+            return true;
+        }
+    }
+
+    bool Object(bool track) {
+        ++p_;  // '{'
+        SkipSpace();
+        if (p_ < end_ && *p_ == '}') {
+            ++p_;
+            return true;
+        }
+        if (depth_ >= MAX_DEPTH) return false;
+        while (true) {
+            SkipSpace();
+            if (p_ >= end_ || *p_ != '"') return false;
+            const char* key;
+            size_t key_len;
+            bool escaped;
+            if (!String(&key, &key_len, &escaped)) return false;
+            SkipSpace();
+            if (p_ >= end_ || *p_ != ':') return false;
+            ++p_;
+
+            stack_[depth_++] = {key, key_len, 0};
+            bool ok = Value(track && Wanted());
+            --depth_;
+            if (!ok) return false;
+
+            SkipSpace();
+            if (p_ >= end_) return false;
+            if (*p_ == '}') {
+                ++p_;
+                return true;
+            }
+            if (*p_++ != ',') return false;
+        }
+    }
+
+    bool Array(bool track) {
+        ++p_;  // '['
+        SkipSpace();
+        if (p_ < end_ && *p_ == ']') {
+            ++p_;
+            return true;
+        }
+        if (depth_ >= MAX_DEPTH) return false;
+        for (size_t index = 0;; ++index) {
+            stack_[depth_++] = {nullptr, 0, index};
+            bool ok = Value(track && Wanted());
+            --depth_;
+            if (!ok) return false;
+
+            SkipSpace();
+            if (p_ >= end_) return false;
+            if (*p_ == ']') {
+                ++p_;
+                return true;
+            }
+            if (*p_++ != ',') return false;
+        }
+    }
+
+    // An array copied out into field.elements instead of walked by path.
+    bool Elements(JsonField& field) {
+        ++p_;  // '['
+        field.element_count = 0;
+        SkipSpace();
+        if (p_ < end_ && *p_ == ']') {
+            ++p_;
+            return true;
+        }
+        while (true) {
+            SkipSpace();
+            if (p_ >= end_) return false;
+            double value = NAN;
+            bool number = *p_ == '-' || (*p_ >= '0' && *p_ <= '9');
+            if (!(number ? Number(&value) : Value(false))) return false;
+            if (field.element_count < field.capacity) field.elements[field.element_count] = value;
+            ++field.element_count;
+
+            SkipSpace();
+            if (p_ >= end_) return false;
+            if (*p_ == ']') {
+                ++p_;
+                return true;
+            }
+            if (*p_++ != ',') return false;
+        }
+    }
+
+    const char* p_;
+    const char* end_;
+    JsonField* fields_;
+    size_t count_;
+    Segment stack_[MAX_DEPTH];
+    int depth_ = 0;
+};
+
+void AppendUTF8(std::string& out, unsigned cp) {
+    if (cp < 0x80) {
+        out += (char)cp;
+    } else if (cp < 0x800) {
+        out += (char)(0xC0 | (cp >> 6));
+        out += (char)(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += (char)(0xE0 | (cp >> 12));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    } else {
+        out += (char)(0xF0 | (cp >> 18));
+        out += (char)(0x80 | ((cp >> 12) & 0x3F));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    }
+}
+
+unsigned Hex4(const char* p) {
+    char buf[5] = {p[0], p[1], p[2], p[3], 0};
+    return (unsigned)strtoul(buf, nullptr, 16);
+}
+
+}  // namespace
+
+bool ExtractJsonFields(const std::string& json, JsonField* fields, size_t count) {
+    Scanner scanner(json, fields, count);
+    return scanner.Run();
+}
+
+std::string JsonUnescape(const char* raw, size_t len) {
+    std::string out;
+    out.reserve(len);
+    for (size_t i = 0; i < len; ++i) {
+        if (raw[i] != '\\' || i + 1 >= len) {
+            out += raw[i];
+            continue;
+        }
+        char c = raw[++i];
+        switch (c) {
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u': {
+            if (i + 4 >= len) return out;
+            unsigned cp = Hex4(raw + i + 1);
+            i += 4;
+            // Surrogate pair
+            if (cp >= 0xD800 && cp < 0xDC00 && i + 6 < len &&
+                raw[i + 1] == '\\' && raw[i + 2] == 'u') {
+                unsigned lo = Hex4(raw + i + 3);
+                if (lo >= 0xDC00 && lo < 0xE000) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                    i += 6;
+                }
+            }
+            AppendUTF8(out, cp);
+            break;
+        }
+        default: out += c; break;  // \" \\ \/
+        }
+    }
+    return out;
+}
+
+std::string JsonField::str() const {
+    if (type != JsonType::String) return std::string();
+    return escaped ? JsonUnescape(raw, raw_len) : std::string(raw, raw_len);
+}
@@ -0,0 +1,44 @@
+#ifndef JSON_EXTRACT_H
+#define JSON_EXTRACT_H
+
+#include <stddef.h>
+#include <string>
+
+// Single-pass JSON field extractor. Instead of building a DOM it walks the
+// text once, records the handful of values we asked for and skips over
+// everything else without allocating. Paths are dot separated object keys
+// and array indices, e.g. "weather.0.description"; whole arrays of numbers
+// can be copied out into a caller's buffer.
+
+enum class JsonType { Missing, Null, Bool, Number, String, Object, Array };
+
+struct JsonField {
+    explicit JsonField(const char* p) : path(p) {}
+
+    const char* path;
+    JsonType type = JsonType::Missing;
+    double number = 0;
+    bool boolean = false;
+    // For strings, the text between the quotes with escapes left as is
+    // (see JsonUnescape). Points into the input.
+    const char* raw = nullptr;
+    size_t raw_len = 0;
+    bool escaped = false;   // raw contains backslash escapes
+
+    // For arrays of numbers: if set, the elements are stored here, up to
+    // `capacity` of them, with anything but a number stored as NaN.
+    // `element_count` counts every element, stored or not.
+    double* elements = nullptr;
+    size_t capacity = 0;
+    size_t element_count = 0;
+
+    std::string str() const;
+};
+
+// Fills in every field found in `json`. Returns false if the document is
+// not well formed; fields seen before the error are left filled in.
+bool ExtractJsonFields(const std::string& json, JsonField* fields, size_t count);
+
+std::string JsonUnescape(const char* raw, size_t len);
+
+#endif
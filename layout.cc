@@ -0,0 +1,116 @@
+#include "layout.h"
+
+#include <algorithm>
+
+namespace {
+
+// Baseline that centres `font`'s cell vertically in `band`.
+int Baseline(const Rect& band, const BitmapFont& font) {
+    return band.y + (band.h - font.height()) / 2 + font.baseline();
+}
+
+}  // namespace
+
+LayoutEngine::LayoutEngine(std::vector<const BitmapFont*> fonts, const IconAtlas& icons,
+                           const IconAnimations* animations)
+    : fonts_(std::move(fonts)), icons_(icons), animations_(animations) {}
+
+const BitmapFont* LayoutEngine::PickFont(int pixels) {
+    // Tallest result wins; of equal ones the least scaled, which keeps
+    // the detail of a font drawn for that size.
+    const BitmapFont* best = nullptr;
+    int best_factor = 0, best_height = 0;
+    for (const BitmapFont* font : fonts_) {
+        int ink = std::max(font->InkWidth(), 1);
+        int factor = std::min(pixels / font->height(), 32 / ink);
+        int height = font->height() * factor;
+        if (factor < 1) continue;
+        if (height > best_height || (height == best_height && factor < best_factor)) {
+            best = font;
+            best_factor = factor;
+            best_height = height;
+        }
+    }
+    if (!best) {
+        // Nothing is small enough: the smallest font as it is
+        for (const BitmapFont* font : fonts_) {
+            if (!best || font->height() < best->height()) best = font;
+        }
+        return best;
+    }
+    if (best_factor == 1) return best;
+
+    for (const ScaledFont& scaled : scaled_fonts_) {
+        if (scaled.source == best && scaled.factor == best_factor) return scaled.font.get();
+    }
+    std::unique_ptr<BitmapFont> font(new BitmapFont);
+    font->Scale(*best, best_factor);
+    scaled_fonts_.push_back(ScaledFont{best, best_factor, std::move(font)});
+    return scaled_fonts_.back().font.get();
+}
+
+void LayoutEngine::RescaleIcons() {
+    if (scaled_icons_) ScaleIcons(icons_, layout_.scale, *scaled_icons_);
+    if (scaled_animations_) ScaleAnimations(*animations_, layout_.scale, *scaled_animations_);
+}
+
+const Layout& LayoutEngine::Resolve(int width, int height) {
+    if (layout_.width == width && layout_.height == height) return layout_;
+
+    scaled_fonts_.clear();
+    temp_font_.reset();
+    scaled_icons_.reset();
+    scaled_animations_.reset();
+
+    Layout l;
+    l.width = width;
+    l.height = height;
+    l.scale = std::max(1, std::min(width / DESIGN_WIDTH, height / DESIGN_HEIGHT));
+
+    // The design is centred; spare pixels are split around it
+    const int s = l.scale;
+    const int ox = (width - DESIGN_WIDTH * s) / 2, oy = (height - DESIGN_HEIGHT * s) / 2;
+    auto place = [&](int x, int y, int w, int h) {
+        return Rect(ox + x * s, oy + y * s, w * s, h * s);
+    };
+
+    l.left_panel = place(0, 0, 64, 64);
+    l.right_panel = place(64, 0, 64, 64);
+
+    l.clock_font = PickFont(24 * s);
+    l.text_font = PickFont(12 * s);
+    temp_font_.reset(new OutlineFont(*l.text_font));
+    l.temp_font = temp_font_.get();
+    if (s == 1) {
+        l.icons = &icons_;
+        l.animations = animations_;
+    } else {
+        scaled_icons_.reset(new IconAtlas);
+        ScaleIcons(icons_, s, *scaled_icons_);
+        l.icons = scaled_icons_.get();
+        if (animations_) {
+            scaled_animations_.reset(new IconAnimations);
+            ScaleAnimations(*animations_, s, *scaled_animations_);
+            l.animations = scaled_animations_.get();
+        }
+    }
+
+    // Time across the top
+    l.clock_area = place(0, 1, 128, 24);
+    l.clock_baseline = Baseline(l.clock_area, *l.clock_font);
+
+    // Left panel: icon, temperature under it
+    l.icon = place(16, 23, 32, 32);
+    l.temp_center_x = ox + 35 * s;
+    l.temp_baseline = Baseline(place(0, 52, 64, 12), *l.text_font);
+
+    // Right panel: forecast strip, day, date
+    l.forecast = place(72, 25, 2 * FORECAST_HOURS, 14);
+    l.date_x = l.right_panel.x + 6 * s;
+    l.ticker = place(64, 40, 64, 12);
+    l.day_baseline = Baseline(l.ticker, *l.text_font);
+    l.date_baseline = Baseline(place(64, 52, 64, 12), *l.text_font);
+
+    layout_ = l;
+    return layout_;
+}
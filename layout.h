@@ -0,0 +1,88 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include "bitmap_font.h"
+#include "compositor.h"
+#include "icons.h"
+
+#include <memory>
+#include <vector>
+
+// --- Screen layout ---
+// The screen is designed for 128x64: the time across the top, the weather
+// icon and temperature on the left panel, the hourly forecast strip over
+// the day and date on the right one. The day line scrolls on through the
+// weather description. A display of any size draws that design at the largest whole scale
+// that fits, centred, with fonts and icons picked or grown to match.
+
+const int DESIGN_WIDTH = 128;
+const int DESIGN_HEIGHT = 64;
+
+// Hours shown by the forecast strip, each an equal slice of its width
+const int FORECAST_HOURS = 24;
+
+// How fast the day line scrolls, in pixels of the design a second
+const int TICKER_SPEED = 20;
+
+// Where everything goes on one display size. Text positions are baselines;
+// centred text is placed at `center_x - width / 2`.
+struct Layout {
+    int width = 0, height = 0;   // display size it was resolved for
+    int scale = 1;               // of the 128x64 design
+
+    Rect left_panel, right_panel;
+
+    const BitmapFont* clock_font = nullptr;
+    const BitmapFont* text_font = nullptr;      // temperature, day and date
+    const OutlineFont* temp_font = nullptr;     // outlined text_font
+    const IconAtlas* icons = nullptr;
+    const IconAnimations* animations = nullptr;   // frames of the icons that move
+
+    Rect clock_area;             // the time is centred in it
+    int clock_baseline = 0;
+    Rect icon;                   // weather icon, at its top left
+    int temp_center_x = 0, temp_baseline = 0;
+    int date_x = 0, day_baseline = 0, date_baseline = 0;
+    Rect ticker;                 // the day line, across the right panel
+    Rect forecast;               // hourly strip, above the day
+};
+
+// Resolves the layout for a display size and keeps it, along with the
+// scaled fonts and icons it points to, until it is asked for another size.
+class LayoutEngine {
+public:
+    // `fonts` are the loaded fonts to pick from, at their own size or grown
+    // by a whole factor. They, `icons` and `animations` (if any) must
+    // outlive the engine.
+    LayoutEngine(std::vector<const BitmapFont*> fonts, const IconAtlas& icons,
+                 const IconAnimations* animations = nullptr);
+
+    // The layout for width x height. Pointers in it stay valid until it is
+    // resolved for a different size.
+    const Layout& Resolve(int width, int height);
+
+    // Grows the icons again after `icons` or `animations` were refilled,
+    // into the same atlases, so the layout's pointers stay valid.
+    void RescaleIcons();
+
+private:
+    // Largest font, natively or scaled, no taller than `pixels`.
+    const BitmapFont* PickFont(int pixels);
+
+    std::vector<const BitmapFont*> fonts_;
+    const IconAtlas& icons_;
+    const IconAnimations* animations_;
+
+    Layout layout_;
+    struct ScaledFont {
+        const BitmapFont* source;
+        int factor;
+        std::unique_ptr<BitmapFont> font;
+    };
+    std::vector<ScaledFont> scaled_fonts_;
+    std::unique_ptr<OutlineFont> temp_font_;
+    std::unique_ptr<IconAtlas> scaled_icons_;
+    std::unique_ptr<IconAnimations> scaled_animations_;
+};
+
+#endif
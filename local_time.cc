@@ -0,0 +1,49 @@
+#include "local_time.h"
+
+#include <string.h>
+
+namespace {
+
+char* TwoDigits(char* p, int n) {
+    *p++ = '0' + n / 10;
+    *p++ = '0' + n % 10;
+    return p;
+}
+
+}  // namespace
+
+bool LocalTime::Update(time_t now) {
+    // The first call, the next quarter hour, or the wall clock stepped back
+    bool changed = false;
+    if (now < quarter_start_ || now >= quarter_end_) changed = StartQuarter(now);
+
+    // Same text as strftime's "%-I:%M:%S"
+    int seconds = (int)(now - hour_start_);
+    int hour12 = hour_ % 12 ? hour_ % 12 : 12;
+    char* p = time_;
+    if (hour12 >= 10) *p++ = '0' + hour12 / 10;
+    *p++ = '0' + hour12 % 10;
+    *p++ = ':';
+    p = TwoDigits(p, seconds / 60);
+    *p++ = ':';
+    p = TwoDigits(p, seconds % 60);
+    *p = 0;
+    return changed;
+}
+
+bool LocalTime::StartQuarter(time_t now) {
+    struct tm tm_now;
+    localtime_r(&now, &tm_now);
+    hour_ = tm_now.tm_hour;
+    hour_start_ = now - tm_now.tm_min * 60 - tm_now.tm_sec;
+    quarter_start_ = now - tm_now.tm_min % 15 * 60 - tm_now.tm_sec;
+    quarter_end_ = quarter_start_ + 900;
+
+    char day[sizeof(day_)], date[sizeof(date_)];
+    strftime(day, sizeof(day), "%A", &tm_now);
+    strftime(date, sizeof(date), "%m/%d/%y", &tm_now);
+    if (strcmp(day, day_) == 0 && strcmp(date, date_) == 0) return false;
+    memcpy(day_, day, sizeof(day_));
+    memcpy(date_, date, sizeof(date_));
+    return true;
+}
@@ -0,0 +1,38 @@
+#ifndef LOCAL_TIME_H
+#define LOCAL_TIME_H
+
+#include <time.h>
+
+// --- Local time text ---
+// The time, day and date the clock shows, moved on tick by tick without
+// localtime() or strftime(). Those run once per local quarter hour: UTC
+// offsets and their changes (DST) are in whole quarter hours, but not
+// always whole hours, e.g. Lord Howe Island's 30-minute shift. In between,
+// the minutes and seconds are counted on from the start of the hour. The
+// day and date text is only rewritten when the date changes, i.e. at
+// midnight.
+class LocalTime {
+public:
+    // Brings the text to `now`. Returns true if the day or date changed,
+    // which includes the first call.
+    bool Update(time_t now);
+
+    const char* time_str() const { return time_; }   // "1:05:09", 12-hour
+    const char* day_str() const { return day_; }     // "Wednesday"
+    const char* date_str() const { return date_; }   // "10/16/26"
+    int hour() const { return hour_; }               // 0-23
+
+private:
+    // Starts the local quarter hour holding `now`; true if the date text
+    // changed.
+    bool StartQuarter(time_t now);
+
+    time_t hour_start_ = 0;                      // of the hour the text is in
+    time_t quarter_start_ = 0, quarter_end_ = 0;   // checked against the offset
+    int hour_ = 0;
+    char time_[16] = "";
+    char day_[32] = "";
+    char date_[16] = "";
+};
+
+#endif
@@ -0,0 +1,222 @@
+#include "metrics.h"
+#include "scheduler.h"
+
+#include <stdio.h>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+const char* const PROVIDER_NAMES[PROVIDER_COUNT] = {"openweather", "open-meteo"};
+
+ClockMetrics clockMetrics;
+
+namespace {
+
+std::string BucketLabel(int i) {
+    if (i == 0) return "<1 us";
+    std::ostringstream oss;
+    if (i == LatencyHistogram::BUCKETS - 1) {
+        oss << ">=" << LatencyHistogram::BucketLimitUs(i - 1) << " us";
+    } else {
+        oss << LatencyHistogram::BucketLimitUs(i - 1) << "-"
+            << LatencyHistogram::BucketLimitUs(i) << " us";
+    }
+    return oss.str();
+}
+
+void WriteHeader(std::ostream& out, const char* name, const char* type, const char* help) {
+    out << "# HELP " << name << " " << help << "\n"
+        << "# TYPE " << name << " " << type << "\n";
+}
+
+// The buckets of `h` as a Prometheus histogram in seconds. `labels` is
+// empty or a list like `provider="open-meteo"`. The count is taken from
+// the buckets, so it always matches the +Inf bucket.
+void WriteHistogram(std::ostream& out, const char* name, const std::string& labels,
+                    const LatencyHistogram& h) {
+    const std::string sep = labels.empty() ? "" : ",";
+    uint64_t total = 0;
+    for (int i = 0; i < LatencyHistogram::BUCKETS; ++i) {
+        total += h.bucket(i);
+        out << name << "_bucket{" << labels << sep << "le=\"";
+        if (i == LatencyHistogram::BUCKETS - 1) out << "+Inf";
+        else out << LatencyHistogram::BucketLimitUs(i) * 1e-6;
+        out << "\"} " << total << "\n";
+    }
+    const std::string braces = labels.empty() ? "" : "{" + labels + "}";
+    out << name << "_sum" << braces << " " << h.sum_ns() * 1e-9 << "\n"
+        << name << "_count" << braces << " " << total << "\n";
+}
+
+std::string ProviderLabel(int p) {
+    return std::string("provider=\"") + PROVIDER_NAMES[p] + "\"";
+}
+
+}  // namespace
+
+// --- LatencyHistogram ---
+void LatencyHistogram::Record(int64_t ns) {
+    if (ns < 0) ns = 0;
+    uint64_t us = (uint64_t)ns / 1000;
+    int i = us == 0 ? 0 : 64 - __builtin_clzll(us);
+    if (i >= BUCKETS) i = BUCKETS - 1;
+    buckets_[i].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+    int64_t max = max_ns_.load(std::memory_order_relaxed);
+    while (ns > max && !max_ns_.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {}
+}
+
+int64_t LatencyHistogram::PercentileUs(double p) const {
+    uint64_t n = count();
+    if (n == 0) return 0;
+    uint64_t target = (uint64_t)std::ceil(p * n);
+    if (target == 0) target = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS - 1; ++i) {
+        seen += bucket(i);
+        if (seen >= target) return BucketLimitUs(i);
+    }
+    return max_ns() / 1000;
+}
+
+void LatencyHistogram::Print(std::ostream& out, const char* name) const {
+    uint64_t n = count();
+    out << name << ": " << n << " samples";
+    if (n > 0) {
+        out << ", p50 <" << PercentileUs(0.5) << " us, p99 <" << PercentileUs(0.99)
+            << " us, max " << max_ns() / 1000 << " us";
+    }
+    out << "\n";
+    for (int i = 0; i < BUCKETS; ++i) {
+        if (bucket(i) == 0) continue;
+        out << "  " << std::setw(18) << BucketLabel(i) << "  " << bucket(i) << "\n";
+    }
+}
+
+// --- Export ---
+void WriteMetrics(std::ostream& out, const ClockMetrics& metrics, time_t now) {
+    const char* name;
+
+    name = "clock_fetch_duration_seconds";
+    WriteHeader(out, name, "histogram", "Weather API transfers, by provider.");
+    for (int p = 0; p < PROVIDER_COUNT; ++p) {
+        WriteHistogram(out, name, ProviderLabel(p), metrics.providers[p].fetch);
+    }
+
+    name = "clock_fetch_errors_total";
+    WriteHeader(out, name, "counter",
+                "Failed weather fetches, by provider and kind (transport, http or invalid).");
+    for (int p = 0; p < PROVIDER_COUNT; ++p) {
+        const ProviderMetrics& m = metrics.providers[p];
+        out << name << "{" << ProviderLabel(p) << ",kind=\"transport\"} "
+            << m.transport_errors.value() << "\n"
+            << name << "{" << ProviderLabel(p) << ",kind=\"http\"} "
+            << m.http_errors.value() << "\n"
+            << name << "{" << ProviderLabel(p) << ",kind=\"invalid\"} "
+            << m.invalid_responses.value() << "\n";
+    }
+
+    name = "clock_provider_breaker_open";
+    WriteHeader(out, name, "gauge", "1 while a provider is shut off after repeated failures.");
+    for (int p = 0; p < PROVIDER_COUNT; ++p) {
+        out << name << "{" << ProviderLabel(p) << "} "
+            << metrics.providers[p].breaker_open.load(std::memory_order_relaxed) << "\n";
+    }
+
+    name = "clock_parse_duration_seconds";
+    WriteHeader(out, name, "histogram", "Parsing weather API responses, by provider.");
+    for (int p = 0; p < PROVIDER_COUNT; ++p) {
+        WriteHistogram(out, name, ProviderLabel(p), metrics.providers[p].parse);
+    }
+
+    // Providers without any cached response are left out
+    name = "clock_weather_age_seconds";
+    WriteHeader(out, name, "gauge", "Age of the weather shown, by provider.");
+    for (int p = 0; p < PROVIDER_COUNT; ++p) {
+        int64_t at = metrics.providers[p].confirmed_at.load(std::memory_order_relaxed);
+        if (at == 0) continue;
+        out << name << "{" << ProviderLabel(p) << "} " << (int64_t)now - at << "\n";
+    }
+
+    name = "clock_render_duration_seconds";
+    WriteHeader(out, name, "histogram",
+                "Rendering a tick, redrawing the weather and date (static) or the clock alone (tick).");
+    WriteHistogram(out, name, "frame=\"static\"", metrics.static_render);
+    WriteHistogram(out, name, "frame=\"tick\"", metrics.tick_render);
+
+    name = "clock_swap_duration_seconds";
+    WriteHeader(out, name, "histogram", "Swapping a frame in, including the wait for vsync.");
+    WriteHistogram(out, name, "", metrics.swap);
+
+    if (const TickScheduler* scheduler = metrics.scheduler) {
+        name = "clock_tick_wake_lateness_seconds";
+        WriteHeader(out, name, "histogram", "How late the loop woke to render a tick.");
+        WriteHistogram(out, name, "", scheduler->wake());
+
+        name = "clock_tick_swap_lateness_seconds";
+        WriteHeader(out, name, "histogram", "How late after its tick a frame was swapped in.");
+        WriteHistogram(out, name, "", scheduler->swap());
+
+        name = "clock_ticks_skipped_total";
+        WriteHeader(out, name, "counter", "Ticks skipped because rendering fell behind.");
+        out << name << " " << scheduler->skipped() << "\n";
+    }
+}
+
+// --- MetricsExporter ---
+MetricsExporter::MetricsExporter(const std::string& path, int interval_s,
+                                 const ClockMetrics& metrics)
+    : path_(path), interval_s_(interval_s), metrics_(metrics) {}
+
+MetricsExporter::~MetricsExporter() {
+    Stop();
+}
+
+void MetricsExporter::Start() {
+    thread_ = std::thread(&MetricsExporter::Run, this);
+}
+
+void MetricsExporter::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stop_) return;
+        stop_ = true;
+    }
+    wake_.notify_one();
+    if (thread_.joinable()) thread_.join();
+    Write();
+}
+
+bool MetricsExporter::Write() const {
+    std::ostringstream text;
+    text << std::setprecision(9);
+    WriteMetrics(text, metrics_, time(nullptr));
+
+    std::string tmp = path_ + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << text.str();
+        if (!out.flush()) {
+            std::cerr << "Failed to write metrics: " << tmp << std::endl;
+            return false;
+        }
+    }
+    if (rename(tmp.c_str(), path_.c_str()) != 0) {
+        std::cerr << "Failed to replace metrics: " << path_ << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void MetricsExporter::Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+        lock.unlock();
+        Write();
+        lock.lock();
+        wake_.wait_for(lock, std::chrono::seconds(interval_s_), [this] { return stop_; });
+    }
+}
@@ -0,0 +1,125 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <time.h>
+
+class TickScheduler;
+
+// --- Runtime metrics ---
+// Counters and latency histograms filled in by the render loop and the
+// weather worker, and written out every few seconds as a Prometheus text
+// file. Recording is a handful of relaxed atomic adds, so it never blocks
+// and costs nothing worth measuring on the tick path.
+
+// Monotonic time for measuring durations.
+inline int64_t MonotonicNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+class Counter {
+public:
+    void Add(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_{0};
+};
+
+// Durations in power-of-two microsecond buckets: <1 us, 1-2 us, 2-4 us,
+// ... and everything from ~1 s up. Safe to record from one thread while
+// another reads it; a reader may see a sample in the count before it
+// shows up in its bucket.
+class LatencyHistogram {
+public:
+    static const int BUCKETS = 22;
+
+    void Record(int64_t ns);
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    int64_t max_ns() const { return max_ns_.load(std::memory_order_relaxed); }
+    int64_t sum_ns() const { return sum_ns_.load(std::memory_order_relaxed); }
+    uint64_t bucket(int i) const { return buckets_[i].load(std::memory_order_relaxed); }
+
+    // Upper edge of bucket i in microseconds; the last one has none.
+    static int64_t BucketLimitUs(int i) { return 1LL << i; }
+
+    // Upper edge of the bucket holding the p-th fraction (0..1) of the
+    // samples, in microseconds.
+    int64_t PercentileUs(double p) const;
+
+    // One summary line, then the non-empty buckets.
+    void Print(std::ostream& out, const char* name) const;
+
+private:
+    std::atomic<uint64_t> buckets_[BUCKETS] = {};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<int64_t> sum_ns_{0};
+    std::atomic<int64_t> max_ns_{0};
+};
+
+// The weather providers, in the order the worker fetches them.
+enum Provider { PROVIDER_OPENWEATHER, PROVIDER_OPEN_METEO, PROVIDER_COUNT };
+extern const char* const PROVIDER_NAMES[PROVIDER_COUNT];
+
+struct ProviderMetrics {
+    LatencyHistogram fetch;           // whole transfer, as timed by libcurl
+    LatencyHistogram parse;           // extracting the fields the clock shows
+    Counter transport_errors;         // no response: DNS, connect, timeout, ...
+    Counter http_errors;              // a status other than 200 or 304
+    Counter invalid_responses;        // a 200 the clock could not use
+    std::atomic<int> breaker_open{0}; // 1 while its circuit breaker is not closed
+    std::atomic<int64_t> confirmed_at{0};   // wall time of the cached body, 0 if none
+};
+
+struct ClockMetrics {
+    ProviderMetrics providers[PROVIDER_COUNT];
+    LatencyHistogram static_render;   // ticks that redrew the weather or date layers
+    LatencyHistogram tick_render;     // ticks that redrew only the clock
+    LatencyHistogram swap;            // Display::Swap(), i.e. the wait for vsync
+    const TickScheduler* scheduler = nullptr;   // tick lateness and skips, if set
+};
+
+// Everything the clock reports; like the icon atlas there is just one.
+extern ClockMetrics clockMetrics;
+
+// All of `metrics` in the Prometheus text exposition format.
+void WriteMetrics(std::ostream& out, const ClockMetrics& metrics, time_t now);
+
+// Rewrites a Prometheus text file (for node_exporter's textfile collector,
+// say) every `interval_s` seconds from its own thread. Each write goes to a
+// temporary file renamed over the old one, so a scrape never sees half a
+// file.
+class MetricsExporter {
+public:
+    MetricsExporter(const std::string& path, int interval_s, const ClockMetrics& metrics);
+    ~MetricsExporter();
+
+    void Start();
+    // Writes a last time and stops the thread.
+    void Stop();
+
+    bool Write() const;
+
+private:
+    void Run();
+
+    const std::string path_;
+    const int interval_s_;
+    const ClockMetrics& metrics_;
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+};
+
+#endif
@@ -0,0 +1,46 @@
+#include "provider_health.h"
+
+#include <algorithm>
+
+bool ProviderHealth::Allow(time_t now, bool force) {
+    switch (state_) {
+    case State::Closed:
+        return force || failures_ == 0 || now >= retry_at_;
+    case State::Open:
+        if (now < retry_at_) return false;
+        state_ = State::HalfOpen;
+        return true;
+    case State::HalfOpen:
+        return true;
+    }
+    return false;
+}
+
+void ProviderHealth::Success() {
+    state_ = State::Closed;
+    failures_ = 0;
+    retry_at_ = 0;
+}
+
+void ProviderHealth::Failure(time_t now) {
+    ++failures_;
+    retry_at_ = now + Backoff(failures_);
+    // A failed probe opens it again right away
+    if (failures_ >= BREAKER_FAILURES || state_ == State::HalfOpen) state_ = State::Open;
+}
+
+int ProviderHealth::Backoff(int failures) {
+    int shift = std::min(failures - 1, 16);
+    int full = std::min(BACKOFF_BASE_SECONDS << shift, BACKOFF_MAX_SECONDS);
+    std::uniform_int_distribution<int> jitter(full / 2, full);
+    return jitter(rng_);
+}
+
+const char* StateName(ProviderHealth::State state) {
+    switch (state) {
+    case ProviderHealth::State::Closed: return "closed";
+    case ProviderHealth::State::Open: return "open";
+    case ProviderHealth::State::HalfOpen: return "half-open";
+    }
+    return "?";
+}
@@ -0,0 +1,51 @@
+#ifndef PROVIDER_HEALTH_H
+#define PROVIDER_HEALTH_H
+
+#include <stdint.h>
+#include <random>
+#include <time.h>
+
+// --- Provider health ---
+// Keeps a failing weather provider from being hammered. After each failure
+// in a row the next attempt waits twice as long (with jitter, so a fleet
+// that lost the network together does not come back in lockstep), and
+// after BREAKER_FAILURES of them the breaker opens: not even a forced
+// refresh goes out until the wait is over, and then a single probe decides
+// whether it closes again.
+
+const int BACKOFF_BASE_SECONDS = 30;
+const int BACKOFF_MAX_SECONDS = 1800;
+const int BREAKER_FAILURES = 5;
+
+class ProviderHealth {
+public:
+    enum class State { Closed, Open, HalfOpen };
+
+    explicit ProviderHealth(uint32_t seed) : rng_(seed) {}
+
+    // May a request go out at `now`? A forced one skips the backoff of a
+    // closed breaker, never an open one.
+    bool Allow(time_t now, bool force);
+
+    void Success();
+    void Failure(time_t now);
+
+    State state() const { return state_; }
+    int failures() const { return failures_; }
+    // When a failing provider may be tried again; 0 if it is not failing.
+    time_t retry_at() const { return retry_at_; }
+
+private:
+    // Seconds to wait after `failures` failures in a row, jittered down by
+    // up to half.
+    int Backoff(int failures);
+
+    State state_ = State::Closed;
+    int failures_ = 0;
+    time_t retry_at_ = 0;
+    std::minstd_rand rng_;
+};
+
+const char* StateName(ProviderHealth::State state);
+
+#endif
@@ -0,0 +1,329 @@
+#include "render.h"
+#include "conditions.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+using rgb_matrix::Canvas;
+using rgb_matrix::Color;
+
+// All weather icons, procedural and PNG, at their own size
+IconAtlas iconAtlas;
+
+
+void DrawBorder(Canvas* canvas, Color color) {
+    int width = canvas->width();
+    int height = canvas->height();
+
+    for (int x = 0; x < width; ++x) {
+        canvas->SetPixel(x, 0, color.r, color.g, color.b);             // top
+        canvas->SetPixel(x, height - 1, color.r, color.g, color.b);    // bottom
+    }
+
+    for (int y = 0; y < height; ++y) {
+    for (int y = 0; y < height; ++y) {
+        canvas->SetPixel(0, y, color.r, color.g, color.b);             // left
+        canvas->SetPixel(width - 1, y, color.r, color.g, color.b);     // right
+    }
+}
+}
+void DrawTextOutline(Canvas* canvas, const OutlineFont& font, int x, int y,
+                     const rgb_matrix::Color& outline_color, const rgb_matrix::Color& text_color,
+                     const char* text) {
+    // Outline and fill in one pass, from the font's pre-dilated glyphs
+    font.DrawText(canvas, x, y, outline_color, text_color, text);
+}
+
+int MeasureTextWidth(const BitmapFont& font, const char* text) {
+    return TextWidth(font, text);
+}
+
+
+void DrawFilledRoundedBox(Canvas* canvas,
+                          int x, int y, int w, int h,
+                          const rgb_matrix::Color& fill,
+                          const rgb_matrix::Color& border,
+                          bool rounded) {
+    for (int dy = 0; dy < h; ++dy) {
+        for (int dx = 0; dx < w; ++dx) {
+            int px = x + dx;
+            int py = y + dy;
+
+            if (rounded) {
+                bool top = dy == 0;
+                bool bottom = dy == h - 1;
+                bool left = dx == 0;
+                bool right = dx == w - 1;
+                if ((top && left) || (top && right) ||
+                    (bottom && left) || (bottom && right)) continue;
+            }
+
+            bool isEdge = (dy == 0 || dy == h - 1 || dx == 0 || dx == w - 1);
+            const rgb_matrix::Color& c = isEdge ? border : fill;
+            canvas->SetPixel(px, py, c.r, c.g, c.b);
+        }
+    }
+}
+
+namespace {
+
+constexpr float MIN_TEMP_F = 32.0f;    // freezing
+constexpr float MAX_TEMP_F = 100.0f;   // hot
+
+// TempToColorRamp() at every 0.1 °F of its range. Temperatures come with
+// one decimal, and (32 + i / 10) is computed as i / 10.0f so the entries
+// match the ramp exactly for them.
+struct TempPalette {
+    static const int STEPS = (int)((MAX_TEMP_F - MIN_TEMP_F) * 10) + 1;
+    rgb_matrix::Color colors[STEPS];
+
+    TempPalette() {
+        for (int i = 0; i < STEPS; ++i) {
+            colors[i] = TempToColorRamp((int(MIN_TEMP_F * 10) + i) / 10.0f);
+        }
+    }
+};
+
+const TempPalette tempPalette;
+
+}  // namespace
+
+rgb_matrix::Color TempToColor(float tempF) {
+    float clamped = std::max(MIN_TEMP_F, std::min(MAX_TEMP_F, tempF));
+    return tempPalette.colors[std::lround((clamped - MIN_TEMP_F) * 10)];
+}
+
+rgb_matrix::Color TempToColorRamp(float tempF) {
+    float minT = MIN_TEMP_F;
+    float maxT = MAX_TEMP_F;
+    float clamped = std::max(minT, std::min(maxT, tempF));
+
+    // Normalize 0..1
+    float t = (clamped - minT) / (maxT - minT);
+
+    uint8_t r, g, b;
+
+    if (t < 0.33f) {
+        // Blue → Cyan
+        float u = t / 0.33f;
+        r = 0;
+        g = static_cast<uint8_t>(255 * u);
+        b = 255;
+    } else if (t < 0.66f) {
+        // Cyan → Orange
+        float u = (t - 0.33f) / 0.33f;
+        r = static_cast<uint8_t>(255 * u);
+        g = static_cast<uint8_t>(255 - (90 * u));   // 255 → 165
+        b = static_cast<uint8_t>(255 * (1.0f - u)); // 255 → 0
+    } else {
+        // Orange → Red
+        float u = (t - 0.66f) / 0.34f;
+        r = 255;
+        g = static_cast<uint8_t>(165 * (1.0f - u));
+        b = 0;
+    }
+
+    return rgb_matrix::Color(r, g, b);
+}
+
+
+// --- Update icon layer: the weather icon or its current frame ---
+void UpdateIconLayer(Canvas* layer,
+                     const Layout &layout,
+                     IconId icon,
+                     int frame) {
+    DrawIconLayer(layer, PlanIcon(layout, icon, frame), layout);
+}
+
+IconView PlanIcon(const Layout &layout, IconId icon, int frame) {
+    const IconAnimations* animations = layout.animations;
+    return animations && animations->frames(icon) ? animations->Frame(icon, frame)
+                                                  : layout.icons->Get(icon);
+}
+
+void DrawIconLayer(Canvas* layer, const IconView &icon, const Layout &layout) {
+    layer->Clear();
+    DrawIcon(layer, layout.icon.x, layout.icon.y, icon);
+}
+
+// --- Update weather layer: the temperature ---
+void UpdateWeatherLayer(Canvas* layer,
+                        const WeatherData &weatherData,
+                        const Layout &layout,
+                        const Color &outline) {
+	DrawWeatherLayer(layer, PlanTemp(weatherData, layout, outline), layout);
+}
+
+TempText PlanTemp(const WeatherData &weatherData, const Layout &layout, const Color &outline) {
+	TempText temp;
+	temp.text = weatherData.temp;
+	temp.outline = outline;
+	// The number in the text, units dropped; °C is turned into °F for the palette
+	float tempF = 62.0f;  // default fallback
+	char digits[sizeof(weatherData.temp)];
+	size_t n = 0;
+	for (size_t i = 0; i < weatherData.temp.size(); ++i) {
+		char c = weatherData.temp[i];
+		if (std::isdigit((unsigned char)c) || c == '.' || c == '-') digits[n++] = c;
+	}
+	digits[n] = 0;
+	if (n > 0) {
+		char* end;
+		float parsed = strtof(digits, &end);
+		if (end == digits) std::cerr << "Failed to parse temperature: " << weatherData.temp << std::endl;
+		else if (strstr(weatherData.temp.c_str(), "°C")) tempF = CelsiusToFahrenheit(parsed);
+		else tempF = parsed;
+	}
+	int temp_width = MeasureTextWidth(*layout.text_font, temp.text.c_str());
+
+	// Centred under the icon
+	temp.x = layout.temp_center_x - temp_width / 2;
+	temp.fill = TempToColor(tempF);
+	return temp;
+}
+
+void DrawWeatherLayer(Canvas* layer, const TempText &temp, const Layout &layout) {
+	layer->Clear();
+	DrawTextOutline(layer, *layout.temp_font, temp.x, layout.temp_baseline, temp.fill,
+	                temp.outline, temp.text.c_str());
+}
+
+// --- Update forecast layer: hourly strip on the right panel ---
+void UpdateForecastLayer(Canvas* layer,
+                         const HourlyForecast &forecast,
+                         time_t now,
+                         const Layout &layout,
+                         const Color &rain) {
+    DrawForecastLayer(layer, PlanForecast(forecast, now, layout, rain));
+}
+
+ForecastPlot PlanForecast(const HourlyForecast &forecast, time_t now, const Layout &layout,
+                          const Color &rain) {
+    ForecastPlot plot;
+    const int first = forecast.Find(now);
+    if (first < 0) return plot;
+    const int hours = std::min(FORECAST_HOURS, forecast.size() - first);
+    const Rect& area = layout.forecast;
+    const int column = area.w / FORECAST_HOURS;
+    const int thickness = layout.scale;
+    auto add = [&](int x, int y, int w, int h, const Color& c) {
+        plot.bars[plot.count].rect = Rect(x, y, w, h);
+        plot.bars[plot.count++].color = c;
+    };
+
+    float lo = forecast.temp(first), hi = lo;
+    for (int i = first; i < first + hours; ++i) {
+        lo = std::min(lo, forecast.temp(i));
+        hi = std::max(hi, forecast.temp(i));
+    }
+
+    // Chance of rain as dim bars from the bottom, under the line
+    for (int i = 0; i < hours; ++i) {
+        int p = forecast.precip(first + i);
+        if (p <= 0) continue;
+        int h = (p * area.h + 50) / 100;
+        add(area.x + i * column, area.bottom() - h, column, h, rain);
+    }
+
+    // Temperature, scaled to the range shown; each hour joins the last
+    // with a vertical step so the line has no gaps
+    const int travel = area.h - thickness;
+    int last_y = -1;
+    for (int i = 0; i < hours; ++i) {
+        float t = forecast.temp(first + i);
+        int y = hi > lo ? area.y + (int)std::lround((hi - t) / (hi - lo) * travel)
+                        : area.y + travel / 2;
+        int x = area.x + i * column;
+        Color c = TempToColor(t);
+        add(x, y, column, thickness, c);
+        if (last_y >= 0 && last_y != y) {
+            int top = std::min(last_y, y), bottom = std::max(last_y, y);
+            add(x, top, thickness, bottom - top, c);
+        }
+        last_y = y;
+    }
+    return plot;
+}
+
+void DrawForecastLayer(Canvas* layer, const ForecastPlot &plot) {
+    layer->Clear();
+    const Rect area = DrawableArea(layer);
+    for (int i = 0; i < plot.count; ++i) {
+        const Rect r = Intersect(plot.bars[i].rect, area);
+        const Color& c = plot.bars[i].color;
+        for (int py = r.y; py < r.bottom(); ++py) {
+            for (int px = r.x; px < r.right(); ++px) layer->SetPixel(px, py, c.r, c.g, c.b);
+        }
+    }
+}
+
+// --- Update date layer: the date on the right panel ---
+void UpdateDateLayer(Canvas* layer,
+                     const char *date_str,
+                     const Layout &layout,
+                     const Color &color) {
+	layer->Clear();
+    DrawText(layer, *layout.text_font, layout.date_x, layout.date_baseline,
+             color, date_str);
+}
+
+// Area a glyph covers when drawn with its baseline at y.
+Rect GlyphRect(const BitmapFont &font, int x, int y, uint32_t codepoint) {
+    const GlyphBitmap* g = font.Glyph(codepoint);
+    if (!g) return Rect();
+    return Rect(x, y + g->top, g->advance, g->row_count);
+}
+
+// --- Update clock layer: the time, one glyph at a time ---
+void UpdateClockLayer(Layer* layer, const Layout &layout, Color &clockColor,
+                      const char *time_str, ShownTime &shown) {
+    DrawClockLayer(layer, PlanClock(layout, clockColor, time_str, shown), layout);
+}
+
+ClockText PlanClock(const Layout &layout, const Color &clockColor,
+                    const char *time_str, ShownTime &shown) {
+    const BitmapFont &clockFont = *layout.clock_font;
+    ClockText clock;
+    clock.text = time_str;
+    clock.replaced = shown.text;
+    clock.color = clockColor;
+    int time_width = TextWidth(clockFont, time_str);
+    clock.x = layout.clock_area.x + (layout.clock_area.w - time_width) / 2;
+
+    // Same place, colour and length: swap just the glyphs that differ, as
+    // long as their advances match so nothing after them moves.
+    bool inPlace = clock.x == shown.x && shown.text.size() == clock.text.size() &&
+                   shown.color.r == clockColor.r && shown.color.g == clockColor.g &&
+                   shown.color.b == clockColor.b;
+    for (size_t i = 0; inPlace && i < shown.text.size(); ++i) {
+        inPlace = clockFont.Advance((uint8_t)shown.text[i]) == clockFont.Advance((uint8_t)time_str[i]);
+    }
+    clock.in_place = inPlace;
+
+    shown.text = clock.text;
+    shown.x = clock.x;
+    shown.color = clockColor;
+    return clock;
+}
+
+void DrawClockLayer(Layer* layer, const ClockText &clock, const Layout &layout) {
+    const BitmapFont &clockFont = *layout.clock_font;
+    const int baseline = layout.clock_baseline;
+    if (!clock.in_place) {
+        layer->Clear();
+        DrawText(layer, clockFont, clock.x, baseline, clock.color, clock.text.c_str());
+        return;
+    }
+    int x = clock.x;
+    for (size_t i = 0; i < clock.text.size(); ++i) {
+        int advance = clockFont.Advance((uint8_t)clock.text[i]);
+        if (clock.text[i] != clock.replaced[i]) {
+            layer->ClearRect(GlyphRect(clockFont, x, baseline, (uint8_t)clock.replaced[i]));
+            clockFont.DrawGlyph(layer, x, baseline, clock.color, (uint8_t)clock.text[i]);
+        }
+        x += advance;
+    }
+}
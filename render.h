@@ -0,0 +1,126 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "canvas.h"
+#include "graphics.h"
+
+#include "bitmap_font.h"
+#include "compositor.h"
+#include "conditions.h"
+#include "fixed_string.h"
+#include "forecast.h"
+#include "icons.h"
+#include "layout.h"
+#include "weather.h"
+
+#include <stdint.h>
+
+// Drawing of the clock's screen. Everything draws into a plain
+// rgb_matrix::Canvas, so it runs the same on the matrix, into compositor
+// layers or into memory (headless mode, benchmarks). Positions, fonts and
+// icons come from a Layout resolved for the display's size.
+
+// All weather icons, procedural and PNG, at their own size
+extern IconAtlas iconAtlas;
+
+void DrawBorder(rgb_matrix::Canvas* canvas, rgb_matrix::Color color);
+void DrawTextOutline(rgb_matrix::Canvas* canvas, const OutlineFont& font, int x, int y,
+                     const rgb_matrix::Color& outline_color, const rgb_matrix::Color& text_color,
+                     const char* text);
+int MeasureTextWidth(const BitmapFont& font, const char* text);
+void DrawFilledRoundedBox(rgb_matrix::Canvas* canvas,
+                          int x, int y, int w, int h,
+                          const rgb_matrix::Color& fill,
+                          const rgb_matrix::Color& border,
+                          bool rounded = true);
+// Blue through orange to red from 32 to 100 °F, looked up in a table of
+// TempToColorRamp() at every tenth of a degree.
+rgb_matrix::Color TempToColor(float tempF);
+// The ramp itself, computed every time.
+rgb_matrix::Color TempToColorRamp(float tempF);
+
+// --- Layers ---
+// Each Update*Layer() works out what to draw, then draws it. The tiled
+// renderer runs the two steps apart: the Plan*() half once a frame, then
+// the Draw*Layer() half in every band, which only writes pixels.
+
+// The temperature under the weather icon, outlined in `outline`.
+void UpdateWeatherLayer(rgb_matrix::Canvas* layer,
+                        const WeatherData &weatherData,
+                        const Layout &layout,
+                        const rgb_matrix::Color &outline);
+
+struct TempText {
+    FixedString<16> text;
+    int x = 0;
+    rgb_matrix::Color fill, outline;
+};
+TempText PlanTemp(const WeatherData &weatherData, const Layout &layout,
+                  const rgb_matrix::Color &outline);
+void DrawWeatherLayer(rgb_matrix::Canvas* layer, const TempText &temp, const Layout &layout);
+
+// The weather icon: frame `frame` of its animation if it has one, else
+// the still icon. Only what the last icon or frame covered is redrawn.
+void UpdateIconLayer(rgb_matrix::Canvas* layer,
+                     const Layout &layout,
+                     IconId icon,
+                     int frame);
+IconView PlanIcon(const Layout &layout, IconId icon, int frame);
+void DrawIconLayer(rgb_matrix::Canvas* layer, const IconView &icon, const Layout &layout);
+
+// The next FORECAST_HOURS hours from the one holding `now`: a temperature
+// sparkline in TempToColor() colours over `rain` bars for the chance of
+// rain.
+void UpdateForecastLayer(rgb_matrix::Canvas* layer,
+                         const HourlyForecast &forecast,
+                         time_t now,
+                         const Layout &layout,
+                         const rgb_matrix::Color &rain);
+
+// The strip as filled rectangles, in drawing order: rain bars, then the
+// line with its steps.
+struct ForecastPlot {
+    struct Bar {
+        Rect rect;
+        rgb_matrix::Color color;
+    };
+    Bar bars[3 * FORECAST_HOURS];
+    int count = 0;
+};
+ForecastPlot PlanForecast(const HourlyForecast &forecast, time_t now, const Layout &layout,
+                          const rgb_matrix::Color &rain);
+void DrawForecastLayer(rgb_matrix::Canvas* layer, const ForecastPlot &plot);
+
+// The date on the right panel; the day above it is the ticker's.
+void UpdateDateLayer(rgb_matrix::Canvas* layer,
+                     const char *date_str,
+                     const Layout &layout,
+                     const rgb_matrix::Color &color);
+
+// Area a glyph covers when drawn with its baseline at y.
+Rect GlyphRect(const BitmapFont &font, int x, int y, uint32_t codepoint);
+
+// What the clock layer currently shows, so the next tick can redraw only
+// the characters that changed.
+struct ShownTime {
+    FixedString<16> text;
+    int x = -1;
+    rgb_matrix::Color color;
+};
+
+// The time, redrawing only the glyphs that changed since `shown`.
+void UpdateClockLayer(Layer* layer, const Layout &layout, rgb_matrix::Color &clockColor,
+                      const char *time_str, ShownTime &shown);
+
+// The time to draw and what it replaces; planning moves `shown` on.
+struct ClockText {
+    FixedString<16> text, replaced;
+    int x = 0;
+    rgb_matrix::Color color;
+    bool in_place = false;   // only the glyphs that differ from `replaced`
+};
+ClockText PlanClock(const Layout &layout, const rgb_matrix::Color &clockColor,
+                    const char *time_str, ShownTime &shown);
+void DrawClockLayer(Layer* layer, const ClockText &clock, const Layout &layout);
+
+#endif
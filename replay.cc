@@ -0,0 +1,144 @@
+#include "replay.h"
+
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+// `url` without OpenWeather's API key, so recordings hold no secret and
+// replay whatever key the config has now.
+std::string WithoutKey(const std::string& url) {
+    size_t query = url.find('?');
+    if (query == std::string::npos) return url;
+    std::string kept = url.substr(0, query);
+    char separator = '?';
+    for (size_t start = query + 1; start <= url.size();) {
+        size_t end = std::min(url.find('&', start), url.size());
+        std::string param = url.substr(start, end - start);
+        if (!param.empty() && param.compare(0, 6, "appid=") != 0 && param != "appid") {
+            kept += separator;
+            kept += param;
+            separator = '&';
+        }
+        start = end + 1;
+    }
+    return kept;
+}
+
+// The path and query, without the key: a recording made against
+// --weather-server replays without it, and the other way round.
+std::string Resource(const std::string& url) {
+    size_t scheme = url.find("://");
+    size_t path = url.find('/', scheme == std::string::npos ? 0 : scheme + 3);
+    return path == std::string::npos ? "/" : WithoutKey(url.substr(path));
+}
+
+}  // namespace
+
+// --- RecordingHttp ---
+RecordingHttp::RecordingHttp(HttpSource* http, const std::string& path)
+    : http_(http), out_(path, std::ios::app) {}
+
+std::vector<HttpResponse> RecordingHttp::PerformAll(const std::vector<HttpRequest>& requests,
+                                                    const DoneFn& on_done) {
+    return http_->PerformAll(requests, [&](size_t n, const HttpResponse& r) {
+        nlohmann::json line = {
+            {"at", (int64_t)time(nullptr)},
+            {"url", WithoutKey(requests[n].url)},
+            {"ok", r.ok},
+            {"status", r.status},
+            {"body", r.body},
+            {"error", r.error},
+            {"etag", r.etag},
+            {"last_modified", r.last_modified},
+            {"total", r.timing.total},
+        };
+        // One line per response, flushed so a killed run keeps what it saw
+        out_ << line.dump() << std::endl;
+        if (on_done) on_done(n, r);
+    });
+}
+
+// --- ReplayHttp ---
+bool ReplayHttp::Load(const std::string& path, std::string* error) {
+    std::ifstream in(path);
+    if (!in) {
+        *error = "can't read " + path;
+        return false;
+    }
+    records_.clear();
+    std::string line;
+    for (int number = 1; std::getline(in, line); ++number) {
+        if (line.empty()) continue;
+        try {
+            nlohmann::json j = nlohmann::json::parse(line);
+            RecordedResponse record;
+            record.at = j.at("at").get<int64_t>();
+            record.url = Resource(j.at("url").get<std::string>());
+            record.response.ok = j.value("ok", false);
+            record.response.status = j.value("status", 0L);
+            record.response.body = j.value("body", "");
+            record.response.error = j.value("error", "");
+            record.response.etag = j.value("etag", "");
+            record.response.last_modified = j.value("last_modified", "");
+            record.response.timing.total = j.value("total", 0.0);
+            records_.push_back(record);
+        } catch (...) {
+            std::ostringstream message;
+            message << path << ":" << number << ": not a recorded response";
+            *error = message.str();
+            return false;
+        }
+    }
+    // Appended as they arrived, but concurrent runs may interleave
+    std::stable_sort(records_.begin(), records_.end(),
+                     [](const RecordedResponse& a, const RecordedResponse& b) { return a.at < b.at; });
+    return true;
+}
+
+HttpResponse ReplayHttp::Answer(const std::string& request_url) const {
+    const std::string url = Resource(request_url);
+    // Newest at or before now, else the oldest
+    const RecordedResponse* found = nullptr;
+    for (const RecordedResponse& record : records_) {
+        if (record.url != url) continue;
+        if (found && record.at > now_) break;
+        found = &record;
+    }
+    if (!found) {
+        HttpResponse missing;
+        missing.error = "not in the recording";
+        return missing;
+    }
+    if (!found->response.ok || found->response.status != 304) return found->response;
+
+    // The body a 304 confirmed is the last 200 before it
+    const RecordedResponse* confirmed = nullptr;
+    for (const RecordedResponse& record : records_) {
+        if (&record == found) break;
+        if (record.url == url && record.response.ok && record.response.status == 200) {
+            confirmed = &record;
+        }
+    }
+    return confirmed ? confirmed->response : found->response;
+}
+
+std::vector<HttpResponse> ReplayHttp::PerformAll(const std::vector<HttpRequest>& requests,
+                                                 const DoneFn& on_done) {
+    std::vector<HttpResponse> responses;
+    for (size_t i = 0; i < requests.size(); ++i) {
+        responses.push_back(Answer(requests[i].url));
+        if (on_done) on_done(i, responses.back());
+    }
+    return responses;
+}
+
+uint64_t FrameChecksum(const uint8_t* data, size_t size) {
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= data[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
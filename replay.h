@@ -0,0 +1,71 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "http_client.h"
+
+#include <stdint.h>
+#include <fstream>
+#include <string>
+#include <time.h>
+#include <vector>
+
+// --- Record and replay ---
+// A live run can record every weather response, with the wall time it
+// arrived, as one JSON object per line. A replay then runs the whole loop
+// headless on a simulated clock from that file: no sleeping and no
+// network, so a week of midnights, sunsets and refreshes takes seconds,
+// and the same recording always gives the same frames.
+
+struct RecordedResponse {
+    time_t at = 0;            // wall time it arrived
+    std::string url;          // path and query, without the server or API key
+    HttpResponse response;
+};
+
+// Passes requests on to `http` and appends each response to a file. The
+// API key is left out of the URLs written.
+class RecordingHttp : public HttpSource {
+public:
+    RecordingHttp(HttpSource* http, const std::string& path);
+
+    bool ok() const { return out_.good(); }
+
+    std::vector<HttpResponse> PerformAll(const std::vector<HttpRequest>& requests,
+                                         const DoneFn& on_done = DoneFn()) override;
+
+private:
+    HttpSource* http_;
+    std::ofstream out_;
+};
+
+// Answers each request with the newest recorded response for its path and
+// query (whichever server it came from) as of the simulated time set last;
+// before the first one, with that one. A 304 in the recording stands for
+// the body it confirmed, so the answer is the same whatever the replay's
+// cache holds. Requests never recorded fail like an unreachable host.
+class ReplayHttp : public HttpSource {
+public:
+    // False, with the reason in `error`, if the file can't be read.
+    bool Load(const std::string& path, std::string* error);
+
+    void SetTime(time_t now) { now_ = now; }
+
+    // When the recording starts and ends; both 0 if it is empty.
+    time_t first() const { return records_.empty() ? 0 : records_.front().at; }
+    time_t last() const { return records_.empty() ? 0 : records_.back().at; }
+    size_t size() const { return records_.size(); }
+
+    std::vector<HttpResponse> PerformAll(const std::vector<HttpRequest>& requests,
+                                         const DoneFn& on_done = DoneFn()) override;
+
+private:
+    HttpResponse Answer(const std::string& url) const;
+
+    std::vector<RecordedResponse> records_;   // oldest first
+    time_t now_ = 0;
+};
+
+// FNV-1a over a frame's bytes, for comparing replays.
+uint64_t FrameChecksum(const uint8_t* data, size_t size);
+
+#endif
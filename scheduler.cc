@@ -0,0 +1,127 @@
+#include "scheduler.h"
+
+#include <errno.h>
+#include <algorithm>
+
+namespace {
+
+const int64_t NS_PER_SEC = 1000000000;
+
+int64_t Now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * NS_PER_SEC + ts.tv_nsec;
+}
+
+// Absolute sleep, so time spent rendering or a wakeup by a signal never
+// shifts the target. A wall clock step is honoured by the kernel.
+void SleepUntil(int64_t ns) {
+    struct timespec ts;
+    ts.tv_sec = ns / NS_PER_SEC;
+    ts.tv_nsec = ns % NS_PER_SEC;
+    while (clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+}
+
+}  // namespace
+
+// --- TickScheduler ---
+TickScheduler::TickScheduler(int rate, int64_t render_ahead_ns)
+    : rate_(rate), render_ahead_ns_(render_ahead_ns) {}
+
+// Ticks are spread evenly over each second and the first always falls on
+// the second itself, whatever the rate.
+int64_t TickScheduler::Boundary(int64_t index) const {
+    return index / rate_ * NS_PER_SEC + index % rate_ * NS_PER_SEC / rate_;
+}
+
+void TickScheduler::SetRate(int rate) {
+    if (rate == rate_) return;
+    rate_ = rate;
+    // The last tick at the new rate not after the current one, so the next
+    // is the first one after it
+    index_ = due_ns_ / NS_PER_SEC * rate_ + due_ns_ % NS_PER_SEC * rate_ / NS_PER_SEC;
+}
+
+void TickScheduler::Simulate(int64_t start_ns) {
+    simulated_ = true;
+    int64_t sec = start_ns / NS_PER_SEC, rem = start_ns % NS_PER_SEC;
+    index_ = sec * rate_ + (rem * rate_ + NS_PER_SEC - 1) / NS_PER_SEC - 1;
+}
+
+struct timespec TickScheduler::WaitForRender() {
+    if (simulated_) due_ns_ = Boundary(++index_);
+    else WaitForNext();
+
+    struct timespec due;
+    due.tv_sec = due_ns_ / NS_PER_SEC;
+    due.tv_nsec = due_ns_ % NS_PER_SEC;
+    return due;
+}
+
+void TickScheduler::WaitForNext() {
+    int64_t now = Now();
+
+    // First tick at or after now; every earlier one is already too late
+    int64_t sec = now / NS_PER_SEC, rem = now % NS_PER_SEC;
+    int64_t earliest = sec * rate_ + (rem * rate_ + NS_PER_SEC - 1) / NS_PER_SEC;
+
+    if (index_ < 0) {
+        // Show the current tick right away rather than a blank display
+        index_ = earliest - 1;
+        due_ns_ = Boundary(index_);
+    } else {
+        int64_t next = index_ + 1;
+        int64_t period = NS_PER_SEC / rate_;
+        if (next < earliest) {
+            // Fell behind, or the clock stepped forward
+            skipped_.fetch_add(earliest - next, std::memory_order_relaxed);
+            next = earliest;
+        } else if (Boundary(next) - now > period + render_ahead_ns_) {
+            // The clock stepped back: follow it instead of sleeping it out
+            next = earliest;
+        }
+        index_ = next;
+        due_ns_ = Boundary(index_);
+
+        int64_t wake = due_ns_ - render_ahead_ns_;
+        SleepUntil(wake);
+        wake_.Record(Now() - wake);
+    }
+}
+
+void TickScheduler::WaitForTick() {
+    if (!simulated_) SleepUntil(due_ns_);
+}
+
+void TickScheduler::Swapped() {
+    if (simulated_) return;
+    // The first frame is shown as soon as it is ready, not on a boundary
+    if (wake_.count() == 0) return;
+    swap_.Record(Now() - due_ns_);
+}
+
+void TickScheduler::PrintStats(std::ostream& out) const {
+    out << "Ticks at " << rate_ << "/s, rendered " << render_ahead_ns_ / 1000
+        << " us ahead, " << skipped() << " skipped\n";
+    wake_.Print(out, "wake lateness");
+    swap_.Print(out, "swap lateness");
+    out.flush();
+}
+
+// --- FrameBudget ---
+FrameBudget::FrameBudget(int max_fps, float share)
+    : min_interval_ns_(NS_PER_SEC / std::max(max_fps, 1)), share_(share),
+      interval_ns_(min_interval_ns_) {}
+
+void FrameBudget::Spent(int64_t now_ns, int64_t cost_ns) {
+    if (fixed_cost_ns_ >= 0) cost_ns = fixed_cost_ns_;
+    cost_ns_ = cost_ns_ ? cost_ns_ + (cost_ns - cost_ns_) / 8 : cost_ns;
+    interval_ns_ = std::max(min_interval_ns_, (int64_t)(cost_ns_ / share_));
+    // A little early, so frames on ticks of the same rate aren't missed
+    // for a nanosecond of rounding
+    next_ns_ = now_ns + interval_ns_ - min_interval_ns_ / 8;
+}
+
+int FrameBudget::fps() const {
+    return (int)(NS_PER_SEC / interval_ns_);
+}
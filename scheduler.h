@@ -0,0 +1,100 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "metrics.h"
+
+#include <stdint.h>
+#include <ostream>
+#include <time.h>
+
+// --- Wall-clock tick scheduling ---
+// Ticks fall on absolute CLOCK_REALTIME boundaries: every whole second, or
+// `rate` evenly spaced points within each second for animations. The loop
+// wakes a little ahead of each boundary to render, then sleeps again until
+// the boundary itself and swaps, so the new second appears on the second
+// rather than a render time plus one second after the previous one.
+
+class TickScheduler {
+public:
+    // `rate` ticks per second, woken `render_ahead_ns` before each one.
+    TickScheduler(int rate, int64_t render_ahead_ns);
+
+    // Sleeps until it is time to render the next tick and returns the wall
+    // time that tick will be shown at. Ticks whose render time has already
+    // passed are skipped, and the wall clock stepping either way is
+    // followed rather than slept through.
+    struct timespec WaitForRender();
+
+    // Sleeps until the tick returned by WaitForRender() is due; call it
+    // right before swapping.
+    void WaitForTick();
+
+    // Records how late the swap finished, right after it returns.
+    void Swapped();
+
+    // Ticks at `rate` a second from the next one on; the current tick, as
+    // returned by WaitForRender(), stays where it is.
+    void SetRate(int rate);
+
+    // Runs on simulated time from `start_ns` on, for replays: nothing
+    // sleeps, each WaitForRender() moves on to the next tick, and no tick
+    // is ever late or skipped.
+    void Simulate(int64_t start_ns);
+
+    // The wake-up, swap lateness and skip count so far.
+    void PrintStats(std::ostream& out) const;
+
+    int rate() const { return rate_; }
+    // How late the loop woke to render, and how late the swaps finished.
+    const LatencyHistogram& wake() const { return wake_; }
+    const LatencyHistogram& swap() const { return swap_; }
+    uint64_t skipped() const { return skipped_.load(std::memory_order_relaxed); }
+
+private:
+    int64_t Boundary(int64_t index) const;
+    // Sleeps until the next tick's render time and makes it the current one.
+    void WaitForNext();
+
+    int rate_;
+    const int64_t render_ahead_ns_;
+    int64_t index_ = -1;      // ticks since the epoch at `rate_` per second
+    int64_t due_ns_ = 0;      // wall time of the current tick
+    bool simulated_ = false;
+    std::atomic<uint64_t> skipped_{0};
+    LatencyHistogram wake_, swap_;
+};
+
+// Paces an animation that shares a core with the rest of the clock (and,
+// on a Pi, the matrix refresh thread), e.g. the ticker or a weather icon:
+// frames come at most `max_fps` a second, and further apart when what
+// they cost would take more than `share` of a core at that rate. The
+// cost is a running average, so a slow frame now and then doesn't
+// throttle the animation.
+class FrameBudget {
+public:
+    FrameBudget(int max_fps, float share);
+
+    // Whether the next frame may be drawn at `now_ns`.
+    bool Due(int64_t now_ns) const { return now_ns >= next_ns_; }
+
+    // Records a frame drawn for `now_ns` that took `cost_ns` of CPU.
+    void Spent(int64_t now_ns, int64_t cost_ns);
+
+    // Counts every frame as `cost_ns` from now on, whatever Spent() is
+    // told, so a replay draws the same frames on any host.
+    void FixCost(int64_t cost_ns) { fixed_cost_ns_ = cost_ns; }
+
+    // Frames a second it currently allows, and their average cost.
+    int fps() const;
+    int64_t cost_ns() const { return cost_ns_; }
+
+private:
+    const int64_t min_interval_ns_;
+    const float share_;
+    int64_t interval_ns_;
+    int64_t cost_ns_ = 0;
+    int64_t next_ns_ = 0;
+    int64_t fixed_cost_ns_ = -1;   // -1 while frames are measured
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include "ticker.h"
+
+#include <algorithm>
+
+namespace {
+
+const int64_t NS_PER_SEC = 1000000000;
+// 1/256 pixel a second, in nanoseconds
+const int64_t NS_PER_STEP = NS_PER_SEC / 256;
+// How long new text stays at the start before it scrolls
+const int64_t HOLD_NS = 2 * NS_PER_SEC;
+
+// Records which pixels text covers, into one row band of a strip.
+class CoverageCanvas : public rgb_matrix::Canvas {
+public:
+    CoverageCanvas(uint8_t* pixels, int width, int height, int stride)
+        : pixels_(pixels), width_(width), height_(height), stride_(stride) {}
+
+    int width() const override { return width_; }
+    int height() const override { return height_; }
+    void SetPixel(int x, int y, uint8_t, uint8_t, uint8_t) override {
+        if (x < 0 || x >= width_ || y < 0 || y >= height_) return;
+        pixels_[y * stride_ + x] = 255;
+    }
+    void Clear() override {}
+    void Fill(uint8_t, uint8_t, uint8_t) override {}
+
+private:
+    uint8_t* pixels_;
+    int width_, height_, stride_;
+};
+
+}  // namespace
+
+// --- Ticker ---
+Ticker::Ticker(const Rect& box, int inset, int baseline, int speed)
+    : box_(box), inset_(inset), baseline_(baseline), speed_(speed) {}
+
+bool Ticker::SetText(const BitmapFont& font, const char* text, int64_t now_ns) {
+    FixedString<96> next(text);
+    if (next == text_ && !strip_.empty()) return false;
+    text_ = next;
+    start_ns_ = now_ns;
+    offset_ = 0;
+
+    const int text_width = TextWidth(font, text_.c_str());
+    scrolls_ = inset_ + text_width > box_.w;
+    // Scrolling text comes round again after half a box of space
+    const int gap = box_.w / 2;
+    period_ = scrolls_ ? inset_ + text_width + gap : box_.w;
+    stride_ = period_ + box_.w;
+
+    // Room for the longest text there can be, so a new text never
+    // reallocates the strip once the first is drawn
+    if (strip_.capacity() == 0) {
+        int widest = 0;
+        for (size_t i = 0; i < font.glyph_count(); ++i) {
+            widest = std::max<int>(widest, font.glyphs()[i].advance);
+        }
+        strip_.reserve((size_t)box_.h * (inset_ + 95 * widest + gap + 2 * box_.w));
+    }
+    strip_.assign((size_t)box_.h * stride_, 0);
+    CoverageCanvas canvas(strip_.data(), period_, box_.h, stride_);
+    DrawText(&canvas, font, inset_, baseline_ - box_.y, rgb_matrix::Color(255, 255, 255),
+             text_.c_str());
+    for (int y = 0; y < box_.h; ++y) {
+        uint8_t* row = &strip_[(size_t)y * stride_];
+        std::copy(row, row + box_.w, row + period_);
+    }
+    return true;
+}
+
+bool Ticker::Advance(int64_t now_ns) {
+    uint32_t offset = 0;
+    if (scrolls_ && now_ns > start_ns_ + HOLD_NS) {
+        // Split so a long-running ticker can't overflow
+        int64_t elapsed = now_ns - start_ns_ - HOLD_NS;
+        int64_t steps = elapsed / NS_PER_STEP * speed_ + elapsed % NS_PER_STEP * speed_ / NS_PER_STEP;
+        offset = (uint32_t)(steps % ((int64_t)period_ * 256));
+    }
+    if (offset == offset_) return false;
+    offset_ = offset;
+    return true;
+}
+
+void Ticker::Draw(Layer* layer, const rgb_matrix::Color& color) const {
+    const Rect area = Intersect(box_, DrawableArea(layer));
+    if (area.empty()) return;
+    layer->ClearRect(area);
+    if (strip_.empty()) return;
+
+    // Each pixel is its column's coverage blended with the next one's by
+    // the fraction of a pixel scrolled
+    const int column = (int)(offset_ >> 8) + area.x - box_.x;
+    const int next = offset_ & 0xFF, here = 256 - next;
+    for (int y = area.y; y < area.bottom(); ++y) {
+        const uint8_t* row = &strip_[(size_t)(y - box_.y) * stride_ + column];
+        for (int x = 0; x < area.w; ++x) {
+            int a = (row[x] * here + row[x + 1] * next) >> 8;
+            if (a == 0) continue;
+            layer->SetPixel(area.x + x, y, color.r * a / 255, color.g * a / 255, color.b * a / 255);
+        }
+    }
+}
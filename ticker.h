@@ -0,0 +1,59 @@
+#ifndef TICKER_H
+#define TICKER_H
+
+#include "bitmap_font.h"
+#include "compositor.h"
+#include "fixed_string.h"
+
+#include <stdint.h>
+#include <vector>
+
+// --- Scrolling ticker ---
+// A line of text in a box too narrow for it, e.g. the day followed by
+// "thunderstorm with heavy rain" or an API error on the right panel. The
+// text is drawn once, when it changes, into an off-screen coverage strip;
+// each frame then copies the box's window of the strip into a layer. The
+// window moves in 1/256 pixel steps, blending neighbouring columns, so
+// the text glides at any frame rate instead of jumping a pixel at a time.
+// Text that fits is drawn still, exactly as DrawText() would draw it.
+class Ticker {
+public:
+    // Owns `box`; the text starts `inset` pixels into it, with its
+    // baseline at `baseline`, and scrolls at `speed` pixels a second.
+    Ticker(const Rect& box, int inset, int baseline, int speed);
+
+    // Shows `text` in `font` from `now_ns` on, at the start for a moment
+    // before it scrolls. False, keeping the position, if it is already
+    // the text shown.
+    bool SetText(const BitmapFont& font, const char* text, int64_t now_ns);
+
+    // Whether the text is wider than the box, i.e. Advance() moves it.
+    bool scrolls() const { return scrolls_; }
+
+    // Moves the text to where it is at `now_ns`; false if that is where
+    // it was already drawn.
+    bool Advance(int64_t now_ns);
+
+    // Redraws the box (as far as `layer` keeps it) in `color`.
+    void Draw(Layer* layer, const rgb_matrix::Color& color) const;
+
+    const Rect& box() const { return box_; }
+    // Pixels scrolled from the start, in 1/256 pixels.
+    uint32_t offset() const { return offset_; }
+
+private:
+    const Rect box_;
+    const int inset_, baseline_, speed_;
+
+    FixedString<96> text_;
+    bool scrolls_ = false;
+    // Coverage, 0 or 255, box_.h rows of stride_ columns. The first
+    // period_ columns hold the text and a gap; the box's width of them is
+    // repeated after that, so every window is one contiguous run.
+    std::vector<uint8_t> strip_;
+    int period_ = 0, stride_ = 0;
+    int64_t start_ns_ = 0;
+    uint32_t offset_ = 0;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#include "tiled_renderer.h"
+
+#include <algorithm>
+
+TiledRenderer::Band::Band(const Layout& layout, const Rect& area, int buffer_count)
+    : date(layout.width, layout.height, area),
+      ticker(layout.width, layout.height, area),
+      icon(layout.width, layout.height, area),
+      weather(layout.width, layout.height, area),
+      forecast(layout.width, layout.height, area),
+      clock(layout.width, layout.height, area),
+      compositor(area, buffer_count) {
+    compositor.AddLayer(&date);
+    compositor.AddLayer(&ticker);
+    compositor.AddLayer(&icon);
+    compositor.AddLayer(&weather);
+    compositor.AddLayer(&forecast);
+    compositor.AddLayer(&clock);
+}
+
+TiledRenderer::TiledRenderer(const Layout& layout, int buffer_count, int bands, WorkPool& pool)
+    : layout_(layout), pool_(pool) {
+    bands = std::max(1, std::min(bands, layout.height));
+    for (int i = 0; i < bands; ++i) {
+        int top = layout.height * i / bands, bottom = layout.height * (i + 1) / bands;
+        Rect area(0, top, layout.width, bottom - top);
+        bands_.emplace_back(new Band(layout, area, buffer_count));
+    }
+}
+
+void TiledRenderer::UpdateBand(Band& band, const FrameUpdate& update) {
+    if (update.icon != IconId::Count) DrawIconLayer(&band.icon, plan_.icon, layout_);
+    if (update.weather) DrawWeatherLayer(&band.weather, plan_.temp, layout_);
+    if (update.forecast) DrawForecastLayer(&band.forecast, plan_.forecast);
+    if (update.date) UpdateDateLayer(&band.date, update.date, layout_, update.date_color);
+    if (update.ticker) update.ticker->Draw(&band.ticker, update.ticker_color);
+    if (update.time) DrawClockLayer(&band.clock, plan_.clock, layout_);
+    band.damaged = band.compositor.Prepare();
+}
+
+bool TiledRenderer::Render(const FrameUpdate& update, rgb_matrix::Canvas* target,
+                           bool concurrent_target) {
+    // Parsing, measuring and colours once, not once a band
+    if (update.icon != IconId::Count) plan_.icon = PlanIcon(layout_, update.icon, update.icon_frame);
+    if (update.weather) plan_.temp = PlanTemp(*update.weather, layout_, update.outline_color);
+    if (update.forecast) {
+        plan_.forecast = PlanForecast(*update.forecast, update.now, layout_, update.rain_color);
+    }
+    if (update.time) plan_.clock = PlanClock(layout_, update.clock_color, update.time, shown_);
+
+    auto update_band = [&](int i) { UpdateBand(*bands_[i], update); };
+    pool_.Run(bands(), update_band);
+
+    bool damaged = false;
+    for (const std::unique_ptr<Band>& band : bands_) damaged |= band->damaged;
+    if (!damaged) return false;
+
+    // The frame will be swapped, so every band redraws what its part of
+    // this buffer is missing, damaged this frame or not.
+    auto draw_band = [&](int i) { bands_[i]->compositor.Draw(target); };
+    if (concurrent_target) {
+        pool_.Run(bands(), draw_band);
+    } else {
+        for (int i = 0; i < bands(); ++i) draw_band(i);
+    }
+
+    last_area_ = 0;
+    for (const std::unique_ptr<Band>& band : bands_) last_area_ += band->compositor.last_area();
+    return true;
+}
+
+void TiledRenderer::SetColorLut(const ColorLut* lut) {
+    for (const std::unique_ptr<Band>& band : bands_) band->compositor.SetColorLut(lut);
+}
+
+int BandsForThreads(int threads, int height) {
+    if (threads <= 1) return 1;
+    return std::max(1, std::min(threads * 4, height / 8));
+}
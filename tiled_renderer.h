@@ -0,0 +1,90 @@
+#ifndef TILED_RENDERER_H
+#define TILED_RENDERER_H
+
+#include "compositor.h"
+#include "layout.h"
+#include "render.h"
+#include "ticker.h"
+#include "weather.h"
+#include "work_pool.h"
+
+#include <memory>
+#include <vector>
+
+// What changed since the last frame. Layers whose fields are null keep
+// what they show.
+struct FrameUpdate {
+    const WeatherData* weather = nullptr;   // redraws the temperature
+    IconId icon = IconId::Count;            // redraws the weather icon; Count keeps it
+    int icon_frame = 0;                     // of `icon`'s animation, if it has one
+    const char* date = nullptr;             // redraws the date layer
+    const Ticker* ticker = nullptr;         // redraws the ticker where it is now
+    const HourlyForecast* forecast = nullptr;  // redraws the strip from the hour
+    time_t now = 0;                            // holding `now`
+    const char* time = nullptr;             // the clock, redrawn where it changed
+    // Colours the layers above are redrawn in; see ClockConfig
+    rgb_matrix::Color clock_color = rgb_matrix::Color(255, 255, 255);
+    rgb_matrix::Color date_color = rgb_matrix::Color(255, 255, 255);
+    rgb_matrix::Color ticker_color = rgb_matrix::Color(255, 255, 255);
+    rgb_matrix::Color outline_color = rgb_matrix::Color(0, 0, 0);
+    rgb_matrix::Color rain_color = rgb_matrix::Color(0, 40, 120);
+};
+
+// The screen cut into horizontal bands, each with its own date, ticker,
+// icon, weather, forecast and clock layers and its own compositor, so the
+// bands can be drawn and composed on different threads of a WorkPool.
+// What to draw is worked out once a frame (see the Plan*() functions);
+// each band then only writes the pixels of its own rows, so the frame is
+// pixel-identical to the one a single band draws.
+class TiledRenderer {
+public:
+    // The layout must stay resolved for the renderer's lifetime. One band
+    // draws everything on the calling thread.
+    TiledRenderer(const Layout& layout, int buffer_count, int bands, WorkPool& pool);
+
+    // Applies `update` and redraws the damage into `target`. The bands are
+    // composed in parallel only if `concurrent_target` says that different
+    // rows of the target can be written at the same time. Returns false,
+    // without touching `target`, if nothing changed.
+    bool Render(const FrameUpdate& update, rgb_matrix::Canvas* target, bool concurrent_target);
+
+    // Brightness and gamma for the frames from the next Render() on; see
+    // Compositor::SetColorLut(). No layer is redrawn.
+    void SetColorLut(const ColorLut* lut);
+
+    int bands() const { return (int)bands_.size(); }
+    // Pixels redrawn by the last Render().
+    int last_area() const { return last_area_; }
+
+private:
+    struct Band {
+        Band(const Layout& layout, const Rect& area, int buffer_count);
+
+        Layer date, ticker, icon, weather, forecast, clock;
+        Compositor compositor;
+        bool damaged = false;
+    };
+
+    // One frame's update, worked out before the bands draw it.
+    struct Plan {
+        IconView icon;
+        TempText temp;
+        ForecastPlot forecast;
+        ClockText clock;
+    };
+
+    void UpdateBand(Band& band, const FrameUpdate& update);
+
+    const Layout& layout_;
+    WorkPool& pool_;
+    std::vector<std::unique_ptr<Band>> bands_;
+    Plan plan_;
+    ShownTime shown_;
+    int last_area_ = 0;
+};
+
+// Bands worth using for `threads` threads: a few per thread so stealing
+// can even out the busy ones, but none thinner than 8 rows.
+int BandsForThreads(int threads, int height);
+
+#endif
@@ -0,0 +1,199 @@
+// Builds the asset pack the clock maps at startup.
+//
+//   assetpack OUT.pack fonts/*.bdf icons/*.png
+//
+// Icons are decoded and split into opaque spans ahead of time, and only the
+// glyphs in FontSubset() are kept from each BDF font, so startup no longer
+// has to decode PNGs or parse tens of thousands of BDF lines. Run through
+// "make assets".
+
+#include "assets.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct FontData {
+    std::string name;
+    int height = 0, baseline = 0;
+    std::vector<GlyphBitmap> glyphs;
+    std::vector<uint32_t> rows;
+};
+
+bool EndsWith(const std::string& s, const char* suffix) {
+    size_t n = strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+std::string BaseName(const std::string& path) {
+    size_t slash = path.rfind('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+// Reads the glyphs in FontSubset() with the same geometry rgb_matrix::Font
+// uses: the baseline comes from FONTBOUNDINGBOX, each glyph's rows sit
+// BBX height + y offset above it, and only DWIDTH columns are drawn.
+bool ReadBDF(const std::string& path, FontData& font) {
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f) return false;
+
+    std::vector<uint32_t> subset = FontSubset();
+    std::set<uint32_t> wanted(subset.begin(), subset.end());
+
+    char line[1024];
+    int w, h, xo, yo;
+    bool in_glyph = false, in_bitmap = false;
+    int encoding = -1, advance = 0, bbx_h = 0, bbx_yo = 0;
+    std::vector<uint32_t> bitmap;
+
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "FONTBOUNDINGBOX %d %d %d %d", &w, &h, &xo, &yo) == 4) {
+            font.height = h;
+            font.baseline = h + yo;
+        } else if (sscanf(line, "ENCODING %d", &encoding) == 1) {
+            in_glyph = wanted.count((uint32_t)encoding) != 0;
+            bitmap.clear();
+            advance = bbx_h = bbx_yo = 0;
+        } else if (!in_glyph) {
+            continue;
+        } else if (sscanf(line, "DWIDTH %d %d", &w, &h) == 2) {
+            advance = w;
+        } else if (sscanf(line, "BBX %d %d %d %d", &w, &h, &xo, &yo) == 4) {
+            bbx_h = h;
+            bbx_yo = yo;
+        } else if (strncmp(line, "BITMAP", 6) == 0) {
+            in_bitmap = true;
+        } else if (strncmp(line, "ENDCHAR", 7) == 0) {
+            int first = 0, last = (int)bitmap.size() - 1;
+            while (first <= last && !bitmap[first]) ++first;
+            while (last >= first && !bitmap[last]) --last;
+
+            GlyphBitmap g = {};
+            g.codepoint = (uint32_t)encoding;
+            g.advance = (int16_t)advance;
+            g.first_row = (uint32_t)font.rows.size();
+            if (first <= last) {
+                g.top = (int16_t)(first - (bbx_h + bbx_yo));
+                g.row_count = (uint16_t)(last - first + 1);
+                font.rows.insert(font.rows.end(), bitmap.begin() + first, bitmap.begin() + last + 1);
+            }
+            font.glyphs.push_back(g);
+            in_glyph = in_bitmap = false;
+        } else if (in_bitmap) {
+            size_t digits = strspn(line, "0123456789abcdefABCDEF");
+            if (digits == 0 || digits > 8) continue;
+            uint32_t bits = (uint32_t)strtoul(line, nullptr, 16) << (32 - 4 * digits);
+            if (advance < 32) bits &= ~(0xFFFFFFFFu >> advance);
+            bitmap.push_back(bits);
+        }
+    }
+    fclose(f);
+
+    std::sort(font.glyphs.begin(), font.glyphs.end(),
+              [](const GlyphBitmap& a, const GlyphBitmap& b) { return a.codepoint < b.codepoint; });
+    return font.height > 0;
+}
+
+// Appends raw bytes, keeping every block 4-byte aligned.
+uint32_t Append(std::vector<uint8_t>& out, const void* data, size_t size) {
+    uint32_t offset = (uint32_t)out.size();
+    const uint8_t* bytes = (const uint8_t*)data;
+    out.insert(out.end(), bytes, bytes + size);
+    while (out.size() % 4) out.push_back(0);
+    return offset;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " OUT.pack [FONT.bdf...] [ICON.png...]\n";
+        return 1;
+    }
+
+    std::vector<uint8_t> out(sizeof(PackHeader), 0);
+    std::vector<PackIcon> icon_table;
+    std::vector<PackFont> font_table;
+    IconAtlas atlas;  // scratch slot used to decode each icon and find its spans
+
+    for (int i = 2; i < argc; ++i) {
+        std::string path = argv[i];
+        if (EndsWith(path, ".bdf")) {
+            FontData font;
+            font.name = BaseName(path);
+            if (font.name.size() >= sizeof(PackFont().name) || !ReadBDF(path, font)) {
+                std::cerr << "Couldn't read font " << path << std::endl;
+                return 1;
+            }
+
+            PackFont entry = {};
+            strncpy(entry.name, font.name.c_str(), sizeof(entry.name) - 1);
+            entry.height = font.height;
+            entry.baseline = font.baseline;
+            entry.glyphs = Append(out, font.glyphs.data(), font.glyphs.size() * sizeof(GlyphBitmap));
+            entry.glyph_count = (uint32_t)font.glyphs.size();
+            entry.rows = Append(out, font.rows.data(), font.rows.size() * sizeof(uint32_t));
+            entry.row_count = (uint32_t)font.rows.size();
+            font_table.push_back(entry);
+        } else if (EndsWith(path, ".png")) {
+            std::string name = BaseName(path);
+            name = name.substr(0, name.size() - 4);
+            if (name.size() >= sizeof(PackIcon().name) ||
+                !LoadIconFromPNG(path, atlas, IconId::Sun)) {
+                std::cerr << "Couldn't read icon " << path << std::endl;
+                return 1;
+            }
+            IconView view = atlas.Get(IconId::Sun);
+
+            PackIcon entry = {};
+            strncpy(entry.name, name.c_str(), sizeof(entry.name) - 1);
+            entry.width = (uint16_t)view.width;
+            entry.height = (uint16_t)view.height;
+            entry.pixels = Append(out, view.pixels, (size_t)view.width * view.height * sizeof(Pixel));
+            entry.spans = Append(out, view.spans, view.span_count * sizeof(IconSpan));
+            entry.span_count = (uint32_t)view.span_count;
+            icon_table.push_back(entry);
+        } else {
+            std::cerr << "Don't know what to do with " << path << std::endl;
+            return 1;
+        }
+    }
+
+    PackHeader header = {};
+    memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+    header.version = PACK_VERSION;
+    header.byte_order = PACK_BYTE_ORDER;
+    header.icon_count = (uint32_t)icon_table.size();
+    header.icon_table = Append(out, icon_table.data(), icon_table.size() * sizeof(PackIcon));
+    header.font_count = (uint32_t)font_table.size();
+    header.font_table = Append(out, font_table.data(), font_table.size() * sizeof(PackFont));
+    memcpy(out.data(), &header, sizeof(header));
+
+    // Write next to the target and rename, so a running clock never maps a
+    // half-written pack.
+    std::string tmp = std::string(argv[1]) + ".tmp";
+    {
+        std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+        file.write((const char*)out.data(), out.size());
+        if (!file.flush()) {
+            std::cerr << "Couldn't write " << tmp << std::endl;
+            return 1;
+        }
+    }
+    if (rename(tmp.c_str(), argv[1]) != 0) {
+        std::cerr << "Couldn't replace " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::cout << argv[1] << ": " << icon_table.size() << " icons, " << font_table.size()
+              << " fonts, " << out.size() << " bytes" << std::endl;
+    return 0;
+}
@@ -0,0 +1,235 @@
+// Stands in for both weather APIs on localhost, so the fetch path can be
+// tried against failures without a network.
+//
+//   weather_stub [--port=8080] [--owm=MODES] [--meteo=MODES]
+//                [--owm-file=PATH] [--meteo-file=PATH]
+//   clock --headless --weather-server=http://127.0.0.1:8080
+//
+// MODES is a comma separated list used in turn, one entry per request to
+// that provider, e.g. --meteo=error,error,ok fails twice, then answers
+// once, and starts over. Entries:
+//
+//   ok        200 with the file (304 if the clock sends back its ETag)
+//   error     500
+//   slow:N    answer after N seconds
+//   hang      never answer; the clock's transfer timeout has to fire
+//   garbage   200 with a body that is not JSON
+//   drop      close the connection without answering
+//
+// Every request is logged with the answer it got. Run "make stub".
+
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Provider {
+    const char* name;
+    const char* path;             // request paths starting with this
+    std::string file;
+    std::vector<std::string> modes;
+    std::atomic<unsigned> requests{0};
+};
+
+std::mutex log_mutex;
+
+std::vector<std::string> Split(const std::string& list) {
+    std::vector<std::string> out;
+    std::stringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (!item.empty()) out.push_back(item);
+    }
+    return out;
+}
+
+bool ValidMode(const std::string& mode) {
+    if (mode.compare(0, 5, "slow:") == 0) return atoi(mode.c_str() + 5) > 0;
+    return mode == "ok" || mode == "error" || mode == "hang" || mode == "garbage" ||
+           mode == "drop";
+}
+
+bool ReadFile(const std::string& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    std::stringstream ss;
+    ss << in.rdbuf();
+    out = ss.str();
+    return true;
+}
+
+void SendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return;
+        sent += n;
+    }
+}
+
+void Respond(int fd, int status, const char* reason, const std::string& body,
+             const std::string& etag) {
+    std::ostringstream out;
+    out << "HTTP/1.1 " << status << " " << reason << "\r\n"
+        << "Content-Type: application/json\r\n"
+        << "Content-Length: " << body.size() << "\r\n";
+    if (!etag.empty()) out << "ETag: " << etag << "\r\n";
+    out << "Connection: close\r\n\r\n" << body;
+    SendAll(fd, out.str());
+}
+
+// Reads the request head; the clock only ever sends GETs without a body.
+std::string ReadHead(int fd) {
+    std::string head;
+    char buf[1024];
+    while (head.find("\r\n\r\n") == std::string::npos && head.size() < 16384) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) break;
+        head.append(buf, n);
+    }
+    return head;
+}
+
+std::string Header(const std::string& head, const char* name) {
+    std::string lower = head;
+    for (char& c : lower) c = tolower((unsigned char)c);
+    std::string key = std::string("\r\n") + name + ":";
+    size_t at = lower.find(key);
+    if (at == std::string::npos) return "";
+    size_t begin = head.find_first_not_of(" \t", at + key.size());
+    size_t end = head.find("\r\n", begin);
+    return head.substr(begin, end - begin);
+}
+
+void Serve(int fd, Provider* providers, int count) {
+    std::string head = ReadHead(fd);
+    std::string line = head.substr(0, head.find("\r\n"));
+    size_t sp = line.find(' ');
+    std::string path = sp == std::string::npos ? "" : line.substr(sp + 1, line.find(' ', sp + 1) - sp - 1);
+
+    Provider* provider = nullptr;
+    for (int i = 0; i < count; ++i) {
+        if (path.compare(0, strlen(providers[i].path), providers[i].path) == 0) provider = &providers[i];
+    }
+
+    std::string outcome;
+    if (!provider) {
+        Respond(fd, 404, "Not Found", "{}", "");
+        outcome = "404";
+    } else {
+        unsigned n = provider->requests++;
+        std::string mode = provider->modes[n % provider->modes.size()];
+        std::string etag = "\"stub-" + std::to_string(std::hash<std::string>()(provider->file)) + "\"";
+        {
+            std::lock_guard<std::mutex> lock(log_mutex);
+            std::cerr << provider->name << " #" << n << ": " << mode << std::endl;
+        }
+        if (mode.compare(0, 5, "slow:") == 0) {
+            std::this_thread::sleep_for(std::chrono::seconds(atoi(mode.c_str() + 5)));
+            mode = "ok";
+        }
+        if (mode == "ok") {
+            if (Header(head, "if-none-match") == etag) {
+                Respond(fd, 304, "Not Modified", "", etag);
+                outcome = "304";
+            } else {
+                Respond(fd, 200, "OK", provider->file, etag);
+                outcome = "200";
+            }
+        } else if (mode == "error") {
+            Respond(fd, 500, "Internal Server Error", "{\"error\":true}", "");
+            outcome = "500";
+        } else if (mode == "garbage") {
+            Respond(fd, 200, "OK", "<html>upstream timeout</html>", "");
+            outcome = "200 garbage";
+        } else if (mode == "hang") {
+            // Hold the connection until the client gives up
+            char buf[256];
+            while (recv(fd, buf, sizeof(buf), 0) > 0) {}
+            outcome = "hung up on";
+        } else {
+            outcome = "dropped";
+        }
+    }
+    close(fd);
+
+    std::lock_guard<std::mutex> lock(log_mutex);
+    std::cerr << "  " << line << " -> " << outcome << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int port = 8080;
+    std::string owm_file = "bench/data/owm_current.json";
+    std::string meteo_file = "bench/data/meteo_forecast.json";
+    std::string owm_modes = "ok", meteo_modes = "ok";
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (strncmp(arg, "--port=", 7) == 0) port = atoi(arg + 7);
+        else if (strncmp(arg, "--owm=", 6) == 0) owm_modes = arg + 6;
+        else if (strncmp(arg, "--meteo=", 8) == 0) meteo_modes = arg + 8;
+        else if (strncmp(arg, "--owm-file=", 11) == 0) owm_file = arg + 11;
+        else if (strncmp(arg, "--meteo-file=", 13) == 0) meteo_file = arg + 13;
+        else {
+            std::cerr << "usage: " << argv[0] << " [--port=N] [--owm=MODES] [--meteo=MODES]"
+                      << " [--owm-file=PATH] [--meteo-file=PATH]" << std::endl;
+            return 1;
+        }
+    }
+
+    Provider providers[2];
+    providers[0].name = "openweather";
+    providers[0].path = "/data/2.5/weather";
+    providers[0].modes = Split(owm_modes);
+    providers[1].name = "open-meteo";
+    providers[1].path = "/v1/forecast";
+    providers[1].modes = Split(meteo_modes);
+    if (!ReadFile(owm_file, providers[0].file) || !ReadFile(meteo_file, providers[1].file)) {
+        std::cerr << "Couldn't read " << owm_file << " or " << meteo_file << std::endl;
+        return 1;
+    }
+    for (const Provider& p : providers) {
+        bool ok = !p.modes.empty();
+        for (const std::string& mode : p.modes) ok &= ValidMode(mode);
+        if (!ok) {
+            std::cerr << "Bad modes for " << p.name << std::endl;
+            return 1;
+        }
+    }
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 16) != 0) {
+        perror("weather_stub");
+        return 1;
+    }
+    std::cerr << "Serving on http://127.0.0.1:" << port << std::endl;
+
+    // One thread per connection, so a hanging answer never holds up others
+    signal(SIGPIPE, SIG_IGN);
+    for (;;) {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) continue;
+        std::thread(Serve, fd, providers, 2).detach();
+    }
+}
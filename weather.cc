@@ -0,0 +1,453 @@
+#include "weather.h"
+#include "json_extract.h"
+#include "metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+std::string OpenWeatherURL(const std::string& lat, const std::string& lon,
+                           const std::string& api_key, Units units,
+                           const std::string& server) {
+    std::ostringstream url;
+    url << server << "/data/2.5/weather?lat="
+        << lat << "&lon=" << lon
+        << "&appid=" << api_key
+        << "&units=" << (units == Units::Metric ? "metric" : "imperial");
+    return url.str();
+}
+
+std::string OpenMeteoURL(const std::string& lat, const std::string& lon, Units units,
+                         const std::string& server) {
+    return server + "/v1/forecast"
+           "?latitude=" + lat +
+           "&longitude=" + lon +
+           "&current_weather=true"
+           "&hourly=temperature_2m,precipitation_probability,weathercode"
+           "&forecast_days=2"
+           "&timeformat=unixtime"
+           "&temperature_unit=" + (units == Units::Metric ? "celsius" : "fahrenheit");
+}
+
+WeatherData ParseWeather(const std::string& jsonStr, Units units) {
+    if (jsonStr.empty()) return {"No data", ""};
+    const WeatherData parse_error = {"Parse error", ""};
+
+    enum { COD, MESSAGE, WEATHER0, DESCRIPTION, CONDITION, MAIN, TEMP,
+           SUNRISE, SUNSET, FIELD_COUNT };
+    JsonField f[FIELD_COUNT] = {
+        JsonField("cod"), JsonField("message"),
+        JsonField("weather.0"), JsonField("weather.0.description"), JsonField("weather.0.id"),
+        JsonField("main"), JsonField("main.temp"),
+        JsonField("sys.sunrise"), JsonField("sys.sunset"),
+    };
+    if (!ExtractJsonFields(jsonStr, f, FIELD_COUNT)) return parse_error;
+
+    // "cod" is a number on success but a string in some error replies.
+    int cod_val;
+    if (f[COD].type == JsonType::Number) {
+        cod_val = (int)f[COD].number;
+    } else if (f[COD].type == JsonType::String) {
+        try {
+            cod_val = std::stoi(f[COD].str());
+        } catch (...) {
+            return parse_error;
+        }
+    } else {
+        return parse_error;
+    }
+    if (cod_val != 200) {
+        if (f[MESSAGE].type == JsonType::Missing) return {"API error", ""};
+        if (f[MESSAGE].type != JsonType::String) return parse_error;
+        return {f[MESSAGE].str(), ""};
+    }
+
+    if (f[WEATHER0].type != JsonType::Object || f[MAIN].type != JsonType::Object) {
+        return parse_error;
+    }
+
+    WeatherData data;
+    if (f[DESCRIPTION].type == JsonType::Missing) data.description = "Unknown";
+    else if (f[DESCRIPTION].type == JsonType::String) data.description = f[DESCRIPTION].str();
+    else return parse_error;
+
+    double temp_val = 0.0;
+    if (f[TEMP].type == JsonType::Number) temp_val = f[TEMP].number;
+    else if (f[TEMP].type != JsonType::Missing) return parse_error;
+    const char* unit_label = (units == Units::Metric) ? "°C" : "°F";
+
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(1) << temp_val << unit_label;
+    data.temp = oss.str();
+
+    // Only used to pick the icon and day or night; without them the clock
+    // falls back to Open-Meteo or the time of day.
+    if (f[CONDITION].type == JsonType::Number) data.condition = (int)f[CONDITION].number;
+    if (f[SUNRISE].type == JsonType::Number && f[SUNSET].type == JsonType::Number) {
+        data.sunrise = (time_t)f[SUNRISE].number;
+        data.sunset = (time_t)f[SUNSET].number;
+    }
+    return data;
+}
+
+OpenMeteoCurrent ParseOpenMeteo(const std::string& jsonStr, HourlyForecast* hourly, Units units) {
+    enum { TEMP, CODE, IS_DAY, HOUR_TIME, HOUR_TEMP, HOUR_PRECIP, HOUR_CODE, FIELD_COUNT };
+    JsonField f[FIELD_COUNT] = {
+        JsonField("current_weather.temperature"),
+        JsonField("current_weather.weathercode"),
+        JsonField("current_weather.is_day"),
+        JsonField("hourly.time"),
+        JsonField("hourly.temperature_2m"),
+        JsonField("hourly.precipitation_probability"),
+        JsonField("hourly.weathercode"),
+    };
+    // The hourly arrays are copied straight out of the text
+    const int N = HourlyForecast::CAPACITY;
+    double columns[FIELD_COUNT - HOUR_TIME][N];
+    auto column = [&](int field) { return columns[field - HOUR_TIME]; };
+    const int fields = hourly ? FIELD_COUNT : HOUR_TIME;
+    for (int i = HOUR_TIME; i < fields; ++i) {
+        f[i].elements = column(i);
+        f[i].capacity = N;
+    }
+    if (!ExtractJsonFields(jsonStr, f, fields) || f[TEMP].type != JsonType::Number) {
+        throw std::runtime_error("Open-Meteo: no current temperature");
+    }
+    OpenMeteoCurrent current;
+    current.temp = (float)f[TEMP].number;
+    if (f[CODE].type == JsonType::Number) current.wmo_code = (int)f[CODE].number;
+    if (f[IS_DAY].type == JsonType::Number) current.is_day = f[IS_DAY].number != 0;
+
+    if (hourly) {
+        // Hours need a time and a temperature; the rest may be missing
+        hourly->Clear();
+        size_t count = std::min(f[HOUR_TIME].element_count, f[HOUR_TEMP].element_count);
+        count = std::min(count, (size_t)N);
+        auto at = [&](int field, size_t i) {
+            const double v = i < f[field].element_count ? column(field)[i] : NAN;
+            return std::isnan(v) ? HourlyForecast::UNKNOWN : (int)std::lround(v);
+        };
+        for (size_t i = 0; i < count; ++i) {
+            double start = column(HOUR_TIME)[i], temp = column(HOUR_TEMP)[i];
+            if (std::isnan(start) || std::isnan(temp)) continue;
+            float temp_f = units == Units::Metric ? CelsiusToFahrenheit((float)temp) : (float)temp;
+            hourly->Add((time_t)start, temp_f, at(HOUR_PRECIP, i), at(HOUR_CODE, i));
+        }
+    }
+    return current;
+}
+
+float ParseOpenMeteoTemp(const std::string& jsonStr) {
+    return ParseOpenMeteo(jsonStr).temp;
+}
+
+
+// --- Background weather fetch ---
+namespace {
+
+void LogFetch(const char* name, const HttpResponse& r) {
+    if (!r.ok) {
+        std::cerr << "curl error: " << name << ": " << r.error << std::endl;
+        return;
+    }
+    const HttpTiming& t = r.timing;
+    std::cerr << std::fixed << std::setprecision(1)
+              << name << ": HTTP " << r.status
+              << " dns=" << t.dns * 1e3 << "ms"
+              << " connect=" << t.connect * 1e3 << "ms"
+              << " tls=" << t.tls * 1e3 << "ms"
+              << " first_byte=" << t.first_byte * 1e3 << "ms"
+              << " total=" << t.total * 1e3 << "ms" << std::endl;
+}
+
+// Cache keys; the metrics label the providers the same way
+const char* const OWM_KEY = PROVIDER_NAMES[PROVIDER_OPENWEATHER];
+const char* const METEO_KEY = PROVIDER_NAMES[PROVIDER_OPEN_METEO];
+
+// Backoff jitter seed for a provider: from `seed` if set, else random.
+uint32_t Seed(uint32_t seed, int provider) {
+    return seed ? seed + provider : std::random_device()();
+}
+
+}  // namespace
+
+bool operator==(const WeatherConfig& a, const WeatherConfig& b) {
+    return a.lat == b.lat && a.lon == b.lon && a.api_key == b.api_key && a.units == b.units &&
+           std::equal(a.enabled, a.enabled + PROVIDER_COUNT, b.enabled) &&
+           a.fresh_seconds == b.fresh_seconds && a.stale_seconds == b.stale_seconds &&
+           a.server == b.server;
+}
+
+WeatherWorker::WeatherWorker(const WeatherConfig& config, const std::string& cache_path,
+                             HttpSource* http, uint32_t seed)
+    : own_http_(http ? nullptr : new HttpClient),
+      http_(http ? http : own_http_.get()),
+      cache_(cache_path),
+      health_{ProviderHealth(Seed(seed, 0)), ProviderHealth(Seed(seed, 1))} {
+    Apply(config);
+}
+
+WeatherWorker::~WeatherWorker() {
+    Stop();
+    delete pending_.exchange(nullptr);
+}
+
+void WeatherWorker::Start() {
+    thread_ = std::thread(&WeatherWorker::Run, this);
+}
+
+void WeatherWorker::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    if (thread_.joinable()) thread_.join();
+}
+
+void WeatherWorker::RequestRefresh() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        refresh_ = true;
+    }
+    wake_.notify_one();
+}
+
+void WeatherWorker::Configure(const WeatherConfig& config) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        new_config_.reset(new WeatherConfig(config));
+    }
+    wake_.notify_one();
+}
+
+std::unique_ptr<WeatherData> WeatherWorker::TakeSnapshot() {
+    return std::unique_ptr<WeatherData>(pending_.exchange(nullptr));
+}
+
+void WeatherWorker::Run() {
+    WarmStart(time(nullptr));
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+        bool force = refresh_;
+        refresh_ = false;
+        std::unique_ptr<WeatherConfig> config = std::move(new_config_);
+        lock.unlock();
+
+        if (config) Apply(*config);
+        int wait_s = Cycle(force, time(nullptr));
+
+        lock.lock();
+        wake_.wait_for(lock, std::chrono::seconds(wait_s),
+                       [this] { return stop_ || refresh_ || new_config_; });
+    }
+}
+
+void WeatherWorker::RunUntil(time_t now) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    bool force = refresh_;
+    refresh_ = false;
+    std::unique_ptr<WeatherConfig> config = std::move(new_config_);
+    lock.unlock();
+
+    if (next_fetch_ < 0) {
+        WarmStart(now);
+        next_fetch_ = now;
+    }
+    if (config) {
+        Apply(*config);
+        next_fetch_ = now;
+    }
+    if (force || now >= next_fetch_) next_fetch_ = now + Cycle(force, now);
+}
+
+// Renders from the cache before touching the network.
+void WeatherWorker::WarmStart(time_t now) {
+    if (!cache_.Load()) return;
+    NoteCacheTimes();
+    Publish(Compose(now));
+}
+
+int WeatherWorker::Cycle(bool force, time_t now) {
+    Fetch(force, now);
+    Publish(Compose(now));
+    return SecondsUntilNextFetch(now);
+}
+
+// New URLs for the location and units, and a clean slate for providers
+// that may only have been failing because of the old settings. Cached
+// answers for other URLs are no longer found, so those get fetched.
+void WeatherWorker::Apply(const WeatherConfig& config) {
+    config_ = config;
+    const std::string& server = config.server;
+    owm_url_ = OpenWeatherURL(config.lat, config.lon, config.api_key, config.units,
+                              server.empty() ? OPENWEATHER_SERVER : server);
+    meteo_url_ = OpenMeteoURL(config.lat, config.lon, config.units,
+                              server.empty() ? OPEN_METEO_SERVER : server);
+    for (int p = 0; p < PROVIDER_COUNT; ++p) {
+        health_[p].Success();
+        clockMetrics.providers[p].breaker_open.store(0, std::memory_order_relaxed);
+    }
+    owm_error_body_.clear();
+    has_published_ = false;
+}
+
+// Revalidates every provider whose cached response is no longer fresh (all
+// of them when forced) with conditional requests issued together, leaving
+// out the ones still backing off. Each answer is folded in as it arrives
+// and a good one is published right away, so the screen never waits for
+// the slower provider.
+void WeatherWorker::Fetch(bool force, time_t now) {
+    const char* keys[] = {OWM_KEY, METEO_KEY};
+    const std::string* urls[] = {&owm_url_, &meteo_url_};
+
+    std::vector<HttpRequest> requests;
+    std::vector<int> which;
+    for (int i = 0; i < PROVIDER_COUNT; ++i) {
+        if (!config_.enabled[i]) continue;
+        const CachedResponse* entry = cache_.Find(keys[i], *urls[i]);
+        if (!force && CheckFreshness(entry, now, config_.fresh_seconds,
+                                     config_.stale_seconds) == Freshness::Fresh) continue;
+        if (!health_[i].Allow(now, force)) continue;
+        HttpRequest request{*urls[i], {}};
+        AddConditionalHeaders(entry, request);
+        requests.push_back(request);
+        which.push_back(i);
+    }
+    if (requests.empty()) return;
+
+    bool dirty = false;
+    http_->PerformAll(requests, [&](size_t n, const HttpResponse& r) {
+        int i = which[n];
+        LogFetch(keys[i], r);
+
+        // A 200 only counts if the clock can use what it says
+        bool answered = r.ok && (r.status == 200 || r.status == 304);
+        bool good = answered && (r.status == 304 || Usable(i, r.body));
+        ProviderMetrics& m = clockMetrics.providers[i];
+        if (!r.ok) m.transport_errors.Add();
+        else if (!answered) m.http_errors.Add();
+        else if (!good) m.invalid_responses.Add();
+        if (r.ok) m.fetch.Record((int64_t)(r.timing.total * 1e9));
+
+        if (i == PROVIDER_OPENWEATHER && r.ok && !answered) owm_error_body_ = r.body;
+        else if (i == PROVIDER_OPENWEATHER && good) owm_error_body_.clear();
+
+        UpdateHealth(i, good, now);
+        if (!good) return;
+        cache_.Update(keys[i], *urls[i], r, now);
+        dirty = true;
+        Publish(Compose(now));
+    });
+    if (dirty) cache_.Save();
+    NoteCacheTimes();
+}
+
+// Whether a 200 body parses into something worth showing.
+bool WeatherWorker::Usable(int provider, const std::string& body) const {
+    if (provider == PROVIDER_OPENWEATHER) return !ParseWeather(body, config_.units).temp.empty();
+    try {
+        ParseOpenMeteo(body);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+void WeatherWorker::UpdateHealth(int provider, bool good, time_t now) {
+    ProviderHealth& health = health_[provider];
+    ProviderHealth::State before = health.state();
+    if (good) health.Success();
+    else health.Failure(now);
+
+    ProviderHealth::State after = health.state();
+    clockMetrics.providers[provider].breaker_open.store(after != ProviderHealth::State::Closed,
+                                                        std::memory_order_relaxed);
+    if (!good) {
+        std::cerr << PROVIDER_NAMES[provider] << ": " << health.failures()
+                  << " failures in a row, next try in " << health.retry_at() - now << " s";
+        if (after != before) std::cerr << ", circuit " << StateName(after);
+        std::cerr << std::endl;
+    } else if (after != before) {
+        std::cerr << PROVIDER_NAMES[provider] << ": circuit " << StateName(after) << std::endl;
+    }
+}
+
+// Builds the snapshot to show from everything the cache may still serve.
+WeatherData WeatherWorker::Compose(time_t now) const {
+    const CachedResponse* owm = cache_.Find(OWM_KEY, owm_url_);
+    const CachedResponse* meteo = cache_.Find(METEO_KEY, meteo_url_);
+    bool owm_usable = config_.enabled[PROVIDER_OPENWEATHER] && owm &&
+                      CheckFreshness(owm, now, config_.fresh_seconds,
+                                     config_.stale_seconds) != Freshness::Expired;
+    bool meteo_usable = config_.enabled[PROVIDER_OPEN_METEO] && meteo &&
+                        CheckFreshness(meteo, now, config_.fresh_seconds,
+                                       config_.stale_seconds) != Freshness::Expired;
+
+    int64_t start = MonotonicNs();
+    WeatherData data = ParseWeather(owm_usable ? owm->body : owm_error_body_, config_.units);
+    clockMetrics.providers[PROVIDER_OPENWEATHER].parse.Record(MonotonicNs() - start);
+    // Until Open-Meteo has answered, or while it is failing, OpenWeather's
+    // temperature stands on its own
+    if (!meteo_usable) return data;
+    OpenMeteoCurrent current;
+    try {
+        start = MonotonicNs();
+        current = ParseOpenMeteo(meteo->body, &data.hourly, config_.units);
+        clockMetrics.providers[PROVIDER_OPEN_METEO].parse.Record(MonotonicNs() - start);
+    } catch (const std::exception& e) {
+        std::cerr << "Open-Meteo answer unreadable (" << e.what() << "), using OpenWeather's"
+                  << std::endl;
+        return data;
+    }
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(1) << current.temp
+        << (config_.units == Units::Metric ? "°C" : "°F");
+    data.temp = oss.str();
+    data.wmo_code = current.wmo_code;
+    data.is_day = current.is_day;
+    data.hourly.DropBefore(now);
+    return data;
+}
+
+// Hands a snapshot to the render loop, unless it shows the same thing as
+// the last one.
+void WeatherWorker::Publish(const WeatherData& data) {
+    if (has_published_ && data == published_) return;
+    published_ = data;
+    has_published_ = true;
+    // A snapshot the render loop never picked up is simply replaced.
+    delete pending_.exchange(new WeatherData(data));
+}
+
+// Tells the metrics how old each provider's cached response is.
+void WeatherWorker::NoteCacheTimes() const {
+    const CachedResponse* entries[] = {cache_.Find(OWM_KEY, owm_url_),
+                                       cache_.Find(METEO_KEY, meteo_url_)};
+    for (int p = 0; p < PROVIDER_COUNT; ++p) {
+        int64_t at = entries[p] ? (int64_t)entries[p]->fetched_at : 0;
+        clockMetrics.providers[p].confirmed_at.store(at, std::memory_order_relaxed);
+    }
+}
+
+// Until the first provider is due again: its cached response going stale,
+// or for a failing one its backoff running out.
+int WeatherWorker::SecondsUntilNextFetch(time_t now) const {
+    const CachedResponse* entries[] = {cache_.Find(OWM_KEY, owm_url_),
+                                       cache_.Find(METEO_KEY, meteo_url_)};
+    int wait_s = config_.fresh_seconds;
+    for (int p = 0; p < PROVIDER_COUNT; ++p) {
+        int left;
+        if (!config_.enabled[p]) continue;
+        if (health_[p].failures() > 0) left = (int)(health_[p].retry_at() - now);
+        else if (!entries[p]) left = 0;
+        else left = config_.fresh_seconds - (int)difftime(now, entries[p]->fetched_at);
+        wait_s = std::min(wait_s, left);
+    }
+    return std::max(wait_s, 1);
+}
@@ -0,0 +1,160 @@
+#ifndef WEATHER_H
+#define WEATHER_H
+
+#include "fixed_string.h"
+#include "forecast.h"
+#include "http_client.h"
+#include "metrics.h"
+#include "provider_health.h"
+#include "weather_cache.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <time.h>
+
+enum class Units { Metric, Imperial };
+
+// The colours and the forecast strip work in °F whatever the units shown.
+inline float CelsiusToFahrenheit(float c) { return c * 9.0f / 5.0f + 32.0f; }
+
+const char* const OPENWEATHER_SERVER = "http://api.openweathermap.org";
+const char* const OPEN_METEO_SERVER = "https://api.open-meteo.com";
+
+// Text is kept inline, so the render loop can copy and compare snapshots
+// without touching the heap; an overlong description is cut short.
+struct WeatherData {
+    FixedString<64> description;
+    FixedString<16> temp;  // e.g. "58.3°F"
+    int condition = 0;     // OpenWeather condition id (weather[0].id), 0 if unknown
+    int wmo_code = -1;     // Open-Meteo WMO weather code, -1 if unknown
+    time_t sunrise = 0;    // from OpenWeather, 0 if unknown
+    time_t sunset = 0;
+    int is_day = -1;       // Open-Meteo's is_day (0 or 1), -1 if unknown
+    HourlyForecast hourly{}; // from Open-Meteo, from the current hour on
+};
+
+inline bool operator==(const WeatherData& a, const WeatherData& b) {
+    return a.description == b.description && a.temp == b.temp &&
+           a.condition == b.condition && a.wmo_code == b.wmo_code &&
+           a.sunrise == b.sunrise && a.sunset == b.sunset && a.is_day == b.is_day &&
+           a.hourly == b.hourly;
+}
+
+// The parts of Open-Meteo's current_weather the clock uses.
+struct OpenMeteoCurrent {
+    float temp = 0;        // in the units asked for in the URL
+    int wmo_code = -1;
+    int is_day = -1;
+};
+
+std::string OpenWeatherURL(const std::string& lat, const std::string& lon,
+                           const std::string& api_key, Units units,
+                           const std::string& server = OPENWEATHER_SERVER);
+std::string OpenMeteoURL(const std::string& lat, const std::string& lon, Units units,
+                         const std::string& server = OPEN_METEO_SERVER);
+
+WeatherData ParseWeather(const std::string& jsonStr, Units units);
+
+// Current weather from an Open-Meteo response, and with `hourly` set the
+// hourly forecast in the same pass, its temperatures turned from `units`
+// into °F. Throws on a missing or malformed current temperature; the other
+// fields are optional.
+OpenMeteoCurrent ParseOpenMeteo(const std::string& jsonStr, HourlyForecast* hourly = nullptr,
+                                Units units = Units::Imperial);
+
+// Current temperature (°F) from an Open-Meteo response. Throws on a
+// missing or malformed payload.
+float ParseOpenMeteoTemp(const std::string& jsonStr);
+
+
+// What the worker fetches and how often. The defaults are the clock's own.
+struct WeatherConfig {
+    std::string lat = "34.078";
+    std::string lon = "-118.260";
+    std::string api_key = "YOUR API KEY";
+    Units units = Units::Imperial;
+    bool enabled[PROVIDER_COUNT] = {true, true};
+    int fresh_seconds = CACHE_FRESH_SECONDS;   // see weather_cache.h
+    int stale_seconds = CACHE_STALE_SECONDS;
+    std::string server;   // both providers' host instead of theirs, for testing
+};
+
+bool operator==(const WeatherConfig& a, const WeatherConfig& b);
+inline bool operator!=(const WeatherConfig& a, const WeatherConfig& b) { return !(a == b); }
+
+// --- Background weather fetch ---
+// All network I/O happens on this thread so a slow endpoint can never stall
+// the clock. Both providers are asked at once and whichever answers first
+// is shown first; a failing one backs off behind its own circuit breaker
+// while the cache keeps serving its last good answer. Finished snapshots
+// are handed over through a single atomic pointer: the worker exchanges a
+// fresh snapshot in, the render loop exchanges it out for nullptr. Whoever
+// takes a pointer out of the slot owns it, so neither side ever waits on
+// the other.
+class WeatherWorker {
+public:
+    // Responses come from `http` if given, else from the network. `seed`
+    // fixes the backoff jitter (0 picks a random one).
+    WeatherWorker(const WeatherConfig& config, const std::string& cache_path,
+                  HttpSource* http = nullptr, uint32_t seed = 0);
+    ~WeatherWorker();
+
+    void Start();
+    void Stop();
+
+    // Instead of Start(): does on the calling thread whatever the worker
+    // thread would have done by `now`, so a replay on a simulated clock
+    // fetches at the same moments a live run would.
+    void RunUntil(time_t now);
+
+    // Ask for a revalidation now instead of waiting out the fresh TTL.
+    void RequestRefresh();
+
+    // Switches to `config` without blocking: the worker picks it up before
+    // its next fetch, gives the providers a clean slate and asks whatever
+    // the cache does not already hold for the new location and units.
+    void Configure(const WeatherConfig& config);
+
+    // Returns the newest snapshot published since the last call, or nullptr.
+    std::unique_ptr<WeatherData> TakeSnapshot();
+
+private:
+    void Run();
+    void WarmStart(time_t now);
+    // One fetch and publish; returns the seconds until the next one is due.
+    int Cycle(bool force, time_t now);
+    void Apply(const WeatherConfig& config);
+    void Fetch(bool force, time_t now);
+    bool Usable(int provider, const std::string& body) const;
+    void UpdateHealth(int provider, bool good, time_t now);
+    WeatherData Compose(time_t now) const;
+    void Publish(const WeatherData& data);
+    void NoteCacheTimes() const;
+    int SecondsUntilNextFetch(time_t now) const;
+
+    // Only touched from the worker thread.
+    WeatherConfig config_;
+    std::string owm_url_, meteo_url_;
+    std::unique_ptr<HttpClient> own_http_;
+    HttpSource* http_;
+    ResponseCache cache_;
+    std::string owm_error_body_;   // last uncacheable OpenWeather reply
+    ProviderHealth health_[PROVIDER_COUNT];
+    WeatherData published_;
+    bool has_published_ = false;
+    time_t next_fetch_ = -1;   // RunUntil() only; -1 before the first call
+
+    std::atomic<WeatherData*> pending_{nullptr};
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+    bool refresh_ = false;
+    std::unique_ptr<WeatherConfig> new_config_;   // from Configure(), not yet applied
+};
+
+#endif
@@ -0,0 +1,137 @@
+#include "weather_cache.h"
+
+#include <nlohmann/json.hpp>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+// The OpenWeather URL carries the API key, so only a hash of it is stored.
+std::string HashURL(const std::string& url) {
+    uint64_t h = 1469598103934665603ULL;  // FNV-1a
+    for (unsigned char c : url) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)h);
+    return buf;
+}
+
+}  // namespace
+
+bool ResponseCache::Load() {
+    if (path_.empty()) return false;
+    std::ifstream in(path_);
+    if (!in) return false;
+
+    try {
+        nlohmann::json j = nlohmann::json::parse(in);
+        entries_.clear();
+        for (auto it = j.begin(); it != j.end(); ++it) {
+            CachedResponse entry;
+            entry.url_hash = it.value().value("url_hash", "");
+            entry.body = it.value().value("body", "");
+            entry.fetched_at = it.value().value("fetched_at", (time_t)0);
+            entry.etag = it.value().value("etag", "");
+            entry.last_modified = it.value().value("last_modified", "");
+            entries_[it.key()] = entry;
+        }
+    } catch (...) {
+        std::cerr << "Ignoring unreadable weather cache: " << path_ << std::endl;
+        entries_.clear();
+        return false;
+    }
+    return true;
+}
+
+bool ResponseCache::Save() const {
+    if (path_.empty()) return true;
+    nlohmann::json j = nlohmann::json::object();
+    for (const auto& kv : entries_) {
+        j[kv.first] = {
+            {"url_hash", kv.second.url_hash},
+            {"body", kv.second.body},
+            {"fetched_at", kv.second.fetched_at},
+            {"etag", kv.second.etag},
+            {"last_modified", kv.second.last_modified},
+        };
+    }
+
+    std::string tmp = path_ + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << j.dump();
+        if (!out.flush()) {
+            std::cerr << "Failed to write weather cache: " << tmp << std::endl;
+            return false;
+        }
+    }
+    if (rename(tmp.c_str(), path_.c_str()) != 0) {
+        std::cerr << "Failed to replace weather cache: " << path_ << std::endl;
+        return false;
+    }
+    return true;
+}
+
+const CachedResponse* ResponseCache::Find(const std::string& key, const std::string& url) const {
+    auto it = entries_.find(key);
+    if (it == entries_.end() || it->second.url_hash != HashURL(url)) return nullptr;
+    return &it->second;
+}
+
+bool ResponseCache::Update(const std::string& key, const std::string& url,
+                           const HttpResponse& response, time_t now) {
+    if (!response.ok) return false;
+
+    std::string url_hash = HashURL(url);
+    auto it = entries_.find(key);
+    if (response.status == 304) {
+        // Only confirms a body already kept for this URL
+        if (it != entries_.end() && it->second.url_hash == url_hash) it->second.fetched_at = now;
+        return false;
+    }
+    if (response.status != 200) return false;  // never cache error payloads
+
+    CachedResponse& entry = it != entries_.end() ? it->second : entries_[key];
+    bool changed = entry.url_hash != url_hash || entry.body != response.body;
+    entry.url_hash = url_hash;
+    entry.body = response.body;
+    entry.fetched_at = now;
+    entry.etag = response.etag;
+    entry.last_modified = response.last_modified;
+    return changed;
+}
+
+Freshness CheckFreshness(const CachedResponse* entry, time_t now,
+                         int fresh_seconds, int stale_seconds) {
+    if (!entry) return Freshness::Missing;
+    double age = difftime(now, entry->fetched_at);
+    if (age < fresh_seconds) return Freshness::Fresh;
+    if (age < stale_seconds) return Freshness::Stale;
+    return Freshness::Expired;
+}
+
+void AddConditionalHeaders(const CachedResponse* entry, HttpRequest& request) {
+    if (!entry) return;
+    if (!entry->etag.empty()) {
+        request.headers.push_back("If-None-Match: " + entry->etag);
+    }
+    if (!entry->last_modified.empty()) {
+        request.headers.push_back("If-Modified-Since: " + entry->last_modified);
+    }
+}
+
+std::string DefaultCachePath() {
+    const char* env = getenv("LED_CLOCK_STATE_DIR");
+    std::string dir = (env && *env) ? env : "state";
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "Couldn't create state dir " << dir << std::endl;
+    }
+    return dir + "/weather_cache.json";
+}
@@ -0,0 +1,65 @@
+#ifndef WEATHER_CACHE_H
+#define WEATHER_CACHE_H
+
+#include "http_client.h"
+
+#include <map>
+#include <string>
+#include <time.h>
+
+// TTL rules for cached provider responses. Within the fresh window a
+// response is used as is and nothing is fetched. After that it is still
+// shown while a conditional request revalidates it in the background, until
+// it is too old to be worth showing at all.
+const int CACHE_FRESH_SECONDS = 900;
+const int CACHE_STALE_SECONDS = 6 * 3600;
+
+enum class Freshness { Missing, Fresh, Stale, Expired };
+
+struct CachedResponse {
+    std::string url_hash;     // identifies the request the body answers
+    std::string body;
+    time_t fetched_at = 0;    // last time the server confirmed this body
+    std::string etag;
+    std::string last_modified;
+};
+
+// Last good payload per provider, persisted as a small JSON file so a
+// restart can render immediately instead of waiting on the network.
+class ResponseCache {
+public:
+    // An empty path keeps the cache in memory only, e.g. for replays.
+    explicit ResponseCache(const std::string& path) : path_(path) {}
+
+    bool Load();
+    // Writes to a temporary file and renames it over the old one, so a
+    // power cut never leaves a truncated cache behind.
+    bool Save() const;
+
+    // Entry for `key` if it answers `url`, otherwise nullptr.
+    const CachedResponse* Find(const std::string& key, const std::string& url) const;
+
+    // Folds a finished request into the cache. A 200 replaces the entry, a
+    // 304 just renews it. Returns true if the cached body changed.
+    bool Update(const std::string& key, const std::string& url,
+                const HttpResponse& response, time_t now);
+
+private:
+    std::string path_;
+    std::map<std::string, CachedResponse> entries_;
+};
+
+// `fresh_seconds` and `stale_seconds` replace the defaults above, e.g.
+// from the config file.
+Freshness CheckFreshness(const CachedResponse* entry, time_t now,
+                         int fresh_seconds = CACHE_FRESH_SECONDS,
+                         int stale_seconds = CACHE_STALE_SECONDS);
+
+// Adds If-None-Match / If-Modified-Since for the cached validators.
+void AddConditionalHeaders(const CachedResponse* entry, HttpRequest& request);
+
+// $LED_CLOCK_STATE_DIR/weather_cache.json, or state/weather_cache.json
+// next to the fonts and icons. Creates the directory if needed.
+std::string DefaultCachePath();
+
+#endif
@@ -0,0 +1,92 @@
+#include "work_pool.h"
+
+#include <algorithm>
+
+WorkPool::WorkPool(int threads) {
+    threads = std::max(threads, 1);
+    for (int i = 0; i < threads; ++i) queues_.emplace_back(new Queue);
+    for (int i = 1; i < threads; ++i) workers_.emplace_back(&WorkPool::WorkerLoop, this, i);
+}
+
+WorkPool::~WorkPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    start_.notify_all();
+    for (std::thread& t : workers_) t.join();
+}
+
+void WorkPool::RunItems(int count, ItemFn fn, void* arg) {
+    if (count <= 0) return;
+    if (workers_.empty()) {
+        for (int i = 0; i < count; ++i) fn(arg, i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fn_ = fn;
+        arg_ = arg;
+        remaining_ = count;
+        const int n = threads();
+        for (int q = 0; q < n; ++q) {
+            std::lock_guard<std::mutex> queue_lock(queues_[q]->mutex);
+            queues_[q]->items.clear();
+            queues_[q]->next = 0;
+            for (int i = q; i < count; i += n) queues_[q]->items.push_back(i);
+        }
+        ++generation_;
+    }
+    start_.notify_all();
+
+    Work(0);
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return remaining_ == 0; });
+}
+
+bool WorkPool::Take(int self, int& item) {
+    const int n = threads();
+    {
+        Queue& own = *queues_[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.next < own.items.size()) {
+            item = own.items[own.next++];
+            return true;
+        }
+    }
+    for (int k = 1; k < n; ++k) {
+        Queue& other = *queues_[(self + k) % n];
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if (other.next < other.items.size()) {
+            item = other.items.back();
+            other.items.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkPool::Work(int self) {
+    int item;
+    while (Take(self, item)) {
+        fn_(arg_, item);
+        if (--remaining_ == 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_.notify_all();
+        }
+    }
+}
+
+void WorkPool::WorkerLoop(int self) {
+    unsigned seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_) return;
+            seen = generation_;
+        }
+        Work(self);
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A few threads that run the items of one job at a time. The items are
+// dealt out round-robin, each thread works through its own share front to
+// back, and a thread that runs out steals from the back of another's, so
+// uneven items still finish together. The thread calling Run() works too.
+class WorkPool {
+public:
+    // `threads` counts the calling thread; 1 runs everything inline.
+    explicit WorkPool(int threads);
+    ~WorkPool();
+
+    WorkPool(const WorkPool&) = delete;
+    WorkPool& operator=(const WorkPool&) = delete;
+
+    int threads() const { return (int)queues_.size(); }
+
+    // Calls fn(0) .. fn(count - 1) and returns once all have returned.
+    // Not reentrant.
+    template <typename Fn>
+    void Run(int count, Fn& fn) {
+        RunItems(count, [](void* f, int i) { (*static_cast<Fn*>(f))(i); }, &fn);
+    }
+
+private:
+    typedef void (*ItemFn)(void*, int);
+
+    struct Queue {
+        std::mutex mutex;
+        std::vector<int> items;
+        size_t next = 0;    // items before this one are taken
+    };
+
+    void RunItems(int count, ItemFn fn, void* arg);
+    // Next item for thread `self`: its own oldest, else another's newest.
+    bool Take(int self, int& item);
+    void Work(int self);
+    void WorkerLoop(int self);
+
+    std::vector<std::unique_ptr<Queue>> queues_;   // [0] is the caller's
+    std::vector<std::thread> workers_;
+
+    ItemFn fn_ = nullptr;
+    void* arg_ = nullptr;
+    std::atomic<int> remaining_{0};
+
+    std::mutex mutex_;
+    std::condition_variable start_, done_;
+    unsigned generation_ = 0;
+    bool stop_ = false;
+};
+
+#endif